@@ -0,0 +1,2666 @@
+#include "acquisition.h"
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include "version.h"
+
+#include "trace_decode.h"
+#include "capture_pipeline.h"
+#include "frame_ring.h"
+
+#include "spline.cpp"
+#include "sparams.cpp"
+#include "sweep_archive.cpp"
+
+#include <cstdio>
+
+// NI VISA API Info
+// http://zone.ni.com/reference/en-XX/help/370131S-01/ni-visa/examplevisamessage-basedapplication/
+
+/*
+Capture buffer arena (see acquisition::capture_buffers())
+Sized from POIN by the first capture and reused by the next ones (only reallocated when the
+number of points changes or a larger transfer buffer is needed).
+Traces are decoded straight into the S-parameter database (S.RI, the only format stored) and the
+transfer buffers are on the heap (no alloca or large stack arrays whatever the number of points).
+*/
+static_assert(sizeof(SPARAM::RI) == sizeof(COMPLEX_DOUBLE), "SPARAM::RI is used as COMPLEX_DOUBLE");
+
+class capture_arena
+{
+public:
+    capture_arena() : raw_size(0)
+    {
+        memset(raw, 0, sizeof(raw));
+    }
+
+    ~capture_arena()
+    {
+        for (S32 col = 0; col < 4; col++)
+        {
+            FREE(raw[col]);
+        }
+    }
+
+    /*
+    Parameters:
+    S32 n_ports => 1 (S1P) or 2 (S2P)
+    S32 n_points => number of points (including DC entry)
+    U32 raw_bytes => transfer buffer size per S-parameter (0 = none, trace decoded in place)
+    */
+    bool reserve(S32 n_ports, S32 n_points, U32 raw_bytes)
+    {
+        if ((S.n_ports != n_ports) || (S.n_points != n_points))
+        {
+            if (!S.alloc(n_ports, n_points, SNPTYPE::RI))
+            {
+                qDebug("capture_arena::reserve() Error %s", S.message_text);
+                S.clear();
+                return FALSE;
+            }
+        }
+        for (S32 b = 0; b < n_ports; b++)
+        {
+            for (S32 a = 0; a < n_ports; a++)
+            {
+                memset(S.valid[b][a], SNPTYPE::RI, n_points); // Traces are decoded in S.RI
+            }
+        }
+
+        if (raw_bytes > raw_size)
+        {
+            for (S32 col = 0; col < 4; col++)
+            {
+                FREE(raw[col]);
+                raw[col] = (U8 *)malloc(raw_bytes);
+                if (raw[col] == NULL)
+                {
+                    qDebug("capture_arena::reserve() Error out of memory (%u bytes)", raw_bytes);
+                    raw_size = 0;
+                    return FALSE;
+                }
+            }
+            raw_size = raw_bytes;
+        }
+
+        return TRUE;
+    }
+
+    SPARAMS S;
+    U8 *raw[4]; // Transfer buffer of each S-parameter (kept until decoded by the capture pipeline)
+    U32 raw_size;
+};
+
+acquisition::acquisition(QObject *parent) :
+    QObject(parent), instr(nullptr), arena(nullptr), stream(nullptr), session_clear_needed(FALSE),
+    cancel_request(FALSE), progress_value(-1),
+    instrument_info_valid(FALSE), stimulus_valid(FALSE),
+    stimulus_start_Hz(0.0), stimulus_stop_Hz(0.0), stimulus_nb_points(0),
+    stimulus_cached(FALSE), stimulus_center_Hz(0.0), stimulus_span_Hz(0.0), stimulus_lin_sweep(TRUE),
+    freq_axis_valid(FALSE), freq_axis_start_Hz(0.0), freq_axis_stop_Hz(0.0), freq_axis_nb_points(0),
+    freq_axis_lin_sweep(TRUE)
+{
+    memset(resource, 0, sizeof(resource));
+    strncpy(resource, VISA_GPIB_RES_STR, sizeof(resource) - 1);
+    memset(instrument_name, 0, sizeof(instrument_name));
+    memset(instrument_opts, 0, sizeof(instrument_opts));
+    memset(instrument_if_bandwidth, 0, sizeof(instrument_if_bandwidth));
+    memset(instrument_smoothing, 0, sizeof(instrument_smoothing));
+    memset(instrument_averaging, 0, sizeof(instrument_averaging));
+    memset(instrument_correction, 0, sizeof(instrument_correction));
+    memset(instrument_out_power_level, 0, sizeof(instrument_out_power_level));
+    memset(&capture_timing, 0, sizeof(capture_timing));
+}
+
+/*
+Capture buffers sized from POIN, allocated by the first capture and reused by the next ones
+Parameters:
+S32 n_ports => 1 (S1P) or 2 (S2P)
+S32 n_points => number of points (including DC entry)
+U32 raw_bytes => transfer buffer size per S-parameter (0 if the trace is decoded in place)
+Return the capture buffers or nullptr if out of memory
+*/
+capture_arena *acquisition::capture_buffers(S32 n_ports, S32 n_points, U32 raw_bytes)
+{
+    if (arena == nullptr)
+    {
+        arena = new capture_arena();
+    }
+    if (!arena->reserve(n_ports, n_points, raw_bytes))
+    {
+        delete arena;
+        arena = nullptr;
+        return nullptr;
+    }
+
+    return arena;
+}
+
+void acquisition::cancel()
+{
+    cancel_request = TRUE;
+}
+
+// Send progress to the GUI only when the % changes (queued signal, no event processing here)
+void acquisition::update_progress(S32 value)
+{
+    if (value == progress_value)
+    {
+        return;
+    }
+    progress_value = value;
+    emit progress_changed(value);
+}
+
+/*
+Get the instrument session, the session (VISA or simulated, see vna_transport.h) is kept open between jobs
+and only re-opened when the health check (serial poll) fails or the resource changes
+Parameters:
+U32 timeout_ms => I/O timeout in ms
+Return TRUE on success (instr is valid)
+*/
+bool acquisition::session_open(U32 timeout_ms)
+{
+    VNA_STATUS stat;
+
+    if (instr != nullptr)
+    {
+        U16 stb = 0;
+
+        instr->set_timeout(timeout_ms);
+        stat = instr->read_stb(&stb);
+        if (stat >= VNA_SUCCESS)
+        {
+            qDebug("session reused \"%s\" read_stb stb=0x%02X", resource, stb);
+            if (session_clear_needed)
+            {
+                /* Clear the device (previous job aborted or in error) */
+                instr->clear();
+                session_clear_needed = FALSE;
+                stimulus_cached = FALSE;
+                freq_axis_valid = FALSE;
+            }
+            return TRUE;
+        }
+        qDebug("read_stb stat=%d => re-open session", stat);
+        session_close();
+    }
+
+    instr = vna_transport_create(resource);
+    if (instr == nullptr)
+    {
+        QString info = QString("VISA is not available in this build, use a \"SIM::8753\" resource");
+        qDebug() << info;
+        emit log(info);
+        return FALSE;
+    }
+
+    // connect to the VNA
+    stat = instr->open(resource, timeout_ms);
+    if (stat < VNA_SUCCESS)
+    {
+       qDebug("open stat=%d", stat);
+       QString info = QString("Could not open resource ") + QString(resource);
+       qDebug() << info;
+       emit log(info);
+       delete instr;
+       instr = nullptr;
+       return FALSE;
+    }
+    qDebug("open \"%s\" stat=%d", resource, stat);
+    /* Clear the device */
+    instr->clear();
+    session_clear_needed = FALSE;
+
+    return TRUE;
+}
+
+// Close the session, instrument info cache is dropped (instrument may have changed)
+void acquisition::session_close(void)
+{
+    if (instr != nullptr)
+    {
+        instr->close();
+        delete instr;
+    }
+    instr = nullptr;
+    instrument_info_valid = FALSE;
+    stimulus_valid = FALSE;
+    stimulus_cached = FALSE;
+    freq_axis_valid = FALSE;
+}
+
+/*
+Change the resource string (e.g. "GPIB0::16::INSTR" or "SIM::8753" for the simulated instrument)
+The current session is closed and the new resource is opened by the next job
+*/
+void acquisition::set_resource(QString resource_str)
+{
+    std::string res = resource_str.toStdString();
+
+    if ((res.length() == 0) || (strcmp(res.c_str(), resource) == 0))
+    {
+        return;
+    }
+    session_close();
+    memset(resource, 0, sizeof(resource));
+    strncpy(resource, res.c_str(), sizeof(resource) - 1);
+    qDebug("set_resource \"%s\"", resource);
+}
+
+/*
+Compare the stimulus with the one seen before, instrument info is invalidated if it changed
+Parameters:
+DOUBLE start_Hz => Start frequency in Hz
+DOUBLE stop_Hz => Stop frequency in Hz
+S32 nb_points => Number of points
+Return FALSE if the stimulus changed (cached instrument info shall be queried again)
+*/
+bool acquisition::instrument_check_stimulus(DOUBLE start_Hz, DOUBLE stop_Hz, S32 nb_points)
+{
+    if (stimulus_valid &&
+        (start_Hz == stimulus_start_Hz) && (stop_Hz == stimulus_stop_Hz) && (nb_points == stimulus_nb_points))
+    {
+        return TRUE;
+    }
+
+    bool first = !stimulus_valid;
+    stimulus_start_Hz = start_Hz;
+    stimulus_stop_Hz = stop_Hz;
+    stimulus_nb_points = nb_points;
+    stimulus_valid = TRUE;
+    if (first)
+    {
+        return TRUE;
+    }
+
+    qDebug("stimulus changed => instrument info cache invalidated");
+    instrument_info_valid = FALSE;
+    return FALSE;
+}
+
+// Stimulus written or instrument preset, instrument info shall be queried again
+void acquisition::instrument_invalidate_info(void)
+{
+    instrument_info_valid = FALSE;
+    stimulus_valid = FALSE;
+    stimulus_cached = FALSE;
+    freq_axis_valid = FALSE;
+}
+
+void acquisition::restore_continuous_sweep(void)
+{
+    U8 buf[3] = { 0 };
+    U32 retCount;
+    VNA_STATUS stat;
+
+    // Restore continuous sweep
+    qDebug("CONT;OPC?;WAIT;");
+    stat = instr->printf("CONT;\n");
+    // Wait for the analyzer to finish
+    stat = instr->printf("OPC?;WAIT;\n");
+    // Read the 1 when complete
+    memset(buf, 0, 2);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() completed=\"%c\" (expected 1) retCount=%d stat=%d", buf[0], retCount, stat);
+}
+
+/*
+Query instrument identity and settings used in the SnP header
+(OUTPIDEN, OUTPOPTS, IFBW?, SMOOO?, AVERO?, CORR?, POWE?)
+Result is cached until the stimulus changes (see instrument_check_stimulus())
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+*/
+bool acquisition::instrument_query_info(vna_transport *instr)
+{
+    qDebug("instrument_query_info start");
+    #define DATA_SIZE (512)
+    VNA_STATUS stat;
+    U8 data[DATA_SIZE+1] = { 0 };
+    U32 retCount;
+    double if_bandwidth;
+    double out_power_level;
+
+    instrument_info_valid = FALSE;
+
+    // Outputs the identification string for the analyzer (like IDN?)
+    instr->printf("OUTPIDEN\n");
+    memset(data, 0, DATA_SIZE);
+    stat = instr->read(data, DATA_SIZE, &retCount);
+    qDebug("read() data=\"%s\" retCount=%d stat=%d", data, retCount, stat);
+    if(stat != 0)
+    {
+        qDebug("Error to communicate with GPIB stat=%d", stat);
+        emit log("Error to communicate with GPIB");
+        return FALSE;
+    }
+    _snprintf(instrument_name, sizeof(instrument_name) - 1, "%s", data);
+    {
+        C8 *d = &instrument_name[strlen(instrument_name) - 1];
+        while ((d >= instrument_name) && ((*d == 10) || (*d == 13)))
+        {
+            *d = 0;
+        }
+    }
+    qDebug("instrument_name=\"%s\"", instrument_name);
+    emit log((char*)instrument_name);
+
+    // Read Instrument Options ASCII
+    instr->printf("OUTPOPTS\n");
+    memset(instrument_opts, 0, sizeof(instrument_opts));
+    stat = instr->read((U8*)instrument_opts, (sizeof(instrument_opts)-1), &retCount);
+    {
+        C8 *d = &instrument_opts[strlen(instrument_opts) - 1];
+        while ((d >= instrument_opts) && ((*d == 10) || (*d == 13)))
+        {
+            *d = 0;
+        }
+    }
+    qDebug(" end param OUTPOPTS read() result=\"%s\" retCount=%d stat=%d time=%lld ms", instrument_opts, retCount, stat);
+    qDebug("instrument_opts=\"%s\"", instrument_opts);
+
+    // Read IF bandwidth in Hz
+    instr->printf("IFBW?\n");
+    if_bandwidth = 0.0;
+    stat = instr->scanf_double(&if_bandwidth);
+    sprintf(instrument_if_bandwidth, "IF bandwidth: %.lf Hz", if_bandwidth);
+    qDebug("instrument_if_bandwidth=\"%s\"", instrument_if_bandwidth);
+
+    // Check Smoothing ON or OFF
+    instr->printf("SMOOO?;\n");
+    // Read the 1 when complete
+    memset(data, 0, 2);
+    stat = instr->read(data, 2, &retCount);
+    qDebug(" end param SMOOO? read() result=\"%c\" retCount=%d stat=%d time=%lld ms", data[0], retCount, stat);
+    if(data[0] == '1')
+    {
+        sprintf(instrument_smoothing, "Smoothing ON");
+    }else
+    {
+        sprintf(instrument_smoothing, "Smoothing OFF");
+    }
+    qDebug("instrument_smoothing=\"%s\"", instrument_smoothing);
+
+    // Check Averaging ON or OFF
+    instr->printf("AVERO?;\n");
+    // Read the 1 when complete
+    memset(data, 0, 2);
+    stat = instr->read(data, 2, &retCount);
+    qDebug(" end param AVERO? read() result=\"%c\" retCount=%d stat=%d time=%lld ms", data[0], retCount, stat);
+    if(data[0] == '1')
+    {
+        sprintf(instrument_averaging, "Averaging ON");
+    }else
+    {
+        sprintf(instrument_averaging, "Averaging OFF");
+    }
+    qDebug("instrument_averaging=\"%s\"", instrument_averaging);
+
+    // Check Correction ON or OFF
+    instr->printf("CORR?;\n");
+    // Read the 1 when complete
+    memset(data, 0, 2);
+    stat = instr->read(data, 2, &retCount);
+    qDebug(" end param CORR? read() result=\"%c\" retCount=%d stat=%d time=%lld ms", data[0], retCount, stat);
+    if(data[0] == '1')
+    {
+        sprintf(instrument_correction, "Correction ON");
+    }else
+    {
+        sprintf(instrument_correction, "Correction OFF");
+    }
+    qDebug("instrument_correction=\"%s\"", instrument_correction);
+
+    // Read Output power level in dBm
+    instr->printf("POWE?;\n");
+    out_power_level = 0.0;
+    stat = instr->scanf_double(&out_power_level);
+    sprintf(instrument_out_power_level, "Output power level: %.6lf dBm", out_power_level);
+    qDebug("instrument_out_power_level=\"%s\"", instrument_out_power_level);
+
+    instrument_info_valid = TRUE;
+    qDebug("instrument_query_info end");
+    return TRUE;
+}
+
+/*
+Instrument identity/settings (cached) then hold the sweep
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+bool force_query_info => TRUE to refresh identity/settings even if cached
+*/
+bool acquisition::instrument_setup(vna_transport *instr, bool force_query_info)
+{
+    qDebug("instrument_setup start");
+    VNA_STATUS stat;
+    U8 data[3] = { 0 };
+    U32 retCount;
+
+    if (debug_mode)
+    {
+        instr->printf("DEBUON;\n");
+    }
+
+    if (force_query_info || (!instrument_info_valid))
+    {
+        if (instrument_query_info(instr) == FALSE)
+        {
+            session_clear_needed = TRUE;
+            return FALSE;
+        }
+    }
+    else
+    {
+        qDebug("instrument_setup use cached info instrument_name=\"%s\"", instrument_name);
+        emit log((char*)instrument_name);
+    }
+
+    instr->printf("HOLD;\n");
+    // Wait for the analyzer to finish
+    instr->printf("OPC?;WAIT;\n");
+    // Read the 1 when complete
+    memset(data, 0, 2);
+    stat = instr->read(data, 2, &retCount);
+    qDebug("read() completed=\"%c\" (expected 1) retCount=%d stat=%d", data[0], retCount, stat);
+
+    qDebug("instrument_setup end");
+    return TRUE;
+}
+
+/*
+Touchstone data rows formatted by column (one column per S-parameter) in the capture pipeline
+Each column (SPARAM::print_pair() per point in the file data format) is formatted by the pipeline worker
+as soon as its S-parameter is decoded (while the next one is transferred), write() only joins
+frequency and columns row by row so the file is identical to SPARAMS::write_SNP_file() with the same
+text_digits
+*/
+#define SNP_TEXT_MAX_VALUE (2 * (SPARAM::TEXT_MAX_VALUE + 1)) // SPARAM::print_pair() worst case
+#define SNP_TEXT_WRITE_BUFFER_SIZE (256 * 1024)
+
+class snp_text_columns
+{
+public:
+    snp_text_columns()
+    {
+        memset(text, 0, sizeof(text));
+        memset(offset, 0, sizeof(offset));
+    }
+
+    ~snp_text_columns()
+    {
+        for (S32 col = 0; col < 4; col++)
+        {
+            FREE(text[col]);
+            FREE(offset[col]);
+        }
+    }
+
+    /*
+    Parameters:
+    S32 col => 0 to 3 (S11, S21, S12, S22 order of the S2P rows)
+    const COMPLEX_DOUBLE *src => S-parameter (n points including DC entry)
+    S32 n => number of points
+    U8 format => SNPTYPE::MA, SNPTYPE::DB or SNPTYPE::RI
+    S32 digits => 0 = "%lf" 6 decimals else 1 to 17 significant digits (see SPARAM::print_double())
+    */
+    bool format(S32 col, const COMPLEX_DOUBLE *src, S32 n, U8 format, S32 digits)
+    {
+        U32 size = (U32)n * 24 + SNP_TEXT_MAX_VALUE;
+        U32 len = 0;
+
+        FREE(text[col]);
+        FREE(offset[col]);
+        text[col] = (C8 *)malloc(size);
+        offset[col] = (U32 *)malloc((n + 1) * sizeof(offset[col][0]));
+        if ((text[col] == NULL) || (offset[col] == NULL))
+        {
+            qDebug("snp_text_columns::format() Error out of memory");
+            return FALSE;
+        }
+
+        for (S32 i = 0; i < n; i++)
+        {
+            if (size - len < SNP_TEXT_MAX_VALUE)
+            {
+                C8 *grow = (C8 *)realloc(text[col], size * 2);
+                if (grow == NULL)
+                {
+                    qDebug("snp_text_columns::format() Error out of memory");
+                    return FALSE;
+                }
+                text[col] = grow;
+                size *= 2;
+            }
+
+            offset[col][i] = len;
+            SPARAM::RI val = src[i];
+            switch (format)
+            {
+                case SNPTYPE::DB:
+                {
+                    SPARAM::DB db = val;
+                    len += SPARAM::print_pair(&text[col][len], db.dB, db.deg, digits);
+                    break;
+                }
+
+                case SNPTYPE::RI:
+                    len += SPARAM::print_pair(&text[col][len], val.real, val.imag, digits);
+                    break;
+
+                default:
+                {
+                    SPARAM::MA ma = val;
+                    len += SPARAM::print_pair(&text[col][len], ma.mag, ma.deg, digits);
+                    break;
+                }
+            }
+        }
+        offset[col][n] = len;
+
+        return TRUE;
+    }
+
+    /*
+    Write the Touchstone file (header by SPARAMS::write_SNP_header(), then one row per point)
+    Parameters:
+    const C8 *filename => Output filename
+    S32 n_ports => 1 (S1P, column 0) or 2 (S2P, columns 0 to 3)
+    S32 n_points => number of points (including DC entry)
+    DOUBLE min_Hz, max_Hz, Zo => header info
+    const C8 *data_format, *freq_format, *header, *single_param_type => see SPARAMS::write_SNP_file()
+    const DOUBLE *freq_Hz => frequency of each point
+    S32 digits => frequency text, same as format()
+    */
+    bool write(const C8 *filename, S32 n_ports, S32 n_points, DOUBLE min_Hz, DOUBLE max_Hz, DOUBLE Zo,
+               const C8 *data_format, const C8 *freq_format, const C8 *header, const C8 *single_param_type,
+               const DOUBLE *freq_Hz, S32 digits)
+    {
+        S32 n_cols = n_ports * n_ports;
+        DOUBLE freq_div = 1E9;
+        U8 format = SNPTYPE::MA;
+
+        FILE *out = fopen(filename, "wt");
+        if (out == NULL)
+        {
+            qDebug("snp_text_columns::write() Error couldn't open %s", filename);
+            return FALSE;
+        }
+        SPARAMS S; // Header info only (no data allocated)
+        S.n_ports = n_ports;
+        S.n_points = n_points;
+        S.min_Hz = min_Hz;
+        S.max_Hz = max_Hz;
+        S.Zo = Zo;
+        S.write_SNP_header(out, data_format, freq_format, header, single_param_type, &freq_div, &format);
+        S.n_ports = 0;
+        S.n_points = 0;
+
+        C8 *buf = (C8 *)malloc(SNP_TEXT_WRITE_BUFFER_SIZE);
+        if (buf == NULL)
+        {
+            fclose(out);
+            return FALSE;
+        }
+
+        U32 len = 0;
+        bool result = TRUE;
+        for (S32 i = 0; (i < n_points) && result; i++)
+        {
+            U32 row_len = (SNP_TEXT_MAX_VALUE / 2) + 1;
+            for (S32 col = 0; col < n_cols; col++)
+            {
+                row_len += offset[col][i + 1] - offset[col][i];
+            }
+            if ((len + row_len > SNP_TEXT_WRITE_BUFFER_SIZE) && (len > 0))
+            {
+                result = (fwrite(buf, 1, len, out) == len);
+                len = 0;
+            }
+            if (row_len > SNP_TEXT_WRITE_BUFFER_SIZE)
+            {
+                result = FALSE;
+                break;
+            }
+
+            len += SPARAM::print_double(&buf[len], freq_Hz[i] / freq_div, digits);
+            buf[len++] = ' ';
+            for (S32 col = 0; col < n_cols; col++)
+            {
+                U32 col_len = offset[col][i + 1] - offset[col][i];
+                memcpy(&buf[len], &text[col][offset[col][i]], col_len);
+                len += col_len;
+            }
+            buf[len++] = '\n';
+        }
+        if (result && (len > 0))
+        {
+            result = (fwrite(buf, 1, len, out) == len);
+        }
+
+        free(buf);
+        if (fclose(out) != 0)
+        {
+            result = FALSE;
+        }
+        if (!result)
+        {
+            qDebug("snp_text_columns::write() Error writing %s", filename);
+        }
+
+        return result;
+    }
+
+private:
+    C8 *text[4];
+    U32 *offset[4]; // offset[col][i] = first char of point i, offset[col][n] = column length
+};
+
+/*
+Capture pipeline of a save_SnP_FORMx() call (see capture_pipeline.h)
+columns is declared before pipe so the worker is stopped (pipe destructor) before the columns are freed
+*/
+class snp_pipeline
+{
+public:
+    snp_pipeline(const C8 *data_format, S32 digits, S32 n_ports, S32 first_AC_point, S32 n_AC_points) :
+        digits(digits),
+        n_ports(n_ports),
+        first_AC_point(first_AC_point),
+        n_AC_points(n_AC_points),
+        n_points(first_AC_point + n_AC_points)
+    {
+        format = SNPTYPE::MA;
+        if (!_stricmp(data_format, "DB")) format = SNPTYPE::DB;
+        else if (!_stricmp(data_format, "RI")) format = SNPTYPE::RI;
+    }
+
+    // Queue the Touchstone column formatting of a decoded trace (n_points with DC entry)
+    void submit_format(const C8 *param, S32 col, const COMPLEX_DOUBLE *trace)
+    {
+        C8 stage_name[CAPTURE_PIPELINE_STAGE_NAME_SIZE] = { 0 };
+        snp_text_columns *cols = &columns;
+        S32 n = n_points;
+        U8 fmt = format;
+        S32 dig = digits;
+
+        _snprintf(stage_name, sizeof(stage_name) - 1, "%s format", param);
+        pipe.submit(stage_name, [cols, col, trace, n, fmt, dig]()
+        {
+            return cols->format(col, trace, n, fmt, dig);
+        });
+    }
+
+    // Queue the file write (all the parameters pointed shall stay valid until pipe.wait())
+    void submit_write(const C8 *filename, DOUBLE min_Hz, DOUBLE max_Hz, DOUBLE Zo,
+                      const C8 *data_format, const C8 *freq_format, const C8 *header, const C8 *single_param_type,
+                      const DOUBLE *freq_Hz)
+    {
+        snp_text_columns *cols = &columns;
+        S32 ports = n_ports;
+        S32 n = n_points;
+        S32 dig = digits;
+
+        pipe.submit("write", [=]()
+        {
+            return cols->write(filename, ports, n, min_Hz, max_Hz, Zo, data_format, freq_format, header, single_param_type, freq_Hz, dig);
+        });
+    }
+
+    snp_text_columns columns;
+    capture_pipeline pipe;
+    U8 format; // SNPTYPE::MA, SNPTYPE::DB or SNPTYPE::RI
+    S32 digits; // Touchstone text (see SPARAM::print_double())
+    S32 n_ports;
+    S32 first_AC_point;
+    S32 n_AC_points;
+    S32 n_points;
+};
+
+/*
+Streaming capture frames (see acquisition::stream_SnP())
+frames[] are the frame_ring slots (n_slots + the spare slot of FRAME_RING_DROP), S-parameter databases
+sized from POIN and reused by the next streams. The acquisition thread decodes each sweep straight into
+a frame, the writer thread saves every frame queued by the ring in its own Touchstone file
+(SPARAMS::write_SNP_file(), same rows as save_SnP_FORMx()) or appends it to a sweep archive (open_archive(), see
+SWEEP_ARCHIVE) while the next sweeps run.
+*/
+class capture_stream
+{
+public:
+    capture_stream() : frames(nullptr), n_frames(0), write_errors(0), archive_state(-1)
+    {
+        clear_sweeps();
+    }
+
+    ~capture_stream()
+    {
+        stop_writer();
+        delete[] frames;
+    }
+
+    /*
+    Parameters:
+    S32 n_slots => frames queued for the writer (1 to FRAME_RING_MAX_SLOTS)
+    FRAME_RING_POLICY policy => FRAME_RING_BLOCK (sweeps wait for the writer) or FRAME_RING_DROP
+    S32 n_ports => 1 (S1P) or 2 (S2P)
+    S32 n_points => number of points (including DC entry)
+    S32 first_AC_point => 1 with DC entry (set to 1.0 in every frame) else 0
+    const DOUBLE *freq_Hz => frequency of each point (n_points)
+    DOUBLE min_Hz, max_Hz => Touchstone header info
+    */
+    bool reserve(S32 n_slots, FRAME_RING_POLICY policy, S32 n_ports, S32 n_points, S32 first_AC_point,
+                 const DOUBLE *freq_Hz, DOUBLE min_Hz, DOUBLE max_Hz)
+    {
+        ring.reset(n_slots, policy);
+        if (n_frames != ring.capacity() + 1)
+        {
+            delete[] frames;
+            n_frames = ring.capacity() + 1;
+            frames = new SPARAMS[n_frames];
+        }
+
+        for (S32 i = 0; i < n_frames; i++)
+        {
+            SPARAMS *F = &frames[i];
+
+            if ((F->n_ports != n_ports) || (F->n_points != n_points))
+            {
+                if (!F->alloc(n_ports, n_points, SNPTYPE::RI))
+                {
+                    qDebug("capture_stream::reserve() Error %s", F->message_text);
+                    F->clear();
+                    return FALSE;
+                }
+            }
+            memcpy(F->freq_Hz, freq_Hz, n_points * sizeof(DOUBLE));
+            F->freq_grid = -1;
+            F->min_Hz = min_Hz;
+            F->max_Hz = max_Hz;
+            for (S32 b = 0; b < n_ports; b++)
+            {
+                for (S32 a = 0; a < n_ports; a++)
+                {
+                    memset(F->valid[b][a], SNPTYPE::RI, n_points);
+                    if (first_AC_point > 0)
+                    {
+                        F->RI[b][a][0].real = 1.0;
+                        F->RI[b][a][0].imag = 0.0;
+                    }
+                }
+            }
+        }
+        clear_sweeps();
+        write_errors = 0;
+
+        return TRUE;
+    }
+
+    /*
+    Start the writer thread (after reserve()), frame files are "<name>_<sweep><ext>" (e.g. "dut_000012.S2P")
+    Parameters:
+    const C8 *name => output filename without extension
+    const C8 *ext => ".S1P" or ".S2P"
+    const C8 *data_format, *freq_format, *header, *single_param_type => see SPARAMS::write_SNP_file()
+    DOUBLE Zo => reference impedance
+    S32 digits => 0 = "%lf" 6 decimals else 1 to 17 significant digits (see SPARAMS::text_digits)
+    */
+    void start_writer(const C8 *name, const C8 *ext, const C8 *data_format, const C8 *freq_format,
+                      const C8 *header, const C8 *single_param_type, DOUBLE Zo, S32 digits)
+    {
+        memset(&out, 0, sizeof(out));
+        _snprintf(out.name, sizeof(out.name) - 1, "%s", name);
+        _snprintf(out.ext, sizeof(out.ext) - 1, "%s", ext);
+        _snprintf(out.data_format, sizeof(out.data_format) - 1, "%s", data_format);
+        _snprintf(out.freq_format, sizeof(out.freq_format) - 1, "%s", freq_format);
+        _snprintf(out.header, sizeof(out.header) - 1, "%s", header);
+        _snprintf(out.param, sizeof(out.param) - 1, "%s", single_param_type);
+        out.Zo = Zo;
+        out.digits = digits;
+
+        writer = std::thread(&capture_stream::writer_loop, this);
+    }
+
+    /*
+    Frames appended to one sweep archive instead of one Touchstone file per sweep (after reserve(), before start_writer())
+    Parameters:
+    const C8 *filename => archive filename (SWEEP_ARCHIVE_EXT)
+    const C8 *state => instrument state of the frames (one setting per line)
+    time_t start_time => capture start
+    DOUBLE Zo => reference impedance
+    */
+    bool open_archive(const C8 *filename, const C8 *state, time_t start_time, DOUBLE Zo)
+    {
+        SPARAMS *F = &frames[0];
+
+        if (!archive.create(filename, F->n_ports, F->n_points, F->freq_Hz, F->min_Hz, F->max_Hz, COMPLEX_DOUBLE(Zo, 0.0), start_time))
+        {
+            return FALSE;
+        }
+        archive_state = archive.add_state(state);
+
+        return (archive_state >= 0);
+    }
+
+    // No more frames, wait until the queued ones are written (and the archive closed)
+    void stop_writer(void)
+    {
+        ring.close();
+        if (writer.joinable())
+        {
+            writer.join();
+        }
+        if ((archive.file != NULL) && (!archive.close()))
+        {
+            write_errors++;
+        }
+    }
+
+    frame_ring ring;
+    SPARAMS *frames; // [ring.capacity() + 1]
+    S32 n_frames;
+    // Sweep number (from 1) and capture time since the stream start of each frame, written by the acquisition
+    // thread with the frame and also read by the live consumer (atomic, see stream_latest())
+    std::atomic<U64> sweep[FRAME_RING_MAX_SLOTS + 1];
+    std::atomic<U64> time_us[FRAME_RING_MAX_SLOTS + 1];
+    std::atomic<U64> write_errors;
+    SWEEP_ARCHIVE archive; // Writer thread once started (file = NULL: Touchstone files)
+
+private:
+    void clear_sweeps(void)
+    {
+        for (S32 i = 0; i <= FRAME_RING_MAX_SLOTS; i++)
+        {
+            sweep[i].store(0, std::memory_order_relaxed);
+            time_us[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void writer_loop(void)
+    {
+        for (;;)
+        {
+            S32 slot = ring.next();
+            if (slot < 0)
+            {
+                break;
+            }
+
+            SPARAMS *F = &frames[slot];
+
+            if (archive.file != NULL)
+            {
+                if (!archive.append(F, sweep[slot], time_us[slot], archive_state))
+                {
+                    write_errors++;
+                }
+                ring.release();
+                continue;
+            }
+
+            C8 filename[MAX_PATH + 32] = { 0 };
+            C8 header[sizeof(out.header) + 64] = { 0 };
+
+            _snprintf(filename, sizeof(filename) - 1, "%s_%06llu%s", out.name, (unsigned long long)sweep[slot], out.ext);
+            _snprintf(header, sizeof(header) - 1, "! Sweep %llu at %.3f s\n%s",
+                      (unsigned long long)sweep[slot], time_us[slot] / 1000000.0, out.header);
+
+            F->Zo = COMPLEX_DOUBLE(out.Zo, 0.0);
+            F->text_digits = out.digits;
+            if (!F->write_SNP_file(filename, out.data_format, out.freq_format, header, out.param))
+            {
+                write_errors++;
+            }
+            ring.release();
+        }
+    }
+
+    struct
+    {
+        C8 name[MAX_PATH + 1];
+        C8 ext[8];
+        C8 data_format[8];
+        C8 freq_format[8];
+        C8 header[1024];
+        C8 param[8];
+        DOUBLE Zo;
+        S32 digits;
+    } out;
+
+    S32 archive_state;
+    std::thread writer;
+};
+
+// Defined after capture_stream (complete type needed by delete)
+acquisition::~acquisition()
+{
+    session_close();
+    delete arena;
+    delete stream;
+}
+
+/*
+Transfer buffer size of each S-parameter (capture_arena raw) for a trace of n_AC_points
+FORM5 is read in place in the upper half of each trace (no transfer buffer)
+*/
+static U32 capture_raw_bytes(S32 form, S32 n_AC_points)
+{
+    switch (form)
+    {
+        case 4:
+            return (U32)n_AC_points * FORM4_BYTES_PER_POINT + FORM4_READ_CHUNK;
+
+        case 5:
+            return 0;
+
+        default:
+            return (U32)n_AC_points * FORM1_BYTES_PER_POINT + FORM1_RAW_SLACK;
+    }
+}
+
+/*
+Read a trace with the capture pipeline
+Sweep/transfer on the acquisition thread (timed stage, in the arena->raw[col] buffer) then decode
+and Touchstone column formatting queued on the pipeline worker (trace valid after snp->pipe.wait())
+Parameters:
+snp_pipeline *snp => Capture pipeline
+S32 form => 1, 4 or 5
+vna_transport *instr => Instrument session (VISA or simulated)
+C8 *param => "S11" or "S21" or "S12" or "S22"
+C8 *query => "OUTPDATA" (Default) or "OUTPFORM"
+COMPLEX_DOUBLE *trace => S-parameter array (snp->n_points, AC points from snp->first_AC_point)
+S32 col => Touchstone column 0 = S11, 1 = S21, 2 = S12, 3 = S22 (0 for S1P)
+S32 progress_fraction => Progression in %
+bool sweep => TRUE = single sweep of param before the read, FALSE = data of the last sweep
+*/
+bool acquisition::read_trace_pipeline(snp_pipeline *snp, S32 form, vna_transport *instr, C8 *param, C8 *query,
+                                      COMPLEX_DOUBLE *trace, S32 col, S32 progress_fraction, bool sweep)
+{
+    C8 stage_name[CAPTURE_PIPELINE_STAGE_NAME_SIZE] = { 0 };
+    COMPLEX_DOUBLE *dest = &trace[snp->first_AC_point];
+    bool result;
+
+    _snprintf(stage_name, sizeof(stage_name) - 1, "%s %s", param, sweep ? "sweep+transfer" : "transfer");
+    S32 stage = snp->pipe.stage_begin(stage_name);
+    switch (form)
+    {
+        case 4:
+            result = read_complex_trace_FORM4(instr, param, query, dest, snp->n_AC_points, progress_fraction, sweep, &snp->pipe,
+                                              arena->raw[col], arena->raw_size);
+        break;
+
+        case 5:
+            result = read_complex_trace_FORM5(instr, param, query, dest, snp->n_AC_points, progress_fraction, sweep, &snp->pipe);
+        break;
+
+        default:
+            result = read_complex_trace_FORM1(instr, param, query, dest, snp->n_AC_points, progress_fraction, sweep, &snp->pipe,
+                                              arena->raw[col], arena->raw_size);
+        break;
+    }
+    snp->pipe.stage_end(stage);
+
+    if (result)
+    {
+        snp->submit_format(param, col, trace);
+    }
+
+    return result;
+}
+
+/*
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+C8             *param => "S11" or "S21" or "S12" or "S22"
+C8             *query => "OUTPDATA" (Default) or "OUTPFORM"
+COMPLEX_DOUBLE *dest 	=> dest data
+S32             cnt		=> number of points (n_AC_points)
+S32             progress_fraction => Progression in %
+bool            sweep => TRUE = single sweep of param before the read, FALSE = data of the last sweep
+capture_pipeline *pipe => nullptr = decode before return, else decode job queued (dest valid after pipe->wait())
+U8             *raw => ASCII trace buffer (kept until the trace is parsed)
+U32             raw_size => size of raw (cnt * FORM4_BYTES_PER_POINT + FORM4_READ_CHUNK)
+*/
+bool acquisition::read_complex_trace_FORM4(vna_transport *instr,
+                                    C8             *param,
+                                    C8             *query,
+                                    COMPLEX_DOUBLE *dest,
+                                    S32             cnt,
+                                    S32             progress_fraction,
+                                    bool            sweep,
+                                    capture_pipeline *pipe,
+                                    U8             *raw,
+                                    U32             raw_size)
+{
+    U8 buf[3] = { 0 };
+    U32 retCount;
+    VNA_STATUS stat;
+    U8 mask = 0x40;
+    QElapsedTimer timer;
+
+    qDebug(" read_complex_trace_FORM4() start param=%s query=%s", param, query);
+    timer.start();
+
+    if (sweep)
+    {
+        instr->printf("CLES;SRE 4;ESNB 1;\n");
+        qDebug(" printf(\"CLES;SRE 4;ESNB 1;\")");
+        mask = 0x40;// Extended register bit 0 = SING sweep complete; map it to status bit and enable SRQ on it
+
+        instr->printf("%s;FORM4;OPC?;SING;\n", param);
+        qDebug(" printf(\"%s;FORM4;OPC?;SING;\") time=%lld ms", param, timer.elapsed());
+        // Read the 1 when complete
+        memset(buf, 0, 2);
+        stat = instr->read(buf, 2, &retCount);
+        qDebug(" end param read() completed=\"%c\" (expected 1) retCount=%d stat=%d time=%lld ms", buf[0], retCount, stat, timer.elapsed());
+
+        instr->printf("CLES;SRE 0;\n");
+    }
+    else
+    {
+        // Parameter measured by the last sweep (see S2P_single_sweep())
+        instr->printf("%s;FORM4;\n", param);
+        qDebug(" printf(\"%s;FORM4;\") no sweep time=%lld ms", param, timer.elapsed());
+    }
+    instr->printf("%s;\n", query);
+
+    // Read whole ASCII trace in the capture buffer (see capture_arena) with a few large read() then parse it in one pass
+    C8 *trace = (C8 *)raw;
+    U32 trace_len = 0;
+
+    qDebug(" read() all trace data start");
+    timer.start();
+    do
+    {
+        if (trace_len == raw_size)
+        {
+            qDebug(" Error %s trace larger than %u bytes", param, raw_size);
+            return FALSE;
+        }
+
+        U32 chunk = min((U32)FORM4_READ_CHUNK, raw_size - trace_len);
+        retCount = 0;
+        stat = instr->read((U8 *)&trace[trace_len], chunk, &retCount);
+        trace_len += retCount;
+
+        update_progress(progress_fraction + (S32)min((S64)19, ((S64)trace_len * 20) / ((S64)cnt * FORM4_BYTES_PER_POINT)));
+    } while (stat == VNA_SUCCESS_MAX_CNT);
+    qDebug(" read() all trace data end stat=%d trace_len=%u time=%lld ms", stat, trace_len, timer.elapsed());
+
+    if (stat < VNA_SUCCESS)
+    {
+        qDebug(" Error VNA read timed out reading %s (%u bytes received)", param, trace_len);
+        return FALSE;
+    }
+
+    if (pipe != nullptr)
+    {
+        // Parsed by the pipeline worker while the next trace is transferred
+        C8 stage_name[CAPTURE_PIPELINE_STAGE_NAME_SIZE] = { 0 };
+        _snprintf(stage_name, sizeof(stage_name) - 1, "%s parse FORM4", param);
+        pipe->submit(stage_name, [trace, trace_len, dest, cnt]()
+        {
+            S32 n = parse_FORM4_trace(trace, (S32)trace_len, dest, cnt);
+            if (n != cnt)
+            {
+                qDebug(" Error parse_FORM4_trace() point %d of %d points", n, cnt);
+                return FALSE;
+            }
+            return TRUE;
+        });
+        update_progress(progress_fraction + 20);
+        return TRUE;
+    }
+
+    timer.start();
+    S32 n = parse_FORM4_trace(trace, (S32)trace_len, dest, cnt);
+    qint64 parse_time_ns = timer.nsecsElapsed();
+
+    if (n != cnt)
+    {
+        qDebug(" Error VNA read timed out reading %s (point %d of %d points)", param, n, cnt);
+        return FALSE;
+    }
+    qDebug(" read_complex_trace_FORM4() parse end time=%lld us (%.0lf points/s)",
+           parse_time_ns / 1000, ((DOUBLE)cnt * 1E9) / (DOUBLE)max((qint64)1, parse_time_ns));
+
+    update_progress(progress_fraction + 20);
+
+    return TRUE;
+}
+
+/*
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+C8             *param => "S11" or "S21" or "S12" or "S22"
+C8             *query => "OUTPDATA" (Default) or "OUTPFORM"
+COMPLEX_DOUBLE *dest 	=> dest data
+S32             cnt		=> number of points (n_AC_points)
+S32             progress_fraction => Progression in %
+bool            sweep => TRUE = single sweep of param before the read, FALSE = data of the last sweep
+capture_pipeline *pipe => nullptr = decode before return, else decode job queued (dest valid after pipe->wait())
+U8             *raw => FORM1 raw data buffer (kept until the trace is decoded)
+U32             raw_size => size of raw (cnt * FORM1_BYTES_PER_POINT + FORM1_RAW_SLACK)
+*/
+bool acquisition::read_complex_trace_FORM1(vna_transport *instr,
+                                    C8             *param,
+                                    C8             *query,
+                                    COMPLEX_DOUBLE *dest,
+                                    S32             cnt,
+                                    S32             progress_fraction,
+                                    bool            sweep,
+                                    capture_pipeline *pipe,
+                                    U8             *raw,
+                                    U32             raw_size)
+{
+    U8 buf[4] = { 0 };
+    U32 retCount;
+    VNA_STATUS stat;
+    U8 mask = 0x40;
+    QElapsedTimer timer;
+    QElapsedTimer timer_readdata;
+    int datalen;
+
+    qDebug(" read_complex_trace_FORM1() start param=%s query=%s", param, query);
+    timer.start();
+
+    if (sweep)
+    {
+        instr->printf("CLES;SRE 4;ESNB 1;\n");
+        qDebug(" printf(\"CLES;SRE 4;ESNB 1;\")");
+        mask = 0x40;// Extended register bit 0 = SING sweep complete; map it to status bit and enable SRQ on it
+
+        instr->printf("%s;FORM1;OPC?;SING;\n", param);
+        qDebug(" printf(\"%s;FORM1;OPC?;SING;\") time=%lld ms", param, timer.elapsed());
+        // Read the 1 when complete
+        memset(buf, 0, 2);
+        stat = instr->read(buf, 2, &retCount);
+        qDebug(" end param read() completed=\"%c\" (expected 1) retCount=%d stat=%d time=%lld ms", buf[0], retCount, stat, timer.elapsed());
+
+        instr->printf("CLES;SRE 0;\n");
+    }
+    else
+    {
+        // Parameter measured by the last sweep (see S2P_single_sweep())
+        instr->printf("%s;FORM1;\n", param);
+        qDebug(" printf(\"%s;FORM1;\") no sweep time=%lld ms", param, timer.elapsed());
+    }
+    instr->printf("%s;\n", query);
+
+    // Read in the data header two characters and two bytes for length
+    // Read header as 2 byte string
+    memset(buf, 0, 3);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() hdr 2bytes=\"%s\"(expected \"#A\") stat=%d", buf, stat);
+    // Read length as 2 bytes integer
+    memset(buf, 0, 3);
+    stat = instr->read(buf, 2, &retCount);
+    datalen = (buf[0] << 8) + buf[1]; /* Big Endian Format */
+    qDebug("read() length 2bytes=0x%02X 0x%02X=>datalen=%d retCount=%d stat=%d", buf[0], buf[1], datalen, retCount, stat);
+
+    // FORM1 length is 16 bits (65535 bytes => 10922 points max), use FORM4 or FORM5 above
+    if ((S64)cnt * FORM1_BYTES_PER_POINT > 0xFFFF)
+    {
+        qDebug(" Error %d points do not fit in a FORM1 trace (10922 points max)", cnt);
+        return FALSE;
+    }
+    if ((datalen != cnt * FORM1_BYTES_PER_POINT) || ((U32)datalen > raw_size))
+    {
+        qDebug(" Error datalen(%d) != %d (raw_size=%u)", datalen, cnt * FORM1_BYTES_PER_POINT, raw_size);
+        return FALSE;
+    }
+
+    // Read trace data in the capture buffer (see capture_arena)
+    qDebug("read() all trace data (max size=%u)", raw_size);
+    U32 raw_len = 0;
+    timer_readdata.start();
+    do
+    {
+        retCount = 0;
+        stat = instr->read(&raw[raw_len], raw_size - raw_len, &retCount);
+        raw_len += retCount;
+    } while ((stat == VNA_SUCCESS_MAX_CNT) && (raw_len < (U32)datalen));
+    qDebug("read() stat=%d raw_len=%u timer_readdata=%lld ms", stat, raw_len, timer_readdata.elapsed());
+
+    if ((stat < VNA_SUCCESS) || (raw_len < (U32)datalen))
+    {
+        qDebug(" Error VNA read timed out reading %s (%u bytes received)", param, raw_len);
+        return FALSE;
+    }
+    raw_len = (U32)datalen;
+
+    if (pipe != nullptr)
+    {
+        // Decoded by the pipeline worker while the next trace is transferred
+        C8 stage_name[CAPTURE_PIPELINE_STAGE_NAME_SIZE] = { 0 };
+        _snprintf(stage_name, sizeof(stage_name) - 1, "%s decode FORM1", param);
+        pipe->submit(stage_name, [raw, raw_len, dest, cnt]()
+        {
+            return (decode_FORM1_trace(raw, (S32)raw_len, dest, cnt) == cnt);
+        });
+        update_progress(progress_fraction + 20);
+        return TRUE;
+    }
+
+    qDebug(" decode_FORM1_trace() %d points isa=%s", cnt, decode_isa_name(DECODE_ISA_AUTO));
+    timer.start();
+    if (decode_FORM1_trace(raw, (S32)raw_len, dest, cnt) != cnt)
+    {
+        qDebug(" Error VNA read timed out reading %s", param);
+        return FALSE;
+    }
+    qint64 decode_ns = timer.nsecsElapsed();
+    qDebug(" decode_FORM1_trace() time=%lld us (%.1f Mpoints/s)", decode_ns / 1000,
+           (decode_ns > 0) ? ((DOUBLE)cnt * 1000.0 / (DOUBLE)decode_ns) : 0.0);
+    update_progress(progress_fraction + 20);
+    qDebug(" read_complex_trace_FORM1() loop end time=%lld ms", timer.elapsed());
+
+    return TRUE;
+}
+
+/*
+Read a FORM5 (PC_FLOAT32) trace and decode it in place in dest
+The raw float32 pairs are read in the upper half of dest (8 bytes per point in a 16 bytes per point array)
+then expanded to double by decode_FORM5_trace() without intermediate buffer
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+C8             *param => "S11" or "S21" or "S12" or "S22"
+C8             *query => "OUTPDATA" (Default) or "OUTPFORM"
+COMPLEX_DOUBLE *dest 	=> dest data
+S32             cnt		=> number of points (n_AC_points)
+S32             progress_fraction => Progression in %
+bool            sweep => TRUE = single sweep of param before the read, FALSE = data of the last sweep
+capture_pipeline *pipe => nullptr = decode before return, else decode job queued (dest valid after pipe->wait())
+*/
+bool acquisition::read_complex_trace_FORM5(vna_transport *instr,
+                                    C8             *param,
+                                    C8             *query,
+                                    COMPLEX_DOUBLE *dest,
+                                    S32             cnt,
+                                    S32             progress_fraction,
+                                    bool            sweep,
+                                    capture_pipeline *pipe)
+{
+    U8 buf[4] = { 0 };
+    U32 retCount;
+    VNA_STATUS stat;
+    QElapsedTimer timer;
+    QElapsedTimer timer_readdata;
+    S32 datalen;
+
+    qDebug(" read_complex_trace_FORM5() start param=%s query=%s", param, query);
+    timer.start();
+
+    if (sweep)
+    {
+        instr->printf("CLES;SRE 4;ESNB 1;\n");
+        qDebug(" printf(\"CLES;SRE 4;ESNB 1;\")");
+
+        instr->printf("%s;FORM5;OPC?;SING;\n", param);
+        qDebug(" printf(\"%s;FORM5;OPC?;SING;\") time=%lld ms", param, timer.elapsed());
+        // Read the 1 when complete
+        memset(buf, 0, 2);
+        stat = instr->read(buf, 2, &retCount);
+        qDebug(" end param read() completed=\"%c\" (expected 1) retCount=%d stat=%d time=%lld ms", buf[0], retCount, stat, timer.elapsed());
+
+        instr->printf("CLES;SRE 0;\n");
+    }
+    else
+    {
+        // Parameter measured by the last sweep (see S2P_single_sweep())
+        instr->printf("%s;FORM5;\n", param);
+        qDebug(" printf(\"%s;FORM5;\") no sweep time=%lld ms", param, timer.elapsed());
+    }
+    instr->printf("%s;\n", query);
+
+    // Read "#A" header and length (2 bytes Little Endian Format) with one read()
+    memset(buf, 0, sizeof(buf));
+    stat = instr->read(buf, 4, &retCount);
+    datalen = (buf[3] << 8) + buf[2];
+    qDebug(" read() hdr=\"%c%c\"(expected \"#A\") datalen=%d retCount=%d stat=%d", buf[0], buf[1], datalen, retCount, stat);
+    if ((retCount != 4) || (buf[0] != '#') || (buf[1] != 'A') || (datalen != cnt * FORM5_BYTES_PER_POINT))
+    {
+        qDebug(" Error invalid FORM5 header datalen(%d) != %d", datalen, cnt * FORM5_BYTES_PER_POINT);
+        return FALSE;
+    }
+
+    // Read trace data in the upper half of dest
+    U8 *raw = (U8 *)dest + (size_t)cnt * FORM5_BYTES_PER_POINT;
+    U32 raw_len = 0;
+    timer_readdata.start();
+    do
+    {
+        retCount = 0;
+        stat = instr->read(&raw[raw_len], (U32)datalen - raw_len, &retCount);
+        raw_len += retCount;
+    } while ((stat == VNA_SUCCESS_MAX_CNT) && (raw_len < (U32)datalen));
+    qint64 read_ns = timer_readdata.nsecsElapsed();
+    qDebug(" read() stat=%d raw_len=%u time=%lld us (%.1f kB/s)", stat, raw_len, read_ns / 1000,
+           (read_ns > 0) ? ((DOUBLE)raw_len * 1e6 / (DOUBLE)read_ns) : 0.0);
+
+    if ((stat < VNA_SUCCESS) || (raw_len != (U32)datalen))
+    {
+        qDebug(" Error VNA read timed out reading %s (%u bytes received)", param, raw_len);
+        return FALSE;
+    }
+
+    if (pipe != nullptr)
+    {
+        // Decoded in place by the pipeline worker while the next trace is transferred
+        C8 stage_name[CAPTURE_PIPELINE_STAGE_NAME_SIZE] = { 0 };
+        _snprintf(stage_name, sizeof(stage_name) - 1, "%s decode FORM5", param);
+        pipe->submit(stage_name, [raw, raw_len, dest, cnt]()
+        {
+            return (decode_FORM5_trace(raw, (S32)raw_len, dest, cnt) == cnt);
+        });
+        update_progress(progress_fraction + 20);
+        return TRUE;
+    }
+
+    timer.start();
+    if (decode_FORM5_trace(raw, (S32)raw_len, dest, cnt) != cnt)
+    {
+        qDebug(" Error decode_FORM5_trace() %s", param);
+        return FALSE;
+    }
+    qint64 decode_ns = timer.nsecsElapsed();
+    qDebug(" decode_FORM5_trace() time=%lld us (%.1f Mpoints/s)", decode_ns / 1000,
+           (decode_ns > 0) ? ((DOUBLE)cnt * 1000.0 / (DOUBLE)decode_ns) : 0.0);
+    update_progress(progress_fraction + 20);
+
+    return TRUE;
+}
+
+/*
+Capture a Touchstone file with FORM1, FORM4 or FORM5 trace transfers
+(the form only changes the trace transfer/decode, see read_trace_pipeline())
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+S32 form => 1 = FORM1, 4 = FORM4 or 5 = FORM5
+S32 SnP => 1 = S1P or 2 = S2P
+C8 *param => "" for S2P, "S11", "S21" or "S22" for S1P
+C8 *query => "OUTPDATA" (Default) or "OUTPFORM"
+DOUBLE R_ohms => 50.0
+const C8 *data_format => S2P File Format "MA" Magnitude-angle or "DB" dB-angle or "RI" Real-imaginary
+const C8 *freq_format => "Hz"(Default), "kHz", "MHz", "GHz"
+S32 digits => Touchstone text: 0 = "%lf" 6 decimals (Default) else 1 to 17 significant digits (see SPARAM::print_double())
+S32 DC_entry => 0 = None(Default)
+const C8 *explicit_filename => Output filename
+bool single_sweep_S2P => S2P: TRUE = one sweep for the 4 parameters when correction is ON (see S2P_single_sweep())
+*/
+bool acquisition::save_SnP_FORMx(vna_transport *instr,
+                            S32       form,
+                            S32       SnP,
+                            C8       *param,
+                            C8       *query,
+                            DOUBLE    R_ohms,
+                            const C8 *data_format,
+                            const C8 *freq_format,
+                            S32       digits,
+                            S32       DC_entry,
+                            const C8 *explicit_filename,
+                            bool      single_sweep_S2P)
+{
+    QElapsedTimer total_timer;
+    QElapsedTimer timer;
+    VNA_STATUS stat;
+
+    qDebug("save_SnP_FORM%d() start", form);
+    total_timer.start();
+    //
+    // Get filename to save
+    //
+    C8 filename[MAX_PATH + 1] = { 0 };
+    if ((explicit_filename != nullptr) && (explicit_filename[0]))
+    {
+        strncpy(filename, explicit_filename, MAX_PATH);
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    //
+    // Force filename to end in .SnP suffix
+    //
+    S32 l = strlen(filename);
+    if (l >= 4)
+    {
+        if (SnP == 1)
+        {
+            if (_stricmp(&filename[l - 4], ".S1P"))
+            {
+                strcat(filename, ".S1P");
+            }
+        }
+        else
+        {
+            if (_stricmp(&filename[l - 4], ".S2P"))
+            {
+                strcat(filename, ".S2P");
+            }
+        }
+    }
+
+    /* Measure time for debug/optimizations ... */
+    qDebug("timer.clockType()=%d ", timer.clockType());
+
+    timer.start();
+    qDebug("instrument_setup() start");
+    if(instrument_setup(instr) == FALSE)
+    {
+        qDebug("instrument_setup(instr) error\n");
+        return FALSE;
+    }
+    qDebug("instrument_setup() end time=%lld ms\n", timer.elapsed());
+    capture_timing.setup_ms = timer.nsecsElapsed() / 1E6;
+
+    //
+    // Get start/stop freq and # of trace points
+    //
+    S32    n = 0;
+    DOUBLE start_Hz = 0.0;
+    DOUBLE stop_Hz = 0.0;
+
+    qDebug("STAR/STOP/POIN? start");
+    timer.start();
+
+    // STAR/STOP/POIN (cached by the previous job of this session, else one query round-trip)
+    if (!stimulus_query(NULL, FALSE))
+    {
+        return FALSE;
+    }
+    start_Hz = stimulus_start_Hz;
+    stop_Hz = stimulus_stop_Hz;
+    n = stimulus_nb_points;
+
+    qDebug("STAR/STOP/POIN? end time=%lld ms\n", timer.elapsed());
+    capture_timing.stimulus_ms = timer.nsecsElapsed() / 1E6;
+
+    // Cached instrument info (SnP header) is only kept for the same stimulus (see instrument_check_stimulus())
+    if (!instrument_info_valid)
+    {
+        instrument_query_info(instr);
+    }
+
+    //
+    // Reserve space for DC term if requested
+    //
+    bool include_DC = (DC_entry != 0);
+    S32 n_alloc_points = n;
+    S32 n_AC_points = n;
+    S32 first_AC_point = 0;
+
+    if (include_DC)
+    {
+        n_alloc_points++;
+        first_AC_point = 1;
+    }
+
+    //
+    // Traces are decoded directly in the S-parameter database of the capture buffers
+    // (sized from POIN and reused by the next captures, see capture_arena)
+    //
+    capture_arena *buffers = capture_buffers(SnP, n_alloc_points, capture_raw_bytes(form, n_AC_points));
+    if (buffers == nullptr)
+    {
+        stat = instr->printf("DEBUOFF;CONT;\n");
+        qDebug("DEBUOFF;CONT; stat=%d", stat);
+        return FALSE;
+    }
+    DOUBLE *freq_Hz = buffers->S.freq_Hz;
+    COMPLEX_DOUBLE *S11 = buffers->S.RI[0][0];
+    COMPLEX_DOUBLE *S21 = (SnP == 2) ? buffers->S.RI[1][0] : NULL;
+    COMPLEX_DOUBLE *S12 = (SnP == 2) ? buffers->S.RI[0][1] : NULL;
+    COMPLEX_DOUBLE *S22 = (SnP == 2) ? buffers->S.RI[1][1] : NULL;
+
+    if (include_DC)
+    {
+        freq_Hz[0] = 0.0;
+        S11[0].real = 1.0;
+        S11[0].imag = 0.0;
+        if (SnP == 2)
+        {
+            S21[0].real = 1.0;
+            S21[0].imag = 0.0;
+            S12[0].real = 1.0;
+            S12[0].imag = 0.0;
+            S22[0].real = 1.0;
+            S22[0].imag = 0.0;
+        }
+    }
+
+    //
+    // Construct frequency array
+    // (computed for a linear sweep else read with OUTPLIML, kept for the next captures with the same
+    // stimulus, see read_freq_axis())
+    //
+    qDebug("Frequency array queries start");
+    timer.start();
+    if (!read_freq_axis(instr, start_Hz, stop_Hz, &freq_Hz[first_AC_point], n_AC_points))
+    {
+        return FALSE;
+    }
+    qDebug("Frequency array queries end time=%lld ms\n", timer.elapsed());
+    capture_timing.freq_axis_ms = timer.nsecsElapsed() / 1E6;
+
+    //
+    // If this is an 8753 or 8720, determine what the active parameter is so it can be
+    // restored afterward
+    // (S12 and S22 queries are not supported on 8752 or 8510)
+    //
+    qDebug("Active parameter queries start");
+    timer.start();
+    static const C8 param_names[4][4] = { "S11", "S21", "S12", "S22" };
+    S32 active_param = active_param_query(instr);
+    qDebug("Active parameter queries end time=%lld ms\n", timer.elapsed());
+    capture_timing.active_param_ms = timer.nsecsElapsed() / 1E6;
+
+    qDebug("Progress %d%%\n", 15);
+    update_progress(15);
+    //
+    // Read data from VNA
+    //
+    snp_pipeline snp(data_format, digits, SnP, first_AC_point, n_AC_points);
+    snp.pipe.start();
+    QElapsedTimer traces_timer;
+    traces_timer.start();
+    bool result = FALSE;
+    if (cancel_requested())
+    {
+        stat = instr->printf("DEBUOFF;CONT;\n");
+        qDebug("DEBUOFF;CONT; stat=%d", stat);
+        return FALSE;
+    }
+    if (SnP == 1)
+    {
+        qDebug("read_complex_trace_FORM%d start %s", form, param);
+        timer.start();
+        result = read_trace_pipeline(&snp, form, instr, param, query, S11, 0, 50, TRUE);
+        qDebug("read_complex_trace_FORM%d end %s result=%d time=%lld ms\n", form, param, result, timer.elapsed());
+    }
+    else
+    {
+        qDebug("read_complex_trace_FORM%d S11, S21, S12, S22 start\n", form);
+        QElapsedTimer S2P_timer;
+        qint64 sweep_ms = 0;
+        S2P_timer.start();
+        bool single_sweep = single_sweep_S2P && S2P_single_sweep(instr, &sweep_ms);
+
+        qDebug(" read_complex_trace_FORM%d S11 start", form);
+        timer.start();
+        result = read_trace_pipeline(&snp, form, instr, (C8*)"S11", query, S11, 0, 20, !single_sweep);
+        if (cancel_requested())
+        {
+            stat = instr->printf("DEBUOFF;CONT;\n");
+            qDebug("DEBUOFF;CONT; stat=%d", stat);
+            return FALSE;
+        }
+        qDebug(" read_complex_trace_FORM%d S11 end result=%d time=%lld ms\n", form, result, timer.elapsed());
+
+        qDebug(" read_complex_trace_FORM%d S21 start", form);
+        timer.start();
+        result = result && read_trace_pipeline(&snp, form, instr, (C8*)"S21", query, S21, 1, 40, !single_sweep);
+        if (cancel_requested())
+        {
+            stat = instr->printf("DEBUOFF;CONT;\n");
+            qDebug(" DEBUOFF;CONT; stat=%d", stat);
+            return FALSE;
+        }
+        qDebug(" read_complex_trace_FORM%d S21 end result=%d time=%lld ms\n", form, result, timer.elapsed());
+
+        qDebug(" read_complex_trace_FORM%d S12 start", form);
+        timer.start();
+        result = result && read_trace_pipeline(&snp, form, instr, (C8*)"S12", query, S12, 2, 60, !single_sweep);
+        if (cancel_requested())
+        {
+            stat = instr->printf("DEBUOFF;CONT;\n");
+            qDebug("DEBUOFF;CONT; stat=%d", stat);
+            return FALSE;
+        }
+        qDebug(" read_complex_trace_FORM%d S12 end result=%d time=%lld ms\n", form, result, timer.elapsed());
+
+        qDebug(" read_complex_trace_FORM%d S22 start", form);
+        timer.start();
+        result = result && read_trace_pipeline(&snp, form, instr, (C8*)"S22", query, S22, 3, 80, !single_sweep);
+        if (cancel_requested())
+        {
+            stat = instr->printf("DEBUOFF;CONT;\n");
+            qDebug("DEBUOFF;CONT; stat=%d", stat);
+            return FALSE;
+        }
+        qDebug(" read_complex_trace_FORM%d S22 end result=%d time=%lld ms\n", form, result, timer.elapsed());
+
+        S2P_report_time(single_sweep, sweep_ms, S2P_timer.elapsed());
+        qDebug("read_complex_trace_FORM%d S11, S21, S12, S22 end result=%d\n", form, result);
+    }
+
+    if (cancel_requested())
+    {
+        stat = instr->printf("DEBUOFF;CONT;\n");
+        qDebug("DEBUOFF;CONT; stat=%d", stat);
+        return FALSE;
+    }
+
+    //
+    // Create S-parameter database, fill it with received data, and save it
+    //
+    capture_timing.traces_ms = traces_timer.nsecsElapsed() / 1E6;
+    qDebug("Create S-parameter start");
+    timer.start();
+    C8 header[1024] = { 0 };
+    result = snp.pipe.wait() && result; // Decode and format jobs
+    if (result)
+    {
+        /* Obtain current time. */
+        time_t current_time = time(nullptr);
+        /* Convert to local time format. */
+        char last_char;
+        char* c_time_string = ctime(&current_time);
+        last_char = c_time_string[strlen(c_time_string)-1];
+        if ( (last_char == '\n') || (last_char == '\r'))
+        {
+            c_time_string[strlen(c_time_string)-1] = 0;
+        }
+        last_char = c_time_string[strlen(c_time_string)-1];
+        if ( (last_char == '\n') || (last_char == '\r'))
+        {
+            c_time_string[strlen(c_time_string)-1] = 0;
+        }
+
+        _snprintf(header, sizeof(header) - 1,
+            "! Touchstone 1.1 file saved by VNA QT V%s\n"
+            "! %s\n"
+            "!\n"
+            "! %s OPT: %s\n"
+            "! %s\n"
+            "! %s\n"
+            "! %s\n"
+            "! %s\n"
+            "! %s\n",
+                  VER_FILEVERSION_STR,
+                  c_time_string,
+                  instrument_name, instrument_opts,
+                  instrument_if_bandwidth,
+                  instrument_out_power_level,
+                  instrument_smoothing,
+                  instrument_averaging,
+                  instrument_correction);
+
+        // Rows written by the pipeline worker while the active parameter is restored
+        snp.submit_write(filename, include_DC ? 0.0 : start_Hz, stop_Hz, R_ohms,
+                         data_format, freq_format, header, param, freq_Hz);
+    }else {
+        qDebug("read_complex_trace_FORM%d() error\n", form);
+    }
+
+    //
+    // Restore active parameter and exit
+    //
+    capture_timing.decode_ms = timer.nsecsElapsed() / 1E6;
+    qDebug("Restore active parameter start");
+    timer.start();
+    if (active_param <= 3)
+    {
+        stat = instr->printf("%s\n", param_names[active_param]);
+        qDebug("%s stat=%d", param_names[active_param], stat);
+    }
+
+    stat = instr->printf("DEBUOFF;CONT;\n");
+    qDebug("DEBUOFF;CONT; stat=%d", stat);
+
+    qDebug("Restore active parameter end time=%lld ms\n", timer.elapsed());
+    capture_timing.restore_ms = timer.nsecsElapsed() / 1E6;
+    timer.start();
+
+    result = snp.pipe.wait() && result; // Write job
+    qDebug("Create S-parameter end result=%d\n", result);
+
+    C8 pipeline_text[512] = { 0 };
+    snp.pipe.report(pipeline_text, sizeof(pipeline_text));
+    qDebug("%s", pipeline_text);
+    emit log(pipeline_text);
+
+    qDebug("Progress %d%%\n", 100);
+    update_progress(100);
+    qint64 total_time_ms = total_timer.elapsed();
+    capture_timing.write_ms = timer.nsecsElapsed() / 1E6;
+    capture_timing.total_ms = total_timer.nsecsElapsed() / 1E6;
+    qDebug("save_SnP_FORM%d()) end total_time=%lld seconds (%lld ms)\n", form, total_time_ms/1000, total_time_ms);
+    return result;
+}
+
+/*
+S2P single sweep
+With correction ON (full two-port calibration) each sweep measures the 4 raw arrays (OUTPRAW1..4)
+and every corrected S-parameter is computed from them, so after one SING (instrument in HOLD)
+S11, S21, S12 and S22 are read without a new sweep.
+Without correction only the displayed parameter is measured => one sweep per parameter (fallback)
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+qint64 *sweep_ms => dest single sweep duration in ms
+Return TRUE if the single sweep has been done (parameters shall be read without sweep)
+*/
+bool acquisition::S2P_single_sweep(vna_transport *instr, qint64 *sweep_ms)
+{
+    QElapsedTimer timer;
+    VNA_STATUS stat;
+    U8 data[3] = { 0 };
+    U32 retCount;
+
+    *sweep_ms = 0;
+    stat = instr->printf("CORR?;\n");
+    memset(data, 0, 2);
+    stat = instr->read(data, 2, &retCount);
+    qDebug("CORR? read() result=\"%c\" retCount=%d stat=%d", data[0], retCount, stat);
+    if (data[0] != '1')
+    {
+        emit log("S2P single sweep needs correction ON (full two-port calibration), one sweep per parameter used");
+        return FALSE;
+    }
+
+    timer.start();
+    stat = instr->printf("OPC?;SING;\n");
+    memset(data, 0, 2);
+    stat = instr->read(data, 2, &retCount);
+    *sweep_ms = timer.elapsed();
+    qDebug("OPC?;SING; read() completed=\"%c\" (expected 1) retCount=%d stat=%d sweep time=%lld ms", data[0], retCount, stat, *sweep_ms);
+
+    return (data[0] == '1');
+}
+
+// Log the S2P capture time (wall clock) of the mode used
+void acquisition::S2P_report_time(bool single_sweep, qint64 sweep_ms, qint64 total_ms)
+{
+    char text[256];
+
+    if (single_sweep)
+    {
+        sprintf(text, "S2P single sweep: 4 parameters in %lld ms (sweep %lld ms, ~%lld ms saved vs one sweep per parameter)",
+                total_ms, sweep_ms, 3 * sweep_ms);
+    }
+    else
+    {
+        sprintf(text, "S2P one sweep per parameter: 4 parameters in %lld ms", total_ms);
+    }
+    qDebug("%s", text);
+    emit log(text);
+}
+
+/*
+Capture a Touchstone file (job started by the SnP buttons)
+Parameters:
+t_snp_capture_cfg cfg => capture configuration and output filename
+Emit save_SnP_finished() at the end (even on error or cancel)
+*/
+void acquisition::save_SnP(t_snp_capture_cfg cfg)
+{
+    QElapsedTimer timer;
+    qint64 time_elapsed_ms;
+    char data[512];
+    char filename[MAX_PATH + 1] = { 0 };
+    const C8 *func_name = (cfg.form == 4) ? "save_SnP_FORM4()" : ((cfg.form == 5) ? "save_SnP_FORM5()" : "save_SnP_FORM1()");
+    bool res = FALSE;
+
+    qDebug("save_SnP() start form=%d", cfg.form);
+    memset(&capture_timing, 0, sizeof(capture_timing));
+    cancel_request = FALSE;
+    progress_value = -1;
+
+    qDebug("SnP=%d param=%s query=%s R_ohms=%lf data_format=%s freq_format=%s digits=%d DC_entry=%d",
+           cfg.SnP, cfg.param, cfg.query, cfg.R_ohms, cfg.data_format, cfg.freq_format, cfg.digits, cfg.DC_entry);
+
+    strncpy(filename, cfg.filename.toStdString().c_str(), MAX_PATH);
+    qDebug("filename = \"%s\"", filename);
+
+    if (session_open(10000))
+    {
+        update_progress(0);
+
+        timer.start();
+        res = save_SnP_FORMx(instr, cfg.form, cfg.SnP, cfg.param, cfg.query, cfg.R_ohms,
+                             cfg.data_format, cfg.freq_format, cfg.digits, cfg.DC_entry, filename, cfg.single_sweep_S2P);
+        time_elapsed_ms = timer.elapsed();
+        if(res == TRUE)
+        {
+            sprintf(data, "%s finished with success in %lld s(%lld ms) see file %s\n", func_name, time_elapsed_ms/1000, time_elapsed_ms, filename);
+            qDebug("%s", data);
+        }else
+        {
+            sprintf(data, "%s finished with error\n", func_name);
+            qDebug("%s", data);
+        }
+        update_progress(100);
+        emit log(data);
+
+        if (!res)
+        {
+            session_clear_needed = TRUE; // Aborted or error, clear the device before next job
+        }
+        restore_continuous_sweep();
+    }
+
+    qDebug("save_SnP() exit");
+    emit save_SnP_finished(res);
+}
+
+/*
+Frequency of each point: computed for a linear sweep else read with OUTPLIML (08753-90256 example 3B)
+The sweep type (LINFREQ?) is read with the stimulus (see stimulus_query() called before).
+The whole OUTPLIML reply (4 values per point) is read with a few large read() then parsed in one pass
+(the 8753 has no binary form of the stimulus values).
+The axis is kept for the next captures of the session with the same start/stop/points/sweep type (no I/O).
+
+Note that the frequency parameter in .SnP files taken in POWS or CWTIME mode
+will reflect the power or time at each point, rather than the CW frequency
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+DOUBLE start_Hz, stop_Hz => Stimulus
+DOUBLE *freq_Hz => dest frequency array (AC points)
+S32 n => number of points
+Return FALSE on I/O error
+*/
+bool acquisition::read_freq_axis(vna_transport *instr, DOUBLE start_Hz, DOUBLE stop_Hz, DOUBLE *freq_Hz, S32 n)
+{
+    VNA_STATUS stat;
+    U32 retCount;
+
+    if (freq_axis_valid && (freq_axis_start_Hz == start_Hz) && (freq_axis_stop_Hz == stop_Hz) &&
+        (freq_axis_nb_points == n) && (freq_axis_lin_sweep == stimulus_lin_sweep))
+    {
+        memcpy(freq_Hz, freq_axis.data(), n * sizeof(DOUBLE));
+        qDebug("read_freq_axis() cached lin_sweep=%d n=%d", stimulus_lin_sweep, n);
+        return TRUE;
+    }
+    freq_axis_valid = FALSE;
+
+    if (stimulus_lin_sweep)
+    {
+        for (S32 i = 0; i < n; i++)
+        {
+            freq_Hz[i] = start_Hz + (((stop_Hz - start_Hz) * i) / (n - 1));
+        }
+    }
+    else
+    {
+        std::vector<C8> reply((size_t)n * OUTPLIML_BYTES_PER_POINT + FORM4_READ_CHUNK);
+        U32 reply_len = 0;
+
+        stat = instr->printf("OUTPLIML;\n");
+        qDebug("OUTPLIML; stat=%d", stat);
+        do
+        {
+            if (reply_len == (U32)reply.size())
+            {
+                qDebug("Error OUTPLIML larger than %u bytes", reply_len);
+                return FALSE;
+            }
+
+            U32 chunk = min((U32)FORM4_READ_CHUNK, (U32)reply.size() - reply_len);
+            retCount = 0;
+            stat = instr->read((U8 *)&reply[reply_len], chunk, &retCount);
+            reply_len += retCount;
+        } while (stat == VNA_SUCCESS_MAX_CNT);
+        qDebug("OUTPLIML read() stat=%d reply_len=%u", stat, reply_len);
+
+        if (stat < VNA_SUCCESS)
+        {
+            qDebug("Error VNA read timed out reading OUTPLIML (%u bytes received)", reply_len);
+            return FALSE;
+        }
+        S32 cnt = parse_OUTPLIML_stimulus(reply.data(), (S32)reply_len, freq_Hz, n);
+        if (cnt != n)
+        {
+            qDebug("Error OUTPLIML %d points parsed of %d points", cnt, n);
+            return FALSE;
+        }
+    }
+
+    freq_axis.assign(freq_Hz, freq_Hz + n);
+    freq_axis_start_Hz = start_Hz;
+    freq_axis_stop_Hz = stop_Hz;
+    freq_axis_nb_points = n;
+    freq_axis_lin_sweep = stimulus_lin_sweep;
+    freq_axis_valid = TRUE;
+
+    return TRUE;
+}
+
+/*
+Active parameter (restored at the end of a capture)
+(S12 and S22 queries are not supported on 8752 or 8510)
+Return 0 = S11, 1 = S21, 2 = S12, 3 = S22 or 4 if unknown
+*/
+S32 acquisition::active_param_query(vna_transport *instr)
+{
+    static const C8 param_names[4][4] = { "S11", "S21", "S12", "S22" };
+    U8 data[3] = { 0 };
+    U32 retCount;
+    S32 active_param;
+
+    for (active_param = 0; active_param < 4; active_param++)
+    {
+        instr->printf("%s?\n", param_names[active_param]);
+        memset(data, 0, 2);
+        instr->read(data, 2, &retCount);
+        if (data[0] == '1')
+        {
+            break;
+        }
+    }
+
+    return active_param;
+}
+
+/*
+Streaming capture loop (see stream_SnP())
+The acquisition thread sweeps and decodes each sweep in a frame of the ring (no allocation per sweep),
+the writer thread of capture_stream saves the frames and the GUI reads the latest one (stream_latest())
+Parameters:
+vna_transport *instr => Instrument session (VISA or simulated)
+const t_snp_capture_cfg *cfg => capture configuration (form 1 or 5)
+Return FALSE on I/O error (stop by cancel() is a normal end)
+*/
+bool acquisition::stream_run(vna_transport *instr, const t_snp_capture_cfg *cfg)
+{
+    static const C8 param_names[4][4] = { "S11", "S21", "S12", "S22" };
+    C8 text[512];
+
+    if (!instrument_setup(instr))
+    {
+        return FALSE;
+    }
+    if (!stimulus_query(NULL, FALSE))
+    {
+        return FALSE;
+    }
+    if (!instrument_info_valid)
+    {
+        instrument_query_info(instr);
+    }
+
+    S32 SnP = (cfg->SnP == 1) ? 1 : 2;
+    S32 form = (cfg->form == 5) ? 5 : 1;
+    S32 first_AC_point = (cfg->DC_entry != 0) ? 1 : 0;
+    S32 n_AC_points = stimulus_nb_points;
+    S32 n_points = n_AC_points + first_AC_point;
+
+    // Transfer buffers (FORM1) and frequency axis in the capture buffers
+    capture_arena *buffers = capture_buffers(SnP, n_points, capture_raw_bytes(form, n_AC_points));
+    if (buffers == nullptr)
+    {
+        return FALSE;
+    }
+    DOUBLE *freq_Hz = buffers->S.freq_Hz;
+    freq_Hz[0] = 0.0;
+    if (!read_freq_axis(instr, stimulus_start_Hz, stimulus_stop_Hz, &freq_Hz[first_AC_point], n_AC_points))
+    {
+        return FALSE;
+    }
+    S32 active_param = active_param_query(instr);
+
+    {
+        std::lock_guard<std::mutex> guard(stream_lock);
+        if (stream == nullptr)
+        {
+            stream = new capture_stream();
+        }
+        if (!stream->reserve(STREAM_FRAME_SLOTS, cfg->stream_drop_frames ? FRAME_RING_DROP : FRAME_RING_BLOCK,
+                             SnP, n_points, first_AC_point, freq_Hz,
+                             (first_AC_point > 0) ? 0.0 : stimulus_start_Hz, stimulus_stop_Hz))
+        {
+            emit log("Stream: out of memory");
+            return FALSE;
+        }
+    }
+
+    // Output "<filename without .SnP>_<sweep>.SnP"
+    C8 name[MAX_PATH + 1] = { 0 };
+    const C8 *ext = (SnP == 1) ? ".S1P" : ".S2P";
+    strncpy(name, cfg->filename.toStdString().c_str(), MAX_PATH);
+    S32 l = strlen(name);
+    if ((l >= 4) && (!_stricmp(&name[l - 4], ext)))
+    {
+        name[l - 4] = 0;
+    }
+
+    time_t start_time = time(nullptr);
+    C8 start_time_text[64] = { 0 };
+    strftime(start_time_text, sizeof(start_time_text) - 1, "%a %b %d %H:%M:%S %Y", localtime(&start_time));
+    C8 header[1024] = { 0 };
+    _snprintf(header, sizeof(header) - 1,
+        "! Touchstone 1.1 file saved by VNA QT V%s (stream started %s)\n"
+        "!\n"
+        "! %s OPT: %s\n"
+        "! %s\n"
+        "! %s\n"
+        "! %s\n"
+        "! %s\n"
+        "! %s\n",
+              VER_FILEVERSION_STR,
+              start_time_text,
+              instrument_name, instrument_opts,
+              instrument_if_bandwidth,
+              instrument_out_power_level,
+              instrument_smoothing,
+              instrument_averaging,
+              instrument_correction);
+    if (cfg->stream_archive)
+    {
+        // One "<filename without .SnP>.snpa" sweep archive, the instrument state is stored with the frames
+        C8 archive_name[MAX_PATH + 8] = { 0 };
+        C8 state[512] = { 0 };
+        _snprintf(archive_name, sizeof(archive_name) - 1, "%s%s", name, SWEEP_ARCHIVE_EXT);
+        _snprintf(state, sizeof(state) - 1, "%s OPT: %s\n%s\n%s\n%s\n%s\n%s",
+                  instrument_name, instrument_opts,
+                  instrument_if_bandwidth,
+                  instrument_out_power_level,
+                  instrument_smoothing,
+                  instrument_averaging,
+                  instrument_correction);
+        if (!stream->open_archive(archive_name, state, start_time, cfg->R_ohms))
+        {
+            sprintf(text, "Stream: %s", stream->archive.message_text);
+            emit log(text);
+            return FALSE;
+        }
+    }
+    stream->start_writer(name, ext, cfg->data_format, cfg->freq_format, header, cfg->param, cfg->R_ohms, cfg->digits);
+
+    sprintf(text, "Stream %s FORM%d %d points started (%s), %s %s%s%s",
+            (SnP == 1) ? cfg->param : "S2P", form, n_AC_points,
+            cfg->stream_drop_frames ? "frames dropped if the disk is late" : "sweeps wait for the disk",
+            cfg->stream_archive ? "archive" : "files", name,
+            cfg->stream_archive ? "" : "_NNNNNN", cfg->stream_archive ? SWEEP_ARCHIVE_EXT : ext);
+    qDebug("%s", text);
+    emit log(text);
+
+    // Sweep rate and counters (UI log every STREAM_STATS_MS)
+    QElapsedTimer stream_timer;
+    qint64 stats_ms = 0;
+    U64 stats_sweeps = 0;
+    auto report = [&](const C8 *title, qint64 now_ms, U64 sweeps)
+    {
+        DOUBLE rate = (now_ms > 0) ? (sweeps * 1000.0 / now_ms) : 0.0;
+        DOUBLE last_rate = (now_ms > stats_ms) ? ((sweeps - stats_sweeps) * 1000.0 / (now_ms - stats_ms)) : 0.0;
+
+        sprintf(text, "%s: %llu sweeps in %.1f s (%.2f sweeps/s, %.2f sweeps/s last %.1f s), written %llu, queued %llu/%d, "
+                      "dropped %llu, backpressure %.1f s, write errors %llu, live skipped %llu",
+                title, (unsigned long long)sweeps, now_ms / 1000.0, rate, last_rate, (now_ms - stats_ms) / 1000.0,
+                (unsigned long long)stream->ring.consumed(), (unsigned long long)stream->ring.queued(), stream->ring.capacity(),
+                (unsigned long long)stream->ring.dropped(), stream->ring.blocked_us() / 1000000.0,
+                (unsigned long long)stream->write_errors.load(), (unsigned long long)stream->ring.live_skipped());
+        qDebug("%s", text);
+        emit log(text);
+        stats_ms = now_ms;
+        stats_sweeps = sweeps;
+    };
+
+    bool result = TRUE;
+    U64 sweeps = 0;
+    stream_timer.start();
+    while (result && !cancel_requested())
+    {
+        S32 slot = stream->ring.acquire(&cancel_request);
+        if (slot < 0)
+        {
+            break; // Canceled while waiting for the writer
+        }
+        SPARAMS *F = &stream->frames[slot];
+        bool single_sweep = FALSE;
+        qint64 sweep_ms = 0;
+
+        if (SnP == 2)
+        {
+            single_sweep = cfg->single_sweep_S2P && S2P_single_sweep(instr, &sweep_ms);
+        }
+        for (S32 col = 0; (col < SnP * SnP) && result && (!cancel_requested()); col++)
+        {
+            // S2P: col 0 = S11, 1 = S21, 2 = S12, 3 = S22 (Touchstone order, RI[b][a])
+            C8 *param = (SnP == 1) ? (C8 *)cfg->param : (C8 *)param_names[col];
+            COMPLEX_DOUBLE *dest = &((COMPLEX_DOUBLE *)F->RI[col & 1][col >> 1])[first_AC_point];
+
+            if (form == 5)
+            {
+                result = read_complex_trace_FORM5(instr, param, (C8 *)cfg->query, dest, n_AC_points, 0, !single_sweep, nullptr);
+            }
+            else
+            {
+                result = read_complex_trace_FORM1(instr, param, (C8 *)cfg->query, dest, n_AC_points, 0, !single_sweep, nullptr,
+                                                  buffers->raw[col], buffers->raw_size);
+            }
+        }
+        if ((!result) || cancel_requested())
+        {
+            break; // Incomplete frame (not published)
+        }
+
+        sweeps++;
+        stream->sweep[slot].store(sweeps, std::memory_order_relaxed);
+        stream->time_us[slot].store((U64)(stream_timer.nsecsElapsed() / 1000), std::memory_order_relaxed);
+        stream->ring.publish(slot);
+
+        qint64 now_ms = stream_timer.elapsed();
+        if (now_ms - stats_ms >= STREAM_STATS_MS)
+        {
+            report("Stream", now_ms, sweeps);
+        }
+    }
+
+    // Frames still queued are written before the end
+    stream->stop_writer();
+    report(result ? "Stream stopped" : "Stream error", stream_timer.elapsed(), sweeps);
+
+    if (active_param <= 3)
+    {
+        instr->printf("%s\n", param_names[active_param]);
+    }
+    instr->printf("DEBUOFF;\n");
+
+    return result;
+}
+
+/*
+Streaming capture (job started by the Stream button), repeated sweeps until cancel()
+Each sweep is saved in its own Touchstone file (or appended to a sweep archive) by a writer thread, the GUI shows the latest
+sweep (stream_latest()) and the log shows the sweep rate and the frame counters.
+Parameters:
+t_snp_capture_cfg cfg => capture configuration and output filename
+Emit stream_finished() at the end
+*/
+void acquisition::stream_SnP(t_snp_capture_cfg cfg)
+{
+    bool res = FALSE;
+
+    qDebug("stream_SnP() start form=%d SnP=%d param=%s drop_frames=%d archive=%d", cfg.form, cfg.SnP, cfg.param,
+           cfg.stream_drop_frames, cfg.stream_archive);
+    cancel_request = FALSE;
+    progress_value = -1;
+
+    if (session_open(10000))
+    {
+        res = stream_run(instr, &cfg);
+        if (!res)
+        {
+            session_clear_needed = TRUE; // Error, clear the device before next job
+        }
+        restore_continuous_sweep();
+    }
+
+    qDebug("stream_SnP() exit");
+    emit stream_finished(res);
+}
+
+/*
+Live consumer of the streaming capture (GUI thread), never waits for the acquisition thread
+Parameters:
+t_stream_live *live => dest, only updated if the latest sweep is not live->sweep
+Return TRUE if a new sweep has been copied
+*/
+bool acquisition::stream_latest(t_stream_live *live)
+{
+    std::lock_guard<std::mutex> guard(stream_lock);
+    U64 seq;
+
+    if (stream == nullptr)
+    {
+        return FALSE;
+    }
+    S32 slot = stream->ring.latest(&seq);
+    if (slot < 0)
+    {
+        return FALSE;
+    }
+
+    // Sweep number and time read once in the seqlock section with the frame (only used once latest_valid())
+    U64 sweep = stream->sweep[slot].load(std::memory_order_relaxed);
+    U64 time_us = stream->time_us[slot].load(std::memory_order_relaxed);
+    if (sweep == live->sweep)
+    {
+        return FALSE; // Already copied (or being rewritten: the next call copies the new one)
+    }
+
+    SPARAMS *F = &stream->frames[slot];
+    S32 n_ports = F->n_ports;
+    S32 n_points = F->n_points;
+
+    live->freq_Hz.resize(n_points);
+    memcpy(live->freq_Hz.data(), F->freq_Hz, n_points * sizeof(DOUBLE));
+    for (S32 col = 0; col < 4; col++)
+    {
+        if (col >= n_ports * n_ports)
+        {
+            live->trace[col].clear();
+            continue;
+        }
+        live->trace[col].resize(n_points);
+        const SPARAM::RI *src = F->RI[col & 1][col >> 1];
+        COMPLEX_DOUBLE *dest = live->trace[col].data();
+        for (S32 i = 0; i < n_points; i++)
+        {
+            dest[i] = src[i];
+        }
+    }
+    if (!stream->ring.latest_valid(slot, seq))
+    {
+        return FALSE; // Rewritten by the acquisition thread during the copy
+    }
+
+    live->sweep = sweep;
+    live->time_s = time_us / 1000000.0;
+    live->n_ports = n_ports;
+    live->n_points = n_points;
+
+    return TRUE;
+}
+
+void acquisition::gpib_info()
+{
+    qDebug () << "gpib_info";
+
+    if (!session_open(10000))
+    {
+        return;
+    }
+
+    instrument_setup(instr, TRUE); // Always refresh identity/settings
+
+    restore_continuous_sweep();
+}
+
+void acquisition::preset()
+{
+    char debug_info[1024];
+    U8 buf[256] = { 0 };
+    U32 retCount;
+    VNA_STATUS stat;
+
+    qDebug () << "preset";
+
+    if (!session_open(10000))
+    {
+        return;
+    }
+
+    instrument_setup(instr);
+
+    // Preset the analyzer and wait
+    stat = instr->printf("OPC?;PRES;\n");
+    qDebug("OPC?;PRES; stat=%d", stat);
+    // Read the 1 when complete
+    memset(buf, 0, 2);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() completed=\"%c\" (expected 1) retCount=%d stat=%d", buf[0], retCount, stat);
+
+    instrument_invalidate_info();
+
+    if ((retCount > 0) && (buf[0]=='1'))
+    {
+        sprintf(debug_info, "HP8753D PRESET completed OK\n");
+        emit log(debug_info);
+    }else {
+        emit log("HP8753D PRESET error");
+    }
+
+    restore_continuous_sweep();
+}
+
+void acquisition::capture_FORM1_FORM5_raw()
+{
+    char debug_info[1024];
+    U8 buf[4] = { 0 }; // Headers only, trace data is written to file by read_to_file()
+    U32 retCount;
+    VNA_STATUS stat;
+    int datalen;
+    char form1_capture_filename[] = { "vna_form1_data.bin" };
+    char form5_capture_filename[] = { "vna_form5_PC_FLOAT32.bin" };
+
+    qDebug () << "capture_FORM1_FORM5_raw";
+
+    if (!session_open(10000))
+    {
+        return;
+    }
+
+    instrument_setup(instr);
+
+    // Single sweep and wait
+    stat = instr->printf("OPC?;SING;\n");
+    qDebug("OPC?;SING stat=%d", stat);
+    // Read the 1 when complete
+    memset(buf, 0, 2);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() completed=\"%c\" (expected 1) retCount=%d stat=%d", buf[0], retCount, stat);
+
+    // Select internal binary format
+    stat = instr->printf("FORM1;\n");
+    qDebug("FORM1; stat=%d", stat);
+    // Output error corrected data
+    stat = instr->printf("OUTPDATA;\n");
+    qDebug("OUTPDATA; stat=%d", stat);
+
+    // Read in the data header two characters and two bytes for length
+    // Read header as 2 byte string
+    memset(buf, 0, 3);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() hdr 2bytes=\"%s\"(expected \"#A\") stat=%d", buf, stat);
+    // Read length as 2 bytes integer
+    memset(buf, 0, 3);
+    stat = instr->read(buf, 2, &retCount);
+    datalen = (buf[0] << 8) + buf[1]; /* Big Endian Format */
+    qDebug("read() length 2bytes=0x%02X 0x%02X=>datalen=%d retCount=%d stat=%d", buf[0], buf[1], datalen, retCount, stat);
+
+    // Read trace data
+    qDebug("read() all trace data (max size=%d)", datalen + FORM1_RAW_SLACK);
+    stat = instr->read_to_file(form1_capture_filename, (U32)datalen + FORM1_RAW_SLACK, &retCount);
+    qDebug("read_to_file('%s') stat=%d retCount=%d", form1_capture_filename, stat, retCount);
+
+    if(retCount > 0)
+    {
+        sprintf(debug_info, "HP8753D FORM1 Captured to file %s size=%u", form1_capture_filename, retCount);
+        emit log(debug_info);
+    }else {
+        emit log("HP8753D FORM1 capture error");
+    }
+    //***********************
+    //********* FORM5 *******
+    // Select PC_FLOAT32 binary format
+    stat = instr->printf("FORM5;\n");
+    qDebug("FORM5; stat=%d", stat);
+    // Output error corrected data
+    stat = instr->printf("OUTPDATA;\n");
+    qDebug("OUTPDATA; stat=%d", stat);
+
+    // Read in the data header two characters and two bytes for length
+    // Read header as 2 byte string
+    memset(buf, 0, 3);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() hdr 2bytes=\"%s\"(expected \"#A\") stat=%d", buf, stat);
+    // Read length as 2 bytes integer
+    memset(buf, 0, 3);
+    stat = instr->read(buf, 2, &retCount);
+    datalen = (buf[1] << 8) + buf[0]; /* Little Endian Format */
+    qDebug("read() length 2bytes=0x%02X 0x%02X=>datalen=%d retCount=%d stat=%d", buf[0], buf[1], datalen, retCount, stat);
+
+    // Read trace data
+    qDebug("read() all trace data (max size=%d)", datalen + FORM1_RAW_SLACK);
+    stat = instr->read_to_file(form5_capture_filename, (U32)datalen + FORM1_RAW_SLACK, &retCount);
+    qDebug("read_to_file('%s') stat=%d retCount=%d", form5_capture_filename, stat, retCount);
+
+    if(retCount > 0)
+    {
+        sprintf(debug_info, "HP8753D FORM5 Captured to file %s size=%u", form5_capture_filename, retCount);
+        emit log(debug_info);
+    }else {
+        emit log("HP8753D FORM5 capture error");
+    }
+
+    restore_continuous_sweep();
+}
+
+void acquisition::capture_FORM4_raw()
+{
+    char debug_info[1024];
+    static U8 buf[262144] = { 0 };
+    U32 retCount;
+    VNA_STATUS stat;
+    char form4_capture_filename[] = { "vna_form4_data.txt" };
+
+    qDebug () << "capture_FORM4_raw";
+
+    if (!session_open(10000))
+    {
+        return;
+    }
+
+    instrument_setup(instr);
+
+    // Single sweep and wait
+    stat = instr->printf("OPC?;SING;\n");
+    qDebug("OPC?;SING stat=%d", stat);
+    // Read the 1 when complete
+    memset(buf, 0, 2);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() completed=\"%c\" (expected 1) retCount=%d stat=%d", buf[0], retCount, stat);
+
+    // Select form 4 ASCII format
+    stat = instr->printf("FORM4;\n");
+    qDebug("FORM4; stat=%d", stat);
+    // Send formatted trace to controller
+    stat = instr->printf("OUTPFORF;\n");
+    qDebug("OUTPFORM; stat=%d", stat);
+
+    // Read trace data
+    qDebug("read() all trace data (max size=%d)", sizeof(buf));
+    stat = instr->read_to_file(form4_capture_filename, sizeof(buf), &retCount);
+    qDebug("read_to_file('%s') stat=%d retCount=%d", form4_capture_filename, stat, retCount);
+
+    if(retCount > 0)
+    {
+        sprintf(debug_info, "HP8753D FORM4 Captured to file %s size=%u", form4_capture_filename, retCount);
+        emit log(debug_info);
+    }else {
+        emit log("HP8753D FORM4 capture error");
+    }
+    // Read number of points in the trace
+    qDebug("POIN?;");
+    stat = instr->printf("POIN?;\n");
+    // Read Nb Points
+    stat = instr->read(buf, sizeof(buf) - 1, &retCount);
+    buf[retCount] = 0;
+    qDebug("read() Num_points=%s retCount=%d stat=%d", buf, retCount, stat);
+
+    // Read the start frequency
+    qDebug("STAR?;");
+    stat = instr->printf("STAR?;\n");
+    // Read start frequency
+    stat = instr->read(buf, sizeof(buf) - 1, &retCount);
+    buf[retCount] = 0;
+    qDebug("read() Startf=%s retCount=%d stat=%d", buf, retCount, stat);
+
+    restore_continuous_sweep();
+}
+
+void acquisition::capture_FORM5_raw()
+{
+    char debug_info[1024];
+    U8 buf[4] = { 0 }; // Headers only, trace data is written to file by read_to_file()
+    U32 retCount;
+    VNA_STATUS stat;
+    int datalen;
+    char form5_capture_filename[] = { "vna_form5_PC_FLOAT32.bin" };
+
+    qDebug () << "capture_FORM5_raw";
+
+    if (!session_open(10000))
+    {
+        return;
+    }
+
+    instrument_setup(instr);
+
+    // Single sweep and wait
+    stat = instr->printf("OPC?;SING;\n");
+    qDebug("OPC?;SING stat=%d", stat);
+    // Read the 1 when complete
+    memset(buf, 0, 2);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() completed=\"%c\" (expected 1) retCount=%d stat=%d", buf[0], retCount, stat);
+
+    // Select PC_FLOAT32 binary format
+    stat = instr->printf("FORM5;\n");
+    qDebug("FORM5; stat=%d", stat);
+    // Output error corrected data
+    stat = instr->printf("OUTPDATA;\n");
+    qDebug("OUTPDATA; stat=%d", stat);
+
+    // Read in the data header two characters and two bytes for length
+    // Read header as 2 byte string
+    memset(buf, 0, 3);
+    stat = instr->read(buf, 2, &retCount);
+    qDebug("read() hdr 2bytes=\"%s\"(expected \"#A\") stat=%d", buf, stat);
+    // Read length as 2 bytes integer
+    memset(buf, 0, 3);
+    stat = instr->read(buf, 2, &retCount);
+    datalen = (buf[1] << 8) + buf[0]; /* Little Endian Format */
+    qDebug("read() length 2bytes=0x%02X 0x%02X=>datalen=%d retCount=%d stat=%d", buf[0], buf[1], datalen, retCount, stat);
+
+    // Read trace data
+    qDebug("read() all trace data (max size=%d)", datalen + FORM1_RAW_SLACK);
+    stat = instr->read_to_file(form5_capture_filename, (U32)datalen + FORM1_RAW_SLACK, &retCount);
+    qDebug("read_to_file('%s') stat=%d retCount=%d", form5_capture_filename, stat, retCount);
+
+    if(retCount > 0)
+    {
+        sprintf(debug_info, "HP8753D FORM5 Captured to file %s size=%u", form5_capture_filename, retCount);
+        emit log(debug_info);
+    }else {
+        emit log("HP8753D FORM5 capture error");
+    }
+
+    restore_continuous_sweep();
+}
+
+/*
+Read CENT/SPAN/STAR/STOP/POIN and the sweep type (LINFREQ?) in one round-trip (one command message,
+the 6 replies are queued by the analyzer and parsed with scanf_double()) instead of one printf/scanf
+turnaround per value.
+The result is cached for the next jobs of the session and sent to the GUI (stimulus_changed()).
+Parameters:
+const C8 *set_cmd => Stimulus commands sent in the same message before the queries (e.g. "STAR 1E6;STOP 2E9;")
+or NULL
+bool force => FALSE to return the cached stimulus when valid (no I/O), TRUE to always query the analyzer
+Return FALSE on I/O error or invalid number of points (cache not valid)
+*/
+bool acquisition::stimulus_query(const C8 *set_cmd, bool force)
+{
+    VNA_STATUS stat;
+    DOUBLE value[6] = { 0.0 };
+
+    if (stimulus_cached && (!force) && (set_cmd == NULL))
+    {
+        qDebug("stimulus_query() cached start_Hz=%lf stop_Hz=%lf nb_points=%d",
+               stimulus_start_Hz, stimulus_stop_Hz, stimulus_nb_points);
+        return TRUE;
+    }
+    stimulus_cached = FALSE;
+
+    stat = instr->printf("FORM4;%sCENT;OUTPACTI;SPAN;OUTPACTI;STAR;OUTPACTI;STOP;OUTPACTI;POIN;OUTPACTI;LINFREQ?;\n",
+                         (set_cmd != NULL) ? set_cmd : "");
+    qDebug("printf(\"FORM4;%sCENT/SPAN/STAR/STOP/POIN;OUTPACTI;LINFREQ?;\") stat=%d", (set_cmd != NULL) ? set_cmd : "", stat);
+    for (S32 i = 0; (i < 6) && (stat >= VNA_SUCCESS); i++)
+    {
+        stat = instr->scanf_double(&value[i]);
+    }
+    qDebug("scanf() center_Hz=%lf span_Hz=%lf start_Hz=%lf stop_Hz=%lf fn=%lf lin_sweep=%lf stat=%d",
+           value[0], value[1], value[2], value[3], value[4], value[5], stat);
+    if (stat < VNA_SUCCESS)
+    {
+        emit log("Error to read the stimulus (CENT/SPAN/STAR/STOP/POIN/LINFREQ?)");
+        return FALSE;
+    }
+
+    S32 nb_points = (S32)(value[4] + 0.5);
+    if ((nb_points < 1) || (nb_points > 1000000))
+    {
+        qDebug("Error n_points = %d\n", nb_points);
+        return FALSE;
+    }
+
+    instrument_check_stimulus(value[2], value[3], nb_points);
+    stimulus_center_Hz = value[0];
+    stimulus_span_Hz = value[1];
+    stimulus_lin_sweep = (value[5] > 0.5);
+    stimulus_cached = TRUE;
+
+    emit stimulus_changed(stimulus_center_Hz, stimulus_span_Hz, stimulus_start_Hz, stimulus_stop_Hz, stimulus_nb_points);
+
+    return TRUE;
+}
+
+// Explicit read (also used to resynchronize the GUI after a change from the front panel)
+void acquisition::stimulus_read()
+{
+    qDebug () << "stimulus_read Enter";
+
+    if (!session_open(2000))
+    {
+        return;
+    }
+
+    stimulus_query(NULL, TRUE);
+
+    qDebug () << "stimulus_read Exit";
+}
+
+/*
+Parameters:
+DOUBLE start_Hz => Start frequency in Hz
+DOUBLE stop_Hz => Stop frequency in Hz
+S32 nb_points => Number of points
+*/
+void acquisition::stimulus_write_start_stop(DOUBLE start_Hz, DOUBLE stop_Hz, S32 nb_points)
+{
+    C8 cmd[128];
+
+    qDebug () << "stimulus_write_start_stop Enter";
+
+    if (!session_open(2000))
+    {
+        return;
+    }
+
+    // Set Start/Stop frequency and trace length to nb_points, then read back CENT/SPAN/STAR/STOP/POIN
+    sprintf(cmd, "STAR %lf;STOP %lf;POIN %lf;", start_Hz, stop_Hz, (DOUBLE)nb_points);
+    instrument_invalidate_info();
+    stimulus_query(cmd);
+
+    qDebug () << "stimulus_write_start_stop Exit";
+}
+
+/*
+Parameters:
+DOUBLE center_Hz => Center frequency in Hz
+DOUBLE span_Hz => Span in Hz
+*/
+void acquisition::stimulus_write_center_span(DOUBLE center_Hz, DOUBLE span_Hz)
+{
+    C8 cmd[128];
+
+    qDebug () << "stimulus_write_center_span Enter";
+
+    if (!session_open(2000))
+    {
+        return;
+    }
+
+    // Set Center/Span, then read back CENT/SPAN/STAR/STOP/POIN
+    sprintf(cmd, "CENT %lf;SPAN %lf;", center_Hz, span_Hz);
+    instrument_invalidate_info();
+    stimulus_query(cmd);
+
+    qDebug () << "stimulus_write_center_span Exit";
+}
+
+/*
+Parameters:
+S32 nb_points => Number of points
+*/
+void acquisition::stimulus_write_nb_points(S32 nb_points)
+{
+    C8 cmd[64];
+
+    qDebug () << "stimulus_write_nb_points Enter";
+
+    if (!session_open(2000))
+    {
+        return;
+    }
+
+    // Set trace length to nb_points, then read back CENT/SPAN/STAR/STOP/POIN
+    sprintf(cmd, "POIN %lf;", (DOUBLE)nb_points);
+    instrument_invalidate_info();
+    stimulus_query(cmd);
+
+    qDebug () << "stimulus_write_nb_points Exit";
+}
@@ -0,0 +1,225 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "typedefs.h"
+#include "vna_transport.h"
+
+class capture_arena;
+class capture_pipeline;
+class capture_stream;
+class snp_pipeline;
+
+// Touchstone capture job configuration (filled by the GUI thread)
+typedef struct snp_capture_cfg
+{
+    S32 form; // 1 = FORM1 (Default), 4 = FORM4 or 5 = FORM5
+    S32 SnP; // 1 = S1P or 2 = S2P
+    C8 param[4]; // "" for S2P, "S11", "S21" or "S22" for S1P
+    C8 query[33]; // "OUTPDATA" (Default) or "OUTPFORM"
+    DOUBLE R_ohms; // 50.0
+    C8 data_format[3]; // S2P File Format "MA" Magnitude-angle or "DB" dB-angle or "RI" Real-imaginary
+    C8 freq_format[4]; // "Hz"(Default), "kHz", "MHz", "GHz"
+    S32 digits; // Touchstone values: 0 = "%lf" 6 decimals (Default) else 1 to 17 significant digits (see SPARAM::print_double())
+    S32 DC_entry; // 0 = None(Default)
+    bool single_sweep_S2P; // S2P: one sweep for the 4 parameters (correction ON) else one sweep per parameter
+    bool stream_drop_frames; // Stream: drop the frames the disk writer has no room for, else the sweeps wait
+    bool stream_archive; // Stream: all the sweeps in one "<name>.snpa" sweep archive (see SWEEP_ARCHIVE), else one file per sweep
+    QString filename; // Output filename (stream: "<name>_<sweep>.SnP" files or "<name>.snpa")
+} t_snp_capture_cfg;
+
+// Latest streamed sweep copied for the GUI (see acquisition::stream_latest())
+typedef struct stream_live
+{
+    U64 sweep; // Sweep number (from 1)
+    DOUBLE time_s; // Capture time since the stream start
+    S32 n_ports;
+    S32 n_points;
+    std::vector<DOUBLE> freq_Hz;
+    std::vector<COMPLEX_DOUBLE> trace[4]; // S11, S21, S12, S22 (S1P: trace[0] only)
+} t_stream_live;
+
+// Stage times of the last save_SnP() capture (ms)
+typedef struct capture_timing
+{
+    DOUBLE setup_ms; // instrument_setup() (instrument info cached by the previous captures of the session)
+    DOUBLE stimulus_ms; // STAR/STOP/POIN (cached by the previous captures of the session)
+    DOUBLE freq_axis_ms; // LINFREQ?/OUTPLIML
+    DOUBLE active_param_ms; // Active parameter queries
+    DOUBLE traces_ms; // Sweeps and transfers (decode/format overlapped by the capture pipeline)
+    DOUBLE decode_ms; // Decode/format not overlapped with the transfers
+    DOUBLE restore_ms; // Active parameter and continuous sweep restored
+    DOUBLE write_ms; // File write not overlapped with the restore
+    DOUBLE total_ms; // save_SnP_FORMx() including the stages above
+} t_capture_timing;
+
+/*
+Acquisition worker, lives in its own QThread (see MainWindow::MainWindow())
+All instrument I/O (vna_transport) is done here so the GUI thread never blocks.
+Jobs are posted with QMetaObject::invokeMethod(..., Qt::QueuedConnection) and run
+one after the other from the worker thread event loop (command queue).
+Log, progress and results are sent back to the GUI with queued signals.
+*/
+class acquisition : public QObject
+{
+    Q_OBJECT
+public:
+    explicit acquisition(QObject *parent = nullptr);
+    ~acquisition();
+
+    // Abort the capture in progress (thread safe, called from the GUI thread)
+    void cancel();
+
+    // Copy the latest streamed sweep if newer than live->sweep (thread safe, called from the GUI thread)
+    bool stream_latest(t_stream_live *live);
+
+    // Stage times of the last save_SnP() (read once the job is finished, see vna_capture)
+    t_capture_timing last_capture_timing(void) { return capture_timing; }
+
+    // Jobs (executed in the worker thread)
+    void set_resource(QString resource_str);
+    void gpib_info();
+    void preset();
+    void capture_FORM1_FORM5_raw();
+    void capture_FORM4_raw();
+    void capture_FORM5_raw();
+    void save_SnP(t_snp_capture_cfg cfg);
+    void stream_SnP(t_snp_capture_cfg cfg);
+    void stimulus_read();
+    void stimulus_write_start_stop(DOUBLE start_Hz, DOUBLE stop_Hz, S32 nb_points);
+    void stimulus_write_center_span(DOUBLE center_Hz, DOUBLE span_Hz);
+    void stimulus_write_nb_points(S32 nb_points);
+
+signals:
+    void log(QString text); // Text to append to the GUI log
+    void progress_changed(int value); // Capture progress in % (only emitted when it changes)
+    void save_SnP_finished(bool result);
+    void stream_finished(bool result);
+    void stimulus_changed(double center_Hz, double span_Hz, double start_Hz, double stop_Hz, int nb_points);
+
+private:
+    bool session_open(U32 timeout_ms);
+    void session_close(void);
+    void restore_continuous_sweep(void);
+    bool stimulus_query(const C8 *set_cmd = NULL, bool force = TRUE);
+
+    bool cancel_requested(void) { return cancel_request.load(); }
+    void update_progress(S32 value);
+
+    bool instrument_query_info(vna_transport *instr);
+    bool instrument_setup(vna_transport *instr, bool force_query_info = FALSE);
+    bool instrument_check_stimulus(DOUBLE start_Hz, DOUBLE stop_Hz, S32 nb_points);
+    void instrument_invalidate_info(void);
+
+    bool S2P_single_sweep(vna_transport *instr, qint64 *sweep_ms);
+    bool read_freq_axis(vna_transport *instr, DOUBLE start_Hz, DOUBLE stop_Hz, DOUBLE *freq_Hz, S32 n);
+    S32 active_param_query(vna_transport *instr);
+    bool stream_run(vna_transport *instr, const t_snp_capture_cfg *cfg);
+    void S2P_report_time(bool single_sweep, qint64 sweep_ms, qint64 total_ms);
+
+    capture_arena *capture_buffers(S32 n_ports, S32 n_points, U32 raw_bytes);
+    bool read_trace_pipeline(snp_pipeline *snp, S32 form, vna_transport *instr, C8 *param, C8 *query,
+                             COMPLEX_DOUBLE *trace, S32 col, S32 progress_fraction, bool sweep);
+
+    bool read_complex_trace_FORM4(vna_transport *instr,
+                            C8             *param,
+                            C8             *query,
+                            COMPLEX_DOUBLE *dest,
+                            S32             cnt,
+                            S32             progress_fraction,
+                            bool            sweep,
+                            capture_pipeline *pipe,
+                            U8             *raw,
+                            U32             raw_size);
+    bool read_complex_trace_FORM1(vna_transport *instr,
+                            C8             *param,
+                            C8             *query,
+                            COMPLEX_DOUBLE *dest,
+                            S32             cnt,
+                            S32             progress_fraction,
+                            bool            sweep,
+                            capture_pipeline *pipe,
+                            U8             *raw,
+                            U32             raw_size);
+    bool read_complex_trace_FORM5(vna_transport *instr,
+                            C8             *param,
+                            C8             *query,
+                            COMPLEX_DOUBLE *dest,
+                            S32             cnt,
+                            S32             progress_fraction,
+                            bool            sweep,
+                            capture_pipeline *pipe);
+
+    bool save_SnP_FORMx(vna_transport *instr,
+                  S32       form,
+                  S32       SnP,
+                  C8       *param,
+                  C8       *query,
+                  DOUBLE    R_ohms,
+                  const C8 *data_format,
+                  const C8 *freq_format,
+                  S32       digits,
+                  S32       DC_entry,
+                  const C8 *explicit_filename,
+                  bool      single_sweep_S2P);
+
+    // Persistent session (opened by the first job, kept until the resource changes or an error)
+    C8 resource[256]; // VISA resource string or "SIM::8753..." (simulated instrument)
+    vna_transport *instr;
+    capture_arena *arena; // Capture buffers (sized from POIN, reused by the next captures)
+    capture_stream *stream; // Streaming capture frames (allocated by the first stream, reused by the next ones)
+    std::mutex stream_lock; // stream frames realloc vs stream_latest() copy
+    bool session_clear_needed; // clear() before next job (previous one aborted or in error)
+
+    std::atomic<bool> cancel_request;
+    S32 progress_value; // Last value sent with progress_changed()
+
+    // Instrument info cached by instrument_setup() until the stimulus changes
+    bool instrument_info_valid;
+    bool stimulus_valid;
+    DOUBLE stimulus_start_Hz;
+    DOUBLE stimulus_stop_Hz;
+    S32 stimulus_nb_points;
+    C8 instrument_name[512];
+    C8 instrument_opts[128]; // OUTPOPTS => ASCII Options
+    C8 instrument_if_bandwidth[48]; // IFBW? => "IF bandwidth: %.lf Hz"
+    C8 instrument_smoothing[16]; // SMOOO? => "Smoothing ON" or "Smoothing OFF"
+    C8 instrument_averaging[16]; // AVERO? => "Averaging ON" or "Averaging OFF"
+    C8 instrument_correction[16]; // CORR? => "Correction ON" or "Correction OFF"
+    C8 instrument_out_power_level[48]; // POWE? => "Output power level: %.6lf dBm"
+
+    // Stimulus state read by stimulus_query() (CENT/SPAN/STAR/STOP/POIN/LINFREQ? in one round-trip)
+    // kept until the session is closed/cleared, a preset or a stimulus write
+    bool stimulus_cached;
+    DOUBLE stimulus_center_Hz;
+    DOUBLE stimulus_span_Hz;
+    bool stimulus_lin_sweep; // LINFREQ? (FALSE for a log or list frequency sweep)
+
+    // Frequency axis of the last capture (see read_freq_axis()), same lifetime as the stimulus state
+    // and only reused for the same start/stop/points/sweep type
+    bool freq_axis_valid;
+    DOUBLE freq_axis_start_Hz;
+    DOUBLE freq_axis_stop_Hz;
+    S32 freq_axis_nb_points;
+    bool freq_axis_lin_sweep;
+    std::vector<DOUBLE> freq_axis;
+
+    t_capture_timing capture_timing; // Filled by save_SnP_FORMx()
+    //bool debug_mode = TRUE;
+    bool debug_mode = FALSE;
+};
+
+const char VISA_GPIB_RES_STR[]= { "GPIB0::16::INSTR" }; // Default VISA resource
+
+#define FORM4_READ_CHUNK (65536) // viRead() size used to read FORM4 ASCII trace data
+#define FORM1_RAW_SLACK (16) // FORM1 transfer buffer margin (trailing bytes after the data)
+#define STREAM_FRAME_SLOTS (16) // Streaming capture frames queued for the disk writer
+#define STREAM_STATS_MS (2000) // Streaming capture rate/counters log period
+
+#endif // ACQUISITION_H
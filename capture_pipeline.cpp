@@ -0,0 +1,173 @@
+#include "capture_pipeline.h"
+
+#include <QDebug>
+
+capture_pipeline::capture_pipeline() :
+    quit(FALSE),
+    busy(FALSE),
+    failed(FALSE)
+{
+    t0 = std::chrono::steady_clock::now();
+    worker = std::thread(&capture_pipeline::worker_loop, this);
+}
+
+capture_pipeline::~capture_pipeline()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = TRUE;
+    }
+    job_cond.notify_one();
+    worker.join();
+}
+
+void capture_pipeline::start(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    t0 = std::chrono::steady_clock::now();
+    stages.clear();
+    failed = FALSE;
+}
+
+U64 capture_pipeline::now_us(void)
+{
+    return (U64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Called with lock held
+S32 capture_pipeline::add_stage(const C8 *name, bool worker, U64 start_us)
+{
+    t_stage s;
+
+    memset(s.name, 0, sizeof(s.name));
+    _snprintf(s.name, sizeof(s.name) - 1, "%s", name);
+    s.worker = worker;
+    s.start_us = start_us;
+    s.end_us = start_us;
+    stages.push_back(s);
+
+    return (S32)stages.size() - 1;
+}
+
+S32 capture_pipeline::stage_begin(const C8 *name)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return add_stage(name, FALSE, now_us());
+}
+
+void capture_pipeline::stage_end(S32 id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if ((id >= 0) && (id < (S32)stages.size()))
+    {
+        stages[id].end_us = now_us();
+    }
+}
+
+void capture_pipeline::submit(const C8 *name, std::function<bool(void)> job)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        t_job j;
+        j.stage_id = add_stage(name, TRUE, now_us());
+        j.func = job;
+        jobs.push_back(j);
+    }
+    job_cond.notify_one();
+}
+
+bool capture_pipeline::wait(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    done_cond.wait(guard, [this]() { return jobs.empty() && !busy; });
+
+    return !failed;
+}
+
+void capture_pipeline::worker_loop(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    for (;;)
+    {
+        job_cond.wait(guard, [this]() { return quit || !jobs.empty(); });
+        if (jobs.empty())
+        {
+            break; // quit
+        }
+
+        t_job j = jobs.front();
+        jobs.pop_front();
+        bool skip = failed;
+        busy = TRUE;
+        stages[j.stage_id].start_us = now_us();
+        guard.unlock();
+
+        bool result = skip ? FALSE : j.func();
+
+        guard.lock();
+        stages[j.stage_id].end_us = now_us();
+        if (!result)
+        {
+            if (!skip)
+            {
+                qDebug("capture_pipeline job %s error, next jobs skipped", stages[j.stage_id].name);
+            }
+            failed = TRUE;
+        }
+        busy = FALSE;
+        if (jobs.empty())
+        {
+            done_cond.notify_all();
+        }
+    }
+}
+
+void capture_pipeline::report(C8 *text, S32 text_size)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    U64 end_us = 0;
+    U64 io_us = 0;
+    U64 io_end_us = 0;
+    U64 worker_us = 0;
+    U64 overlap_us = 0;
+
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        const t_stage *s = &stages[i];
+
+        qDebug(" pipeline [%s] %-24s start=%8.1f ms end=%8.1f ms (%.1f ms)", s->worker ? "worker" : "acq   ", s->name,
+               s->start_us / 1000.0, s->end_us / 1000.0, (s->end_us - s->start_us) / 1000.0);
+        end_us = max(end_us, s->end_us);
+        if (!s->worker)
+        {
+            io_us += s->end_us - s->start_us;
+            io_end_us = max(io_end_us, s->end_us);
+            continue;
+        }
+        worker_us += s->end_us - s->start_us;
+
+        // Acquisition thread stages are sequential so the overlap is the sum of the intersections
+        for (size_t k = 0; k < stages.size(); k++)
+        {
+            const t_stage *io = &stages[k];
+            if (io->worker)
+            {
+                continue;
+            }
+            U64 start = max(s->start_us, io->start_us);
+            U64 end = min(s->end_us, io->end_us);
+            if (end > start)
+            {
+                overlap_us += end - start;
+            }
+        }
+    }
+
+    memset(text, 0, text_size);
+    _snprintf(text, text_size - 1,
+              "Pipeline: total %.1f ms, instrument I/O %.1f ms, decode/format/write %.1f ms (%.1f ms overlapped with I/O), %.1f ms after last transfer",
+              end_us / 1000.0, io_us / 1000.0, worker_us / 1000.0, overlap_us / 1000.0,
+              (end_us > io_end_us) ? ((end_us - io_end_us) / 1000.0) : 0.0);
+}
@@ -0,0 +1,82 @@
+#ifndef CAPTURE_PIPELINE_H
+#define CAPTURE_PIPELINE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "typedefs.h"
+
+/*
+Capture pipeline
+Jobs (trace decode, Touchstone formatting, file write) are run in order by a worker thread
+while the acquisition thread sweeps/transfers the next S-parameter.
+Every stage is timed (acquisition thread stages with stage_begin()/stage_end(), worker jobs
+automatically) relative to start() so the overlap with the instrument I/O is shown by report().
+*/
+#define CAPTURE_PIPELINE_STAGE_NAME_SIZE (32)
+
+class capture_pipeline
+{
+public:
+    capture_pipeline();
+    ~capture_pipeline(); // Wait end of the queued jobs
+
+    void start(void);
+
+    // Acquisition thread stage (sweep, transfer ...), return the id to give to stage_end()
+    S32 stage_begin(const C8 *name);
+    void stage_end(S32 id);
+
+    /*
+    Queue a job run by the worker thread (in submit order)
+    A job returns FALSE on error, the next jobs are then skipped
+    */
+    void submit(const C8 *name, std::function<bool(void)> job);
+
+    // Wait end of all the queued jobs, return FALSE if a job failed
+    bool wait(void);
+
+    /*
+    Log every stage (thread, start, end) with qDebug and write a one line summary in text
+    (total time, instrument I/O time, worker time and the part of it overlapped with the I/O)
+    */
+    void report(C8 *text, S32 text_size);
+
+private:
+    typedef struct stage
+    {
+        C8 name[CAPTURE_PIPELINE_STAGE_NAME_SIZE];
+        bool worker;
+        U64 start_us;
+        U64 end_us;
+    } t_stage;
+
+    typedef struct job
+    {
+        S32 stage_id;
+        std::function<bool(void)> func;
+    } t_job;
+
+    U64 now_us(void);
+    S32 add_stage(const C8 *name, bool worker, U64 start_us);
+    void worker_loop(void);
+
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable job_cond; // New job or quit
+    std::condition_variable done_cond; // Queue empty and worker idle
+    std::deque<t_job> jobs;
+    bool quit;
+    bool busy;
+    bool failed;
+
+    std::vector<t_stage> stages;
+    std::chrono::steady_clock::time_point t0;
+};
+
+#endif // CAPTURE_PIPELINE_H
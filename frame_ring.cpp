@@ -0,0 +1,148 @@
+#include "frame_ring.h"
+
+#include <chrono>
+#include <thread>
+
+frame_ring::frame_ring() :
+    n_slots(1),
+    policy(FRAME_RING_BLOCK)
+{
+    reset(1, FRAME_RING_BLOCK);
+}
+
+void frame_ring::reset(S32 n_slots, FRAME_RING_POLICY policy)
+{
+    this->n_slots = max(1, min(n_slots, FRAME_RING_MAX_SLOTS));
+    this->policy = policy;
+    head = 0;
+    tail = 0;
+    closed = FALSE;
+    last_slot = -1;
+    for (S32 i = 0; i <= FRAME_RING_MAX_SLOTS; i++)
+    {
+        seq[i] = 0;
+    }
+    published_cnt = 0;
+    dropped_cnt = 0;
+    blocked_us_cnt = 0;
+    live_skipped_cnt = 0;
+}
+
+S32 frame_ring::acquire(const std::atomic<bool> *cancel)
+{
+    S32 slot;
+    std::chrono::steady_clock::time_point wait_start;
+    bool waited = FALSE;
+
+    for (;;)
+    {
+        U64 h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) < (U64)n_slots)
+        {
+            slot = (S32)(h % (U64)n_slots);
+            break;
+        }
+        if (policy == FRAME_RING_DROP)
+        {
+            slot = n_slots; // Spare slot, only seen by the live consumer
+            dropped_cnt.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        if ((cancel != nullptr) && cancel->load())
+        {
+            slot = -1;
+            break;
+        }
+        if (!waited)
+        {
+            wait_start = std::chrono::steady_clock::now();
+            waited = TRUE;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_RING_POLL_MS));
+    }
+
+    if (waited)
+    {
+        blocked_us_cnt.fetch_add((U64)std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - wait_start).count(),
+                                 std::memory_order_relaxed);
+    }
+    if (slot >= 0)
+    {
+        // Odd sequence while the frame is written (a live copy in progress is then discarded)
+        seq[slot].store(seq[slot].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    return slot;
+}
+
+void frame_ring::publish(S32 slot)
+{
+    seq[slot].store(seq[slot].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    if (slot < n_slots)
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    last_slot.store(slot, std::memory_order_release);
+    published_cnt.fetch_add(1, std::memory_order_relaxed);
+}
+
+void frame_ring::close(void)
+{
+    closed.store(TRUE, std::memory_order_release);
+}
+
+S32 frame_ring::next(void)
+{
+    U64 t = tail.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        bool end = closed.load(std::memory_order_acquire);
+        if (head.load(std::memory_order_acquire) > t)
+        {
+            return (S32)(t % (U64)n_slots);
+        }
+        if (end)
+        {
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_RING_POLL_MS));
+    }
+}
+
+void frame_ring::release(void)
+{
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+S32 frame_ring::latest(U64 *seq)
+{
+    S32 slot = last_slot.load(std::memory_order_acquire);
+
+    if (slot < 0)
+    {
+        return -1;
+    }
+    *seq = this->seq[slot].load(std::memory_order_acquire);
+    if (*seq & 1)
+    {
+        live_skipped_cnt.fetch_add(1, std::memory_order_relaxed);
+        return -1; // Rewritten right now
+    }
+
+    return slot;
+}
+
+bool frame_ring::latest_valid(S32 slot, U64 seq)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (this->seq[slot].load(std::memory_order_relaxed) != seq)
+    {
+        live_skipped_cnt.fetch_add(1, std::memory_order_relaxed);
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,75 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+
+#include "typedefs.h"
+
+/*
+Lock-free frame ring used by the streaming capture (see acquisition::stream_SnP())
+Only the slot indexes are managed here, the frames (n_slots + 1) are preallocated by the owner.
+One producer (acquisition thread) and two independent consumers:
+- disk consumer: every frame in publish order (next()/release()). When it is n_slots frames behind,
+  the producer waits (FRAME_RING_BLOCK, backpressure on the sweeps) or the frame is dropped for the
+  disk (FRAME_RING_DROP, counted) and written in the spare slot (index n_slots) instead.
+- live consumer (GUI): latest published frame only (latest()/latest_valid()), it never holds the producer.
+  Each slot has a sequence number (odd while the producer writes it) so a frame rewritten during the
+  copy is detected and skipped (seqlock).
+The waits (ring full/empty) poll every FRAME_RING_POLL_MS, a sweep takes tens of ms at least.
+*/
+enum FRAME_RING_POLICY
+{
+    FRAME_RING_BLOCK = 0, // Producer waits for the disk consumer
+    FRAME_RING_DROP       // Producer never waits, frames the disk consumer has no room for are dropped
+};
+
+#define FRAME_RING_MAX_SLOTS (64)
+#define FRAME_RING_POLL_MS (1)
+
+class frame_ring
+{
+public:
+    frame_ring();
+
+    // No producer/consumer shall run, n_slots = 1 to FRAME_RING_MAX_SLOTS (n_slots + 1 frames)
+    void reset(S32 n_slots, FRAME_RING_POLICY policy);
+
+    // Producer: slot to fill (-1 if *cancel is set while waiting), then publish() it
+    S32 acquire(const std::atomic<bool> *cancel);
+    void publish(S32 slot);
+    void close(void); // No more frames, next() returns -1 when the queued frames are consumed
+
+    // Disk consumer: slot of the next frame (waits, -1 when closed and empty), then release() it
+    S32 next(void);
+    void release(void);
+
+    // Live consumer: slot of the latest frame (-1 if none), then latest_valid() after the copy
+    S32 latest(U64 *seq);
+    bool latest_valid(S32 slot, U64 seq);
+
+    // Counters (any thread)
+    U64 published(void) { return published_cnt.load(std::memory_order_relaxed); }
+    U64 queued(void) { return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed); }
+    U64 consumed(void) { return tail.load(std::memory_order_relaxed); }
+    U64 dropped(void) { return dropped_cnt.load(std::memory_order_relaxed); }
+    U64 blocked_us(void) { return blocked_us_cnt.load(std::memory_order_relaxed); }
+    U64 live_skipped(void) { return live_skipped_cnt.load(std::memory_order_relaxed); }
+    S32 capacity(void) { return n_slots; }
+
+private:
+    S32 n_slots;
+    FRAME_RING_POLICY policy;
+
+    std::atomic<U64> head; // Frames queued for the disk consumer (producer)
+    std::atomic<U64> tail; // Frames released by the disk consumer
+    std::atomic<bool> closed;
+    std::atomic<S32> last_slot; // Latest published frame (-1 = none)
+    std::atomic<U64> seq[FRAME_RING_MAX_SLOTS + 1];
+
+    std::atomic<U64> published_cnt;
+    std::atomic<U64> dropped_cnt;
+    std::atomic<U64> blocked_us_cnt;
+    std::atomic<U64> live_skipped_cnt;
+};
+
+#endif // FRAME_RING_H
@@ -7,15 +7,25 @@
 //  
 /*********************************************************************/
 #include "typedefs.h"
+#include "trace_decode.h"
+
+#include <QFile>
+
+#include <thread>
+#include <vector>
 
 #define MAX_PATH (260)
 
+#define SPARAMS_ALIGN (64) // Cache line alignment of the SPARAMS arrays (see SPARAMS::alloc())
+#define SPARAMS_ALIGN_SIZE(x) (((size_t)(x) + SPARAMS_ALIGN - 1) & ~((size_t)SPARAMS_ALIGN - 1))
+
 namespace SNPTYPE       // Flags used to indicate which format(s) are cached in database
 {
     const U8 MA = 0x01;  // Magnitude-angle form is valid
     const U8 DB = 0x02;  // dB-angle form is valid
     const U8 RI = 0x04;  // Real-imag form is valid
     const U8 CZ = 0x08;  // Complex impedance (R+jX) is valid (conversion based on real part of Zo)
+    const U8 ALL = MA | DB | RI | CZ;
 }
 
 namespace SPARAM
@@ -121,314 +131,1002 @@ namespace SPARAM
         jX = (2.0 * MA.mag * sin(r) * Ro) / (1.0 + mm - (2.0 * MA.mag * cos(r)));
     }
 
-    enum MSGLVL
-    {
-        MSG_DEBUG = 0,    // Debugging traffic
-        MSG_VERBOSE,      // Low-level notice
-        MSG_NOTICE,       // Standard notice
-        MSG_WARNING,      // Warning
-        MSG_ERROR         // Error
-    };
-
-    const U8 EXT_ZERO = 0x01;        // Frequency-based queries outside min/max range return valid zero magnitude and phase
-    const U8 EXT_LEND = 0x02;        // Frequency-based queries below min return valid min endpoint
-    const U8 EXT_REND = 0x04;        // Frequency-based queries above max return valid max endpoint
-    const U8 EXT_ENDS = EXT_LEND | EXT_REND;
-
-    const U32 BIN_ID = 'BPNS';      // Binary stream identifier 'SNPB' (little-endian)
-    const U32 BIN_VERSION = 0x00000001;  // Binary stream version written by this implementation
-
-    const C8 *DEF_DATA_FORMAT = "MA";        // Default format for .S2P file writes
-    const C8 *DEF_FREQ_FORMAT = "GHZ";
-}
-
-struct SPARAMS
-{
-    C8             message_text[4096];     // Error/warning text buffer for optional app access
-
-    S32            n_ports;                // Matrix dimensions S[m][m], currently must be either 1 or 2
-    S32            n_points;
-
-    DOUBLE         min_Hz;                 // Valid after read_SNP_file() or application-specific setup
-    DOUBLE         max_Hz;                 // Application can access these variables (and the arrays below) directly
-    COMPLEX_DOUBLE Zo;
-
-    DOUBLE        *freq_Hz;                // [n_points]
-    U8          ***valid;                  // [b][a][n_points]
-    SPARAM::MA  ***MA;                     // [b][a][n_points]
-    SPARAM::DB  ***DB;
-    SPARAM::RI  ***RI;
-    SPARAM::CZ  ***CZ;
-
     // --------------------------------------------------------------------------------------------------
-    // Error/status message sink can be subclassed if desired
-    // to redirect output
+    // Whole trace conversion kernels (n points, src and dest must not overlap)
+    //
+    // CONV_EXACT uses the per point constructors above (libm), results are identical to the
+    // get_xx() accessors.
+    // CONV_FAST uses branch free polynomial approximations the compiler can vectorize:
+    //   atan2: Cephes rational approximation after reduction to [0, tan(PI/8)]
+    //   log10: exponent/mantissa split, atanh series of the mantissa in [sqrt(0.5), sqrt(2)]
+    //   10^x:  2^n scaling, exp() Taylor series on [-ln(2)/2, ln(2)/2]
+    //   sincos: reduction in degrees to [-45, 45] (exact), Taylor series
+    // Measured max error versus libm (1M points, 1E-12 to 1E+3 magnitudes, any angle):
+    //   angle 2.8E-14 deg, dB 5.7E-14 dB, relative magnitude/real/imag 4E-15, relative R/jX 2.5E-13
+    // The 6 decimals Touchstone text (text_digits = 0) only differs when a value is within this error of a
+    // last digit rounding boundary: about 1 value in 10^7 (none in 1M points of each kernel). More
+    // text_digits show the differences.
+    // Inputs must be finite, dB inputs are clamped to [-6000, +6000].
     // --------------------------------------------------------------------------------------------------
+    const U8 CONV_EXACT = 0;
+    const U8 CONV_FAST = 1;
 
-    virtual void message_sink(SPARAM::MSGLVL level,
-            C8            *text)
+    const DOUBLE FAST_ROUND = 6755399441055744.0;   // 2^52 + 2^51: (x + FAST_ROUND) rounds x to an integer held in the low mantissa bits
+
+    inline U64 fast_bits(DOUBLE x)
     {
-        Q_UNUSED(level);
-        ::printf("%s\n", text);
+        U64 u;
+        memcpy(&u, &x, sizeof(u));
+        return u;
     }
 
-    virtual void message_printf(SPARAM::MSGLVL level,
-            C8            *fmt,
-            ...)
+    inline DOUBLE fast_double(U64 u)
     {
-        Q_UNUSED(level);
-        va_list ap;
-
-        va_start(ap,
-                fmt);
-
-        _vsnprintf(message_text,
-                sizeof(message_text) - 1,
-                fmt,
-                ap);
+        DOUBLE x;
+        memcpy(&x, &u, sizeof(x));
+        return x;
+    }
 
-        va_end(ap);
+    inline DOUBLE fast_atan2_deg(DOUBLE y, DOUBLE x)
+    {
+        DOUBLE ax = fabs(x);
+        DOUBLE ay = fabs(y);
+        DOUBLE mx = (ax > ay) ? ax : ay;
+        DOUBLE mn = (ax > ay) ? ay : ax;
+        DOUBLE t = mn / ((mx > 0.0) ? mx : 1.0);                 // [0, 1]
+
+        bool big = (t > 0.41421356237309504880);                 // tan(PI/8)
+        DOUBLE tr = (t - 1.0) / (t + 1.0);                       // atan(t) = 45 deg + atan((t - 1) / (t + 1))
+        t = big ? tr : t;                                        // (both computed, no branch)
+
+        DOUBLE z = t * t;
+        DOUBLE p = (((-8.750608600031904122785E-1 * z - 1.615753718733365076637E1) * z - 7.500855792314704667340E1) * z
+                    - 1.228866684490136173410E2) * z - 6.485021904942025371773E1;
+        DOUBLE q = ((((z + 2.485846490142306297962E1) * z + 1.650270098316988542046E2) * z + 4.328810604912902668951E2) * z
+                    + 4.853903996359136964868E2) * z + 1.945506571482613964425E2;
+        DOUBLE deg = (t + t * z * p / q) * RAD2DEG + (big ? 45.0 : 0.0);
+
+        deg = (ay > ax) ? (90.0 - deg) : deg;
+        deg = (x < 0.0) ? (180.0 - deg) : deg;
+
+        return copysign(deg, y);
+    }
 
-        //
-        // Remove trailing whitespace
-        //
-        C8 *end = &message_text[strlen(message_text) - 1];
+    inline DOUBLE fast_log10(DOUBLE x)                               // x > 0, normal
+    {
+        U64 u = fast_bits(x);
+        DOUBLE e = fast_double(0x4330000000000000ULL | (u >> 52)) - 4503599627371519.0;   // Exponent (2^52 + 1023 bias trick)
+        DOUBLE m = fast_double((u & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL);       // [1, 2)
 
-        while (end > message_text)
-        {
-            if (!isspace((U8)*end))
-            {
-                break;
-            }
+        bool high = (m > 1.41421356237309504880);
+        m = high ? (m * 0.5) : m;
+        DOUBLE ex = e + (high ? 1.0 : 0.0);
 
-            *end = 0;
-            end--;
-        }
+        DOUBLE s = (m - 1.0) / (m + 1.0);                        // ln(m) = 2 atanh(s), |s| < 0.1716
+        DOUBLE z = s * s;
+        DOUBLE r = ((((((((z * (1.0 / 17.0) + 1.0 / 15.0) * z + 1.0 / 13.0) * z + 1.0 / 11.0) * z + 1.0 / 9.0) * z
+                    + 1.0 / 7.0) * z + 1.0 / 5.0) * z + 1.0 / 3.0) * z + 1.0) * (2.0 * s);
 
-        message_sink(level,
-                message_text);
+        return ex * 0.30102999566398119521 + r * 0.43429448190325182765;
     }
 
-    // --------------------------------------------------------------------------------------------------
-    // Construction/destruction
-    // --------------------------------------------------------------------------------------------------
-    SPARAMS()
+    inline DOUBLE fast_exp10(DOUBLE x)                               // |x| <= 300
     {
-        init();
+        DOUBLE l = x * 3.32192809488736234787;                   // log2(10)
+        DOUBLE k = l + FAST_ROUND;
+        U64 n = fast_bits(k);
+        DOUBLE g = (l - (k - FAST_ROUND)) * 0.69314718055994530942;  // |g| <= ln(2)/2
+
+        DOUBLE r = ((((((((((((g * (1.0 / 6227020800.0) + 1.0 / 479001600.0) * g + 1.0 / 39916800.0) * g + 1.0 / 3628800.0) * g
+                    + 1.0 / 362880.0) * g + 1.0 / 40320.0) * g + 1.0 / 5040.0) * g + 1.0 / 720.0) * g + 1.0 / 120.0) * g
+                    + 1.0 / 24.0) * g + 1.0 / 6.0) * g + 0.5) * g + 1.0) * g + 1.0;
+
+        return r * fast_double((n + 1023) << 52);                // 2^n (n in the low mantissa bits of k)
     }
 
-    virtual ~SPARAMS()
+    inline void fast_sincos_deg(DOUBLE deg, DOUBLE *s, DOUBLE *c)
     {
-        clear();
+        DOUBLE k = deg * (1.0 / 90.0) + FAST_ROUND;
+        U64 quadrant = fast_bits(k);                             // n (deg = n * 90 + r) in the low mantissa bits
+        DOUBLE r = (deg - (k - FAST_ROUND) * 90.0) * DEG2RAD;    // |r| <= PI/4
+        DOUBLE z = r * r;
+
+        DOUBLE sr = r * (((((((z * (-1.0 / 1307674368000.0) + 1.0 / 6227020800.0) * z - 1.0 / 39916800.0) * z + 1.0 / 362880.0) * z
+                    - 1.0 / 5040.0) * z + 1.0 / 120.0) * z - 1.0 / 6.0) * z + 1.0);
+        DOUBLE cr = (((((((z * (1.0 / 20922789888000.0) - 1.0 / 87178291200.0) * z + 1.0 / 479001600.0) * z - 1.0 / 3628800.0) * z
+                    + 1.0 / 40320.0) * z - 1.0 / 720.0) * z + 1.0 / 24.0) * z - 0.5) * z + 1.0;
+
+        // Quadrant swap and signs with bit masks (64-bit integer compares are not available to the SSE2 vectorizer)
+        U64 odd = 0 - (quadrant & 1);
+        U64 sq = (fast_bits(cr) & odd) | (fast_bits(sr) & ~odd);
+        U64 cq = (fast_bits(sr) & odd) | (fast_bits(cr) & ~odd);
+
+        *s = fast_double(sq ^ ((quadrant & 2) << 62));
+        *c = fast_double(cq ^ (((quadrant + 1) & 2) << 62));
     }
 
-    // --------------------------------------------------------------------------------------------------
-    // Set construction defaults
-    // --------------------------------------------------------------------------------------------------
-    virtual void init(void)
+    void RI_to_MA(const RI *src, MA *dest, S32 n, U8 mode)
     {
-        memset(message_text, 0, sizeof(message_text));
+        if (mode == CONV_EXACT)
+        {
+            for (S32 i = 0; i < n; i++) dest[i] = MA(src[i]);
+            return;
+        }
 
-        n_ports = 0;
-        n_points = 0;
-        min_Hz = DBL_MAX;
-        max_Hz = -DBL_MAX;
-        Zo = 50.0;
-        valid = NULL;
-        freq_Hz = NULL;
-        MA = NULL;
-        DB = NULL;
-        RI = NULL;
-        CZ = NULL;
+        for (S32 i = 0; i < n; i++)
+        {
+            DOUBLE re = src[i].real;
+            DOUBLE im = src[i].imag;
+            DOUBLE mag = sqrt(re*re + im*im);
+
+            DOUBLE deg = fast_atan2_deg(im, re);
+
+            dest[i].mag = mag;
+            dest[i].deg = (mag > 1E-20) ? deg : 0.0;
+        }
     }
 
-    // --------------------------------------------------------------------------------------------------
-    // Discard existing database
-    // --------------------------------------------------------------------------------------------------
-    virtual void clear(void)
+    void RI_to_DB(const RI *src, DB *dest, S32 n, U8 mode)
     {
-        FREE(freq_Hz);
+        if (mode == CONV_EXACT)
+        {
+            for (S32 i = 0; i < n; i++) dest[i] = DB(src[i]);
+            return;
+        }
 
-        for (S32 b = 0; b < n_ports; b++)
+        for (S32 i = 0; i < n; i++)
         {
-            for (S32 a = 0; a < n_ports; a++)
-            {
-                if ((valid != NULL) && (valid[b] != NULL)) FREE(valid[b][a]);
+            DOUBLE re = src[i].real;
+            DOUBLE im = src[i].imag;
+            DOUBLE dB = 10.0 * fast_log10(max(1E-30, re*re + im*im));    // 20 log10(max(1E-15, |RI|))
+            DOUBLE deg = fast_atan2_deg(im, re);
 
-                if ((MA != NULL) && (MA[b] != NULL)) FREE(MA[b][a]);
-                if ((DB != NULL) && (DB[b] != NULL)) FREE(DB[b][a]);
-                if ((RI != NULL) && (RI[b] != NULL)) FREE(RI[b][a]);
-                if ((CZ != NULL) && (CZ[b] != NULL)) FREE(CZ[b][a]);
-            }
+            dest[i].dB = dB;
+            dest[i].deg = (dB > -200.0) ? deg : 0.0;
+        }
+    }
 
-            if (valid != NULL) FREE(valid[b]);
-            if (MA != NULL)    FREE(MA[b]);
-            if (DB != NULL)    FREE(DB[b]);
-            if (RI != NULL)    FREE(RI[b]);
-            if (CZ != NULL)    FREE(CZ[b]);
+    void MA_to_RI(const MA *src, RI *dest, S32 n, U8 mode)
+    {
+        if (mode == CONV_EXACT)
+        {
+            for (S32 i = 0; i < n; i++) dest[i] = RI(src[i]);
+            return;
         }
 
-        FREE(valid);
-        FREE(MA);
-        FREE(DB);
-        FREE(RI);
-        FREE(CZ);
+        for (S32 i = 0; i < n; i++)
+        {
+            DOUBLE s, c;
+            fast_sincos_deg(src[i].deg, &s, &c);
 
-        n_ports = 0;
-        n_points = 0;
+            dest[i].real = c * src[i].mag;
+            dest[i].imag = s * src[i].mag;
+        }
     }
 
-    // --------------------------------------------------------------------------------------------------
-    // Reserve specified number of ports (typically 1 or 2) and data points
-    // --------------------------------------------------------------------------------------------------
-    virtual bool alloc(S32 ports, S32 points)
+    void DB_to_RI(const DB *src, RI *dest, S32 n, U8 mode)
     {
-        if ((points == 0) || (ports == 0))
+        if (mode == CONV_EXACT)
         {
-            message_printf(SPARAM::MSG_ERROR, (C8*)"Empty data set");
-            return FALSE;
+            for (S32 i = 0; i < n; i++) dest[i] = RI(src[i]);
+            return;
         }
 
-        if ((n_ports != 0) || (n_points != 0))
+        for (S32 i = 0; i < n; i++)
         {
-            clear();
-        }
-
-        n_ports = ports;
-        n_points = points;
+            DOUBLE s, c;
+            fast_sincos_deg(src[i].deg, &s, &c);
+            DOUBLE mag = fast_exp10(min(6000.0, max(-6000.0, src[i].dB)) / 20.0);
 
-        freq_Hz = (DOUBLE *)calloc(n_points, sizeof(freq_Hz[0]));
+            dest[i].real = c * mag;
+            dest[i].imag = s * mag;
+        }
+    }
 
-        if (freq_Hz == NULL)
+    void MA_to_DB(const MA *src, DB *dest, S32 n, U8 mode)
+    {
+        if (mode == CONV_EXACT)
         {
-            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
-            return FALSE;
+            for (S32 i = 0; i < n; i++) dest[i] = DB(src[i]);
+            return;
         }
 
-        valid = (U8 ***)calloc(n_points, sizeof(valid[0]));
+        for (S32 i = 0; i < n; i++)
+        {
+            dest[i].dB = 20.0 * fast_log10(max(1E-15, src[i].mag));
+            dest[i].deg = src[i].deg;
+        }
+    }
 
-        MA = (SPARAM::MA ***) calloc(n_ports, sizeof(MA[0]));
-        DB = (SPARAM::DB ***) calloc(n_ports, sizeof(DB[0]));
-        RI = (SPARAM::RI ***) calloc(n_ports, sizeof(RI[0]));
-        CZ = (SPARAM::CZ ***) calloc(n_ports, sizeof(CZ[0]));
+    void DB_to_MA(const DB *src, MA *dest, S32 n, U8 mode)
+    {
+        if (mode == CONV_EXACT)
+        {
+            for (S32 i = 0; i < n; i++) dest[i] = MA(src[i]);
+            return;
+        }
 
-        if ((valid == NULL) || (MA == NULL) || (DB == NULL) || (RI == NULL) || (CZ == NULL))
+        for (S32 i = 0; i < n; i++)
         {
-            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
-            return FALSE;
+            dest[i].mag = fast_exp10(min(6000.0, max(-6000.0, src[i].dB)) / 20.0);
+            dest[i].deg = src[i].deg;
         }
+    }
 
-        for (S32 b = 0; b < n_ports; b++)
+    void MA_to_CZ(const MA *src, CZ *dest, S32 n, DOUBLE Ro, U8 mode)
+    {
+        if (mode == CONV_EXACT)
         {
-            valid[b] = (U8 **)calloc(n_ports, sizeof(valid[0][0]));
+            for (S32 i = 0; i < n; i++) dest[i] = CZ(src[i], Ro);
+            return;
+        }
 
-            MA[b] = (SPARAM::MA **) calloc(n_ports, sizeof(MA[0][0]));
-            DB[b] = (SPARAM::DB **) calloc(n_ports, sizeof(DB[0][0]));
-            RI[b] = (SPARAM::RI **) calloc(n_ports, sizeof(RI[0][0]));
-            CZ[b] = (SPARAM::CZ **) calloc(n_ports, sizeof(CZ[0][0]));
+        for (S32 i = 0; i < n; i++)
+        {
+            DOUBLE s, c;
+            fast_sincos_deg(src[i].deg, &s, &c);
+            DOUBLE mag = src[i].mag;
+            DOUBLE mm = mag * mag;
+            DOUBLE d = 1.0 + mm - (2.0 * mag * c);
 
-            if ((valid[b] == NULL) || (MA[b] == NULL) || (DB[b] == NULL) || (RI[b] == NULL) || (CZ[b] == NULL))
-            {
-                message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
-                return FALSE;
-            }
+            dest[i].R = ((1.0 - mm) * Ro) / d;
+            dest[i].jX = (2.0 * mag * s * Ro) / d;
+        }
+    }
 
-            for (S32 a = 0; a < n_ports; a++)
-            {
-                valid[b][a] = (U8 *)calloc(n_points, sizeof(valid[0][0][0]));
+    enum MSGLVL
+    {
+        MSG_DEBUG = 0,    // Debugging traffic
+        MSG_VERBOSE,      // Low-level notice
+        MSG_NOTICE,       // Standard notice
+        MSG_WARNING,      // Warning
+        MSG_ERROR         // Error
+    };
 
-                MA[b][a] = (SPARAM::MA *) calloc(n_points, sizeof(MA[0][0][0]));
-                DB[b][a] = (SPARAM::DB *) calloc(n_points, sizeof(DB[0][0][0]));
-                RI[b][a] = (SPARAM::RI *) calloc(n_points, sizeof(RI[0][0][0]));
-                CZ[b][a] = (SPARAM::CZ *) calloc(n_points, sizeof(CZ[0][0][0]));
+    const U8 EXT_ZERO = 0x01;        // Frequency-based queries outside min/max range return valid zero magnitude and phase
+    const U8 EXT_LEND = 0x02;        // Frequency-based queries below min return valid min endpoint
+    const U8 EXT_REND = 0x04;        // Frequency-based queries above max return valid max endpoint
+    const U8 EXT_ENDS = EXT_LEND | EXT_REND;
 
-                if ((valid[b][a] == NULL) || (MA[b][a] == NULL) || (DB[b][a] == NULL) || (RI[b][a] == NULL) || (CZ[b][a] == NULL))
-                {
-                    message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
-                    return FALSE;
-                }
-            }
-        }
-        return TRUE;
-    }
+    const U32 BIN_ID = 'BPNS';      // Binary stream identifier 'SNPB' (little-endian)
+    const U32 BIN_VERSION = 0x00000002;  // Binary stream version written by this implementation
+    const U32 BIN_VERSION_1 = 0x00000001; // All the formats of every parameter (still readable)
 
     // --------------------------------------------------------------------------------------------------
-    // Serialize to binary block
-    //
-    //   Header: U8  identifier[4] 'SNPB'
-    //           U32 version
-    //           S32 n_data_bytes (not including header)
+    // SNPB v2 block (see SPARAMS::serialize())
     //
-    // Contents: ...
-    //           Version-specific data
-    //           ...
-    //
-    // Caller must free the returned block
+    //   BIN_HEADER, BIN_SECTION[n_sections], then the sections: one array of n_points elements per
+    //   section, each one at a SPARAMS_ALIGN aligned offset from the start of the block so a mapped
+    //   file can be used in place (see SPARAMS::attach())
     // --------------------------------------------------------------------------------------------------
+    const U32 BIN_SECTION_FREQ = 0x100;      // freq_Hz[n_points]
+    const U32 BIN_SECTION_VALID = 0x200;     // valid[b][a][n_points]
+                                             // SNPTYPE::RI/MA/DB/CZ: RI[b][a][n_points]...
+#pragma pack(push,1)
+    struct BIN_HEADER
+    {
+        U32 ID;                 // BIN_ID              (ID, version and n_data_bytes: same as v1)
+        U32 version;            // BIN_VERSION
+        S32 n_data_bytes;       // Block size - 12 (not including ID, version and n_data_bytes)
+        U32 header_bytes;       // sizeof(BIN_HEADER)
+        S32 n_ports;
+        S32 n_points;
+        U32 n_sections;
+        U32 forms;              // SNPTYPE formats stored (RI always, MA/DB/CZ cached forms)
+        DOUBLE min_Hz;
+        DOUBLE max_Hz;
+        DOUBLE Zo_real;
+        DOUBLE Zo_imag;
+    };
+
+    struct BIN_SECTION
+    {
+        U32 type;               // BIN_SECTION_FREQ, BIN_SECTION_VALID or SNPTYPE::xx
+        S32 b;
+        S32 a;
+        U32 reserved;
+        U64 offset;             // From the start of the block (SPARAMS_ALIGN aligned)
+        U64 bytes;
+    };
+#pragma pack(pop)
 
-    virtual U8 *serialize(S32 *output_bytes)
+    inline size_t bin_element_size(U32 type)
     {
-        S32 n_data_bytes = 0;
+        switch (type)
+        {
+            case BIN_SECTION_FREQ:  return sizeof(DOUBLE);
+            case BIN_SECTION_VALID: return sizeof(U8);
+            case SNPTYPE::MA:       return sizeof(SPARAM::MA);
+            case SNPTYPE::DB:       return sizeof(SPARAM::DB);
+            case SNPTYPE::RI:       return sizeof(SPARAM::RI);
+            case SNPTYPE::CZ:       return sizeof(SPARAM::CZ);
+        }
+        return 0;
+    }
 
-        n_data_bytes += sizeof(n_ports);
-        n_data_bytes += sizeof(n_points);
-        n_data_bytes += sizeof(min_Hz);
-        n_data_bytes += sizeof(max_Hz);
-        n_data_bytes += sizeof(Zo);
+    // Fill the next section entry, returns its array in block
+    inline U8 *bin_section(U8 *block, BIN_SECTION *section, U32 type, S32 b, S32 a, S32 n_points, U64 *offset)
+    {
+        section->type = type;
+        section->b = b;
+        section->a = a;
+        section->reserved = 0;
+        section->offset = *offset;
+        section->bytes = (U64)n_points * bin_element_size(type);
+
+        *offset += SPARAMS_ALIGN_SIZE(section->bytes);
+        return block + section->offset;
+    }
 
-        n_data_bytes += n_points * sizeof(freq_Hz[0]);
+    const U8 RESAMPLE_LINEAR = 0;           // SPARAMS::resample(): linear as get_RI(Hz)/get_DB(Hz)
+    const U8 RESAMPLE_SPLINE = 1;           // SPARAMS::resample(): natural spline as spline_dB()/spline_deg()
+    const S32 RESAMPLE_MAX_PARAMS = 16;     // SPARAMS::resample(): up to 4 ports
+    const S32 RESAMPLE_THREAD_POINTS = 32768; // SPARAMS::resample(): minimum destination points per thread
 
-        S32 mat_size = n_ports * n_ports * n_points;      // 1 for S1P, 4 for S2P, 9 for S3P...
+    const C8 *DEF_DATA_FORMAT = "MA";        // Default format for .S2P file writes
+    const C8 *DEF_FREQ_FORMAT = "GHZ";
 
-        n_data_bytes += mat_size * sizeof(valid[0][0][0]);
-        n_data_bytes += mat_size * sizeof(MA[0][0][0]);
-        n_data_bytes += mat_size * sizeof(DB[0][0][0]);
-        n_data_bytes += mat_size * sizeof(RI[0][0][0]);
-        n_data_bytes += mat_size * sizeof(CZ[0][0][0]);
+    // --------------------------------------------------------------------------------------------------
+    // Fast double to text for the Touchstone writers
+    //
+    //   digits = 0:       same text as "%lf" (6 decimals, default)
+    //   digits = 1 to 17: same text as "%.<digits>lg" (significant digits, 17 = round trip)
+    //
+    // |v| * 10^decimals is rounded exactly with integer arithmetic (mantissa * 10^decimals / 2^exponent,
+    // ties to even as the C library does) so the text is identical to printf().
+    // Values without a 20 digits fixed notation (|v| >= 1.8E13 for "%lf", exponent notation for
+    // "%lg"), Inf and NaN are written with snprintf().
+    // --------------------------------------------------------------------------------------------------
+    const S32 TEXT_MAX_DIGITS = 17;
+    const S32 TEXT_MAX_VALUE = DBL_MAX_10_EXP + 32;      // Worst case length of one value ("%lf" of DBL_MAX)
+    const U32 TEXT_BUFFER_SIZE = 256 * 1024;             // write_SNP_file() output block
 
-        S32 n_block_bytes = sizeof(SPARAM::BIN_ID) +
-                sizeof(SPARAM::BIN_VERSION) +
-                sizeof(n_data_bytes) +
-                n_data_bytes;
+    const U64 TEXT_POW10[20] =
+    {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+        10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+        1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+        10000000000000000000ULL
+    };
 
-        U8 *block = (U8 *)malloc(n_block_bytes);
+    // Round |v| * 10^decimals (decimals 0 to 19) to the nearest integer, FALSE if not finite or >= 2^64
+    inline bool text_scale_round(DOUBLE v, S32 decimals, U64 *result)
+    {
+        U64 bits = fast_bits(v);
+        S32 E = (S32)((bits >> 52) & 0x7FF);
+        U64 M = bits & 0x000FFFFFFFFFFFFFULL;
 
-        if (block == NULL)
+        if (E == 0x7FF)
         {
-            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
-            return NULL;
+            return FALSE;
+        }
+        if (E == 0)
+        {
+            E = 1;                                               // Denormal
         }
+        else
+        {
+            M |= 0x0010000000000000ULL;
+        }
+        S32 s = 1075 - E;                                        // |v| = M / 2^s
 
-        U8 *block_start = block;
+        //
+        // 128 bit product M * 10^decimals (hi:lo)
+        //
+        U64 P = TEXT_POW10[decimals];
+        U64 p0 = (M & 0xFFFFFFFF) * (P & 0xFFFFFFFF);
+        U64 p1 = (M & 0xFFFFFFFF) * (P >> 32);
+        U64 p2 = (M >> 32) * (P & 0xFFFFFFFF);
+        U64 p3 = (M >> 32) * (P >> 32);
+        U64 mid = (p0 >> 32) + (p1 & 0xFFFFFFFF) + (p2 & 0xFFFFFFFF);
+        U64 lo = (mid << 32) | (p0 & 0xFFFFFFFF);
+        U64 hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+
+        if (s <= 0)
+        {
+            if ((hi != 0) || (s <= -64) || ((s < 0) && ((lo >> (64 + s)) != 0)))
+            {
+                return FALSE;
+            }
+            *result = lo << -s;
+            return TRUE;
+        }
 
-        memcpy(block, &SPARAM::BIN_ID, sizeof(SPARAM::BIN_ID));      block += sizeof(SPARAM::BIN_ID);
-        memcpy(block, &SPARAM::BIN_VERSION, sizeof(SPARAM::BIN_VERSION)); block += sizeof(SPARAM::BIN_VERSION);
-        memcpy(block, &n_data_bytes, sizeof(n_data_bytes));        block += sizeof(n_data_bytes);
+        if (s >= 128)
+        {
+            *result = 0;                                         // M * 10^19 < 2^117, so < 0.5
+            return TRUE;
+        }
 
-        memcpy(block, &n_ports, sizeof(n_ports));   block += sizeof(n_ports);
-        memcpy(block, &n_points, sizeof(n_points));  block += sizeof(n_points);
-        memcpy(block, &min_Hz, sizeof(min_Hz));    block += sizeof(min_Hz);
-        memcpy(block, &max_Hz, sizeof(max_Hz));    block += sizeof(max_Hz);
-        memcpy(block, &Zo, sizeof(Zo));        block += sizeof(Zo);
+        //
+        // Quotient, round bit (bit s - 1) and sticky bits (below s - 1) of (hi:lo) / 2^s
+        //
+        U64 q;
+        if (s < 64)
+        {
+            if ((hi >> s) != 0)
+            {
+                return FALSE;
+            }
+            q = (lo >> s) | (hi << (64 - s));
+        }
+        else
+        {
+            q = (s == 64) ? hi : (hi >> (s - 64));
+        }
 
-        memcpy(block, &freq_Hz[0], n_points * sizeof(freq_Hz[0])); block += n_points * sizeof(freq_Hz[0]);
+        S32 r = s - 1;
+        bool round_bit = (r < 64) ? ((lo >> r) & 1) : ((hi >> (r - 64)) & 1);
+        bool sticky;
+        if (r < 64)
+        {
+            sticky = (r > 0) && ((lo & ((1ULL << r) - 1)) != 0);
+        }
+        else
+        {
+            sticky = (lo != 0) || ((r > 64) && ((hi & ((1ULL << (r - 64)) - 1)) != 0));
+        }
 
-        for (S32 b = 0; b < n_ports; b++)
+        if (round_bit && (sticky || (q & 1)))
         {
-            for (S32 a = 0; a < n_ports; a++)
+            if (q == ~0ULL)
             {
-                memcpy(block, &valid[b][a][0], n_points * sizeof(valid[b][a][0])); block += n_points * sizeof(valid[b][a][0]);
-                memcpy(block, &MA[b][a][0], n_points * sizeof(MA[b][a][0])); block += n_points * sizeof(MA[b][a][0]);
-                memcpy(block, &DB[b][a][0], n_points * sizeof(DB[b][a][0])); block += n_points * sizeof(DB[b][a][0]);
-                memcpy(block, &RI[b][a][0], n_points * sizeof(RI[b][a][0])); block += n_points * sizeof(RI[b][a][0]);
-                memcpy(block, &CZ[b][a][0], n_points * sizeof(CZ[b][a][0])); block += n_points * sizeof(CZ[b][a][0]);
+                return FALSE;
             }
+            q++;
         }
 
-        assert(block - block_start == n_block_bytes);
+        *result = q;
+        return TRUE;
+    }
+
+    // Write m / 10^decimals in fixed notation, optionally without the fraction trailing zeros ("%g")
+    inline S32 text_fixed(C8 *dest, bool negative, U64 m, S32 decimals, bool strip_zeros)
+    {
+        C8 digits[24];
+        S32 n = 0;
+        S32 len = 0;
+
+        do
+        {
+            digits[n++] = (C8)('0' + (m % 10));
+            m /= 10;
+        }
+        while (m != 0);
+
+        while (n <= decimals)
+        {
+            digits[n++] = '0';
+        }
+
+        S32 first = 0;                                           // Lowest fraction digit written
+        if (strip_zeros)
+        {
+            while ((first < decimals) && (digits[first] == '0'))
+            {
+                first++;
+            }
+        }
+
+        if (negative)
+        {
+            dest[len++] = '-';
+        }
+        for (S32 i = n - 1; i >= decimals; i--)
+        {
+            dest[len++] = digits[i];
+        }
+        if (first < decimals)
+        {
+            dest[len++] = '.';
+            for (S32 i = decimals - 1; i >= first; i--)
+            {
+                dest[len++] = digits[i];
+            }
+        }
+
+        return len;
+    }
+
+    // Returns the number of characters written to dest (TEXT_MAX_VALUE max, not 0 terminated)
+    inline S32 print_double(C8 *dest, DOUBLE v, S32 digits)
+    {
+        bool negative = (fast_bits(v) >> 63) != 0;
+        U64 m;
+
+        if (digits <= 0)
+        {
+            if (text_scale_round(v, 6, &m))
+            {
+                return text_fixed(dest, negative, m, 6, FALSE);
+            }
+            return snprintf(dest, TEXT_MAX_VALUE + 1, "%lf", v);
+        }
+
+        digits = min(digits, TEXT_MAX_DIGITS);
+
+        if (v == 0.0)
+        {
+            return text_fixed(dest, negative, 0, 0, TRUE);
+        }
+
+        //
+        // "%g" uses the fixed notation with digits - 1 - X decimals when the exponent X of the value
+        // rounded to digits significant digits is in [-4, digits - 1]
+        //
+        S32 X = (S32)floor(log10(fabs(v)));                     // Estimate (log10() result can be rounded up to X + 1)
+        if ((X >= -5) && (X <= digits))
+        {
+            for (S32 retry = 0; retry < 3; retry++)
+            {
+                S32 decimals = digits - 1 - X;
+                if ((decimals < 0) || (decimals > 19) || !text_scale_round(v, decimals, &m))
+                {
+                    break;
+                }
+                if (m >= TEXT_POW10[digits])
+                {
+                    X++;
+                    continue;
+                }
+                if (m < TEXT_POW10[digits - 1])
+                {
+                    X--;
+                    continue;
+                }
+
+                //
+                // 10^(digits - 1) is either the value rounded up to the next power of 10 (X is right)
+                // or an estimate one too high: then the value is below 10^digits with one more decimal
+                //
+                if (m == TEXT_POW10[digits - 1])
+                {
+                    U64 m_low;
+                    if ((decimals >= 19) || !text_scale_round(v, decimals + 1, &m_low))
+                    {
+                        break;
+                    }
+                    if (m_low < TEXT_POW10[digits])
+                    {
+                        X--;
+                        decimals++;
+                        m = m_low;
+                    }
+                }
+
+                if ((X >= -4) && (X < digits))
+                {
+                    return text_fixed(dest, negative, m, decimals, TRUE);
+                }
+                break;
+            }
+        }
+
+        return snprintf(dest, TEXT_MAX_VALUE + 1, "%.*lg", digits, v);
+    }
+
+    // Touchstone row value pair "v0 v1 " (2 * TEXT_MAX_VALUE + 2 max, not 0 terminated), returns the number of
+    // characters written. Same text in write_SNP_file() and the capture writer (acquisition.cpp snp_text_columns)
+    inline S32 print_pair(C8 *dest, DOUBLE v0, DOUBLE v1, S32 digits)
+    {
+        S32 len = print_double(dest, v0, digits);
+        dest[len++] = ' ';
+        len += print_double(&dest[len], v1, digits);
+        dest[len++] = ' ';
+        return len;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Text to double for the Touchstone reader
+    //
+    // Decimal numbers followed by a space (or the end of the text) are converted by parse_ascii_double()
+    // (trace_decode.h, correctly rounded, same parser as the FORM4 traces).
+    // Other numbers (inf, nan, hex, not followed by a space) are converted with strtod().
+    // Returns the number of characters used from p (0 if there is no number at p, end excluded)
+    // --------------------------------------------------------------------------------------------------
+    inline S32 text_parse_double(const C8 *p, const C8 *end, DOUBLE *v)
+    {
+        const C8 *start = p;
+
+        if ((p < end) && (((U8)(*p - '0') <= 9) || (*p == '-') || (*p == '+') || (*p == '.')))
+        {
+            const C8 *number_end = parse_ascii_double(p, end, v);
+            if ((number_end != nullptr) && ((number_end == end) || isspace((U8)*number_end)))
+            {
+                return (S32)(number_end - start);
+            }
+        }
+
+        //
+        // strtod() of a 0 terminated copy (the text is not terminated, e.g. mapped file)
+        //
+        C8 token[1024];
+        S32 len = 0;
+        p = start;
+        while ((p < end) && (len < (S32)sizeof(token) - 1) && !isspace((U8)*p))
+        {
+            token[len++] = *p++;
+        }
+        token[len] = 0;
+
+        C8 *token_end = token;
+        *v = strtod(token, &token_end);
+        return (S32)(token_end - token);
+    }
+}
+
+struct SPARAMS
+{
+    C8             message_text[4096];     // Error/warning text buffer for optional app access
+    C8             sanitize_text[2048];    // sanitize() result (file header, see write_SNP_header())
+
+    S32            n_ports;                // Matrix dimensions S[m][m], currently must be either 1 or 2
+    S32            n_points;
+
+    DOUBLE         min_Hz;                 // Valid after read_SNP_file() or application-specific setup
+    DOUBLE         max_Hz;                 // Application can access these variables (and the arrays below) directly
+    COMPLEX_DOUBLE Zo;
+
+    DOUBLE        *freq_Hz;                // [n_points]
+    U8          ***valid;                  // [b][a][n_points]
+    SPARAM::MA  ***MA;                     // [b][a][n_points] (NULL if not stored, see alloc())
+    SPARAM::DB  ***DB;
+    SPARAM::RI  ***RI;                     // Always stored
+    SPARAM::CZ  ***CZ;
+
+    U8            *arena;                  // Single allocation holding all the arrays above
+    QFile         *mapped_file;            // SNPB v2 file the arrays point into (see read_SNPB_file()), else NULL
+    U8             forms;                  // SNPTYPE formats stored in arena
+    U8             conversion_mode;        // SPARAM::CONV_EXACT (default) or SPARAM::CONV_FAST, used by write_SNP_file() and resample()
+    S32            text_digits;            // write_SNP_file() values: 0 = "%lf" (default) else 1 to 17 significant digits (see SPARAM::print_double())
+
+    SPLINE_PLAN    spline_plan[2];         // spline_dB() magnitude / spline_deg() phase, solved once per trace (see spline_trace())
+    S32            spline_param[2];        // b * n_ports + a of spline_plan[] (-1 = not solved, see spline_invalidate())
+    DOUBLE        *spline_Hz;              // spline_dB()/spline_deg() grid if out_Hz is NULL (reused, only grown)
+    S32            spline_Hz_size;
+    SPLINE_PLAN   *resample_plans;         // resample() SPARAM::RESAMPLE_SPLINE traces [param][real, imag, mag, deg]
+    S32            resample_n_plans;       // Plans allocated in resample_plans
+    bool           resample_solved;        // resample_plans solved from the current data (see spline_invalidate())
+    S32            freq_grid;              // freq_Hz spacing: -1 = not checked, 0 = any, 1 = uniform (see freq_grid_check())
+    DOUBLE         freq_step_inv;          // 1 / step of a uniform freq_Hz
+
+    // --------------------------------------------------------------------------------------------------
+    // Error/status message sink can be subclassed if desired
+    // to redirect output
+    // --------------------------------------------------------------------------------------------------
+
+    virtual void message_sink(SPARAM::MSGLVL level,
+            C8            *text)
+    {
+        Q_UNUSED(level);
+        ::printf("%s\n", text);
+    }
+
+    virtual void message_printf(SPARAM::MSGLVL level,
+            C8            *fmt,
+            ...)
+    {
+        Q_UNUSED(level);
+        va_list ap;
+
+        va_start(ap,
+                fmt);
+
+        _vsnprintf(message_text,
+                sizeof(message_text) - 1,
+                fmt,
+                ap);
+
+        va_end(ap);
+
+        //
+        // Remove trailing whitespace
+        //
+        C8 *end = &message_text[strlen(message_text) - 1];
+
+        while (end > message_text)
+        {
+            if (!isspace((U8)*end))
+            {
+                break;
+            }
+
+            *end = 0;
+            end--;
+        }
+
+        message_sink(level,
+                message_text);
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Construction/destruction
+    // --------------------------------------------------------------------------------------------------
+    SPARAMS()
+    {
+        init();
+    }
+
+    virtual ~SPARAMS()
+    {
+        clear();
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Set construction defaults
+    // --------------------------------------------------------------------------------------------------
+    virtual void init(void)
+    {
+        memset(message_text, 0, sizeof(message_text));
+
+        n_ports = 0;
+        n_points = 0;
+        min_Hz = DBL_MAX;
+        max_Hz = -DBL_MAX;
+        Zo = 50.0;
+        valid = NULL;
+        freq_Hz = NULL;
+        MA = NULL;
+        DB = NULL;
+        RI = NULL;
+        CZ = NULL;
+        arena = NULL;
+        mapped_file = NULL;
+        forms = 0;
+        conversion_mode = SPARAM::CONV_EXACT;
+        text_digits = 0;
+        spline_param[0] = spline_param[1] = -1;
+        spline_Hz = NULL;
+        spline_Hz_size = 0;
+        resample_plans = NULL;
+        resample_n_plans = 0;
+        resample_solved = FALSE;
+        freq_grid = -1;
+        freq_step_inv = 0.0;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Discard existing database
+    // --------------------------------------------------------------------------------------------------
+    virtual void clear(void)
+    {
+        FREE(arena);
+
+        if (mapped_file != NULL)
+        {
+            delete mapped_file;         // Unmaps the file
+            mapped_file = NULL;
+        }
+
+        freq_Hz = NULL;
+        valid = NULL;
+        MA = NULL;
+        DB = NULL;
+        RI = NULL;
+        CZ = NULL;
+        forms = 0;
+
+        FREE(spline_Hz);
+        spline_Hz_size = 0;
+        delete[] resample_plans;
+        resample_plans = NULL;
+        resample_n_plans = 0;
+        spline_invalidate();
+        freq_grid = -1;
+
+        n_ports = 0;
+        n_points = 0;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Discard the spline plans of spline_dB()/spline_deg()/resample() (done by clear() and set_RI(), must be
+    // called by the application after writing the arrays directly)
+    // --------------------------------------------------------------------------------------------------
+    virtual void spline_invalidate(void)
+    {
+        spline_param[0] = -1;
+        spline_param[1] = -1;
+        resample_solved = FALSE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Carve a [b][a] pointer table (from *table) and its n_ports * n_ports arrays of n_points
+    // elements (from *data, each one SPARAMS_ALIGN aligned) out of the arena
+    // --------------------------------------------------------------------------------------------------
+    void **arena_matrix(void ***table, U8 **data, size_t elem_size)
+    {
+        void **rows = *table;
+        *table += n_ports;
+
+        for (S32 b = 0; b < n_ports; b++)
+        {
+            void **cols = *table;
+            *table += n_ports;
+            rows[b] = cols;
+
+            for (S32 a = 0; a < n_ports; a++)
+            {
+                cols[a] = *data;
+                *data += SPARAMS_ALIGN_SIZE(elem_size * n_points);
+            }
+        }
+
+        return rows;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Reserve specified number of ports (typically 1 or 2) and data points
+    //
+    // All the arrays come from one zeroed allocation (arena): pointer tables, then freq_Hz and one
+    // contiguous cache aligned [n_points] array per format and parameter, so S.RI[b][a][pt] access
+    // and the accessors are unchanged.
+    // Derived formats (MA, DB, CZ) are only stored when requested in store_forms, the get_xx()
+    // accessors convert from RI without caching otherwise. RI is always stored.
+    // --------------------------------------------------------------------------------------------------
+    virtual bool alloc(S32 ports, S32 points, U8 store_forms = SNPTYPE::ALL)
+    {
+        if ((points == 0) || (ports == 0))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Empty data set");
+            return FALSE;
+        }
+
+        if ((n_ports != 0) || (n_points != 0) || (arena != NULL) || (mapped_file != NULL))
+        {
+            clear();
+        }
+
+        store_forms |= SNPTYPE::RI;
+
+        S32 n_params = ports * ports;
+        size_t table_bytes = SPARAMS_ALIGN_SIZE(5 * (ports + n_params) * sizeof(void *));
+        size_t data_bytes = SPARAMS_ALIGN_SIZE(points * sizeof(freq_Hz[0]));
+
+        data_bytes += n_params * SPARAMS_ALIGN_SIZE(points * sizeof(U8));
+        data_bytes += n_params * SPARAMS_ALIGN_SIZE(points * sizeof(SPARAM::RI));
+        if (store_forms & SNPTYPE::MA) data_bytes += n_params * SPARAMS_ALIGN_SIZE(points * sizeof(SPARAM::MA));
+        if (store_forms & SNPTYPE::DB) data_bytes += n_params * SPARAMS_ALIGN_SIZE(points * sizeof(SPARAM::DB));
+        if (store_forms & SNPTYPE::CZ) data_bytes += n_params * SPARAMS_ALIGN_SIZE(points * sizeof(SPARAM::CZ));
+
+        arena = (U8 *)calloc(table_bytes + data_bytes + SPARAMS_ALIGN, 1);
+
+        if (arena == NULL)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+            return FALSE;
+        }
+
+        n_ports = ports;
+        n_points = points;
+        forms = store_forms;
+        freq_grid = -1;
+
+        void **table = (void **)SPARAMS_ALIGN_SIZE((uintptr_t)arena);
+        U8 *data = (U8 *)table + table_bytes;
+
+        freq_Hz = (DOUBLE *)data;
+        data += SPARAMS_ALIGN_SIZE(points * sizeof(freq_Hz[0]));
+
+        valid = (U8 ***)arena_matrix(&table, &data, sizeof(U8));
+        RI = (SPARAM::RI ***)arena_matrix(&table, &data, sizeof(SPARAM::RI));
+        if (forms & SNPTYPE::MA) MA = (SPARAM::MA ***)arena_matrix(&table, &data, sizeof(SPARAM::MA));
+        if (forms & SNPTYPE::DB) DB = (SPARAM::DB ***)arena_matrix(&table, &data, sizeof(SPARAM::DB));
+        if (forms & SNPTYPE::CZ) CZ = (SPARAM::CZ ***)arena_matrix(&table, &data, sizeof(SPARAM::CZ));
+
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Serialize to binary block
+    //
+    //   Header: U8  identifier[4] 'SNPB'
+    //           U32 version
+    //           S32 n_data_bytes (not including header)
+    //
+    // Contents: ...
+    //           Version-specific data (v2: see SPARAM::BIN_HEADER)
+    //           ...
+    //
+    // Only the canonical RI form is written (converted from the valid format of each point) plus the
+    // formats of cache_forms (SNPTYPE::MA/DB/CZ) which are stored (see alloc())
+    //
+    // Caller must free the returned block
+    // --------------------------------------------------------------------------------------------------
 
-        *output_bytes = n_block_bytes;
-        return block_start;
+    virtual U8 *serialize(S32 *output_bytes, U8 cache_forms = 0)
+    {
+        U8 file_forms = SNPTYPE::RI | (cache_forms & forms & (SNPTYPE::MA | SNPTYPE::DB | SNPTYPE::CZ));
+        U32 n_param_sections = 1;                                // valid, then one per format
+        U64 param_bytes = SPARAMS_ALIGN_SIZE(n_points * sizeof(U8));
+
+        for (U8 f = SNPTYPE::MA; f <= SNPTYPE::CZ; f <<= 1)
+        {
+            if (file_forms & f)
+            {
+                n_param_sections++;
+                param_bytes += SPARAMS_ALIGN_SIZE(n_points * SPARAM::bin_element_size(f));
+            }
+        }
+
+        U32 n_sections = 1 + n_ports * n_ports * n_param_sections;
+        U64 data_offset = SPARAMS_ALIGN_SIZE(sizeof(SPARAM::BIN_HEADER) + n_sections * sizeof(SPARAM::BIN_SECTION));
+        U64 n_block_bytes = data_offset + SPARAMS_ALIGN_SIZE(n_points * sizeof(freq_Hz[0])) + n_ports * n_ports * param_bytes;
+
+        if (n_block_bytes > 0x7FFFFFFF)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Data set too large for SNPB block");
+            return NULL;
+        }
+
+        U8 *block = (U8 *)calloc((size_t)n_block_bytes, 1);
+
+        if (block == NULL)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+            return NULL;
+        }
+
+        SPARAM::BIN_HEADER *H = (SPARAM::BIN_HEADER *)block;
+        SPARAM::BIN_SECTION *section = (SPARAM::BIN_SECTION *)(block + sizeof(SPARAM::BIN_HEADER));
+
+        H->ID = SPARAM::BIN_ID;
+        H->version = SPARAM::BIN_VERSION;
+        H->n_data_bytes = (S32)(n_block_bytes - 12);
+        H->header_bytes = sizeof(SPARAM::BIN_HEADER);
+        H->n_ports = n_ports;
+        H->n_points = n_points;
+        H->n_sections = n_sections;
+        H->forms = file_forms;
+        H->min_Hz = min_Hz;
+        H->max_Hz = max_Hz;
+        H->Zo_real = Zo.real;
+        H->Zo_imag = Zo.imag;
+
+        U64 offset = data_offset;
+
+        memcpy(SPARAM::bin_section(block, section++, SPARAM::BIN_SECTION_FREQ, 0, 0, n_points, &offset),
+               freq_Hz, n_points * sizeof(freq_Hz[0]));
+
+        for (S32 b = 0; b < n_ports; b++)
+        {
+            for (S32 a = 0; a < n_ports; a++)
+            {
+                U8 *v = SPARAM::bin_section(block, section++, SPARAM::BIN_SECTION_VALID, b, a, n_points, &offset);
+                SPARAM::RI *ri = (SPARAM::RI *)SPARAM::bin_section(block, section++, SNPTYPE::RI, b, a, n_points, &offset);
+
+                //
+                // Canonical RI (points never written are left at zero, not valid)
+                //
+                if (trace_forms(b, a) & (SNPTYPE::RI | SNPTYPE::MA | SNPTYPE::DB))
+                {
+                    get_RI_trace(b, a, ri);
+                }
+                else
+                {
+                    for (S32 pt = 0; pt < n_points; pt++)
+                    {
+                        if (valid[b][a][pt] & (SNPTYPE::RI | SNPTYPE::MA | SNPTYPE::DB))
+                        {
+                            ri[pt] = get_RI(pt, b, a);
+                        }
+                    }
+                }
+
+                for (S32 pt = 0; pt < n_points; pt++)
+                {
+                    v[pt] = (valid[b][a][pt] & (SNPTYPE::RI | SNPTYPE::MA | SNPTYPE::DB)) ? (SNPTYPE::RI | (valid[b][a][pt] & file_forms)) : 0;
+                }
+
+                if (file_forms & SNPTYPE::MA) memcpy(SPARAM::bin_section(block, section++, SNPTYPE::MA, b, a, n_points, &offset), MA[b][a], n_points * sizeof(SPARAM::MA));
+                if (file_forms & SNPTYPE::DB) memcpy(SPARAM::bin_section(block, section++, SNPTYPE::DB, b, a, n_points, &offset), DB[b][a], n_points * sizeof(SPARAM::DB));
+                if (file_forms & SNPTYPE::CZ) memcpy(SPARAM::bin_section(block, section++, SNPTYPE::CZ, b, a, n_points, &offset), CZ[b][a], n_points * sizeof(SPARAM::CZ));
+            }
+        }
+
+        assert(offset == n_block_bytes);
+
+        *output_bytes = (S32)n_block_bytes;
+        return block;
     }
 
     // --------------------------------------------------------------------------------------------------
@@ -481,103 +1179,403 @@ struct SPARAMS
             return -1;
         }
 
-        U8 *block = (U8 *)malloc(HDR.n_data_bytes + sizeof(HDR));
+        U8 *block = (U8 *)malloc(HDR.n_data_bytes + sizeof(HDR));
+
+        if (block == NULL)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+            return -1;
+        }
+
+        U8 *block_start = block;
+
+        memcpy(block, &HDR, sizeof(HDR)); block += sizeof(HDR);
+
+        if (fread(block, HDR.n_data_bytes, 1, in) != 1)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't read data from SNPB file");
+            return -1;
+        }
+
+        S32 result = deserialize(block_start);
+
+        FREE(block_start);
+
+        return result;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Deserialize from memory block (copied, see attach() to use a v2 block in place)
+    //
+    // Returns # of bytes processed or -1 on error
+    // (0 = data not recognized as a serialized .S2P file)
+    // --------------------------------------------------------------------------------------------------
+    virtual S32 deserialize(U8 *block)
+    {
+        U32 read_ID = *(U32 *)block;
+
+        if (read_ID != SPARAM::BIN_ID)
+        {
+            //
+            // This isn't our block -- return without fetching any data or reporting an error
+            //
+            message_printf(SPARAM::MSG_VERBOSE, (C8*)"Unrecognized block ID");
+            return 0;
+        }
+
+        clear();
+        init();
+
+        U8 *block_start = block;
+        block += sizeof(read_ID);
+
+        U32 read_version = *(U32 *)block; block += sizeof(read_version);
+
+        if (read_version == SPARAM::BIN_VERSION)
+        {
+            SPARAM::BIN_HEADER *H = (SPARAM::BIN_HEADER *)block_start;
+            const SPARAM::BIN_SECTION *section = bin_sections(block_start, (U64)H->n_data_bytes + 12);
+
+            if ((section == NULL) || !alloc(H->n_ports, H->n_points, (U8)H->forms))
+            {
+                return -1;
+            }
+
+            min_Hz = H->min_Hz;
+            max_Hz = H->max_Hz;
+            Zo = COMPLEX_DOUBLE(H->Zo_real, H->Zo_imag);
+
+            for (U32 s = 0; s < H->n_sections; s++)
+            {
+                memcpy(bin_array(&section[s]), block_start + section[s].offset, (size_t)section[s].bytes);
+            }
+
+            return H->n_data_bytes + 12;
+        }
+
+        if (read_version != SPARAM::BIN_VERSION_1)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Binary version 0x%.08X not supported by version 0x%.08X parser", read_version, SPARAM::BIN_VERSION);
+            return -1;
+        }
+
+        S32 expect_n_data_bytes = *(S32 *)block; block += sizeof(expect_n_data_bytes);
+
+        U8 *data_start = block;
+
+        S32 read_n_ports = *(S32 *)block; block += sizeof(read_n_ports);
+        S32 read_n_points = *(S32 *)block; block += sizeof(read_n_points);
+
+        min_Hz = *(DOUBLE *)block; block += sizeof(min_Hz);
+        max_Hz = *(DOUBLE *)block; block += sizeof(max_Hz);
+        Zo = *(COMPLEX_DOUBLE *)block; block += sizeof(Zo);
+
+        if (alloc(read_n_ports, read_n_points))
+        {
+            memcpy(&freq_Hz[0], block, n_points * sizeof(freq_Hz[0])); block += n_points * sizeof(freq_Hz[0]);
+
+            for (S32 b = 0; b < n_ports; b++)
+            {
+                for (S32 a = 0; a < n_ports; a++)
+                {
+                    memcpy(&valid[b][a][0], block, n_points * sizeof(valid[b][a][0])); block += n_points * sizeof(valid[b][a][0]);
+                    memcpy(&MA[b][a][0], block, n_points * sizeof(MA[b][a][0])); block += n_points * sizeof(MA[b][a][0]);
+                    memcpy(&DB[b][a][0], block, n_points * sizeof(DB[b][a][0])); block += n_points * sizeof(DB[b][a][0]);
+                    memcpy(&RI[b][a][0], block, n_points * sizeof(RI[b][a][0])); block += n_points * sizeof(RI[b][a][0]);
+                    memcpy(&CZ[b][a][0], block, n_points * sizeof(CZ[b][a][0])); block += n_points * sizeof(CZ[b][a][0]);
+                }
+            }
+
+            S32 bytes_read = (S32)(block - data_start);
+
+            if (bytes_read != expect_n_data_bytes)
+            {
+                message_printf(SPARAM::MSG_ERROR, (C8*)"Missing or corrupt binary SNP data (%d bytes expected, %d read)",
+                        expect_n_data_bytes,
+                        bytes_read);
+
+                return -1;
+            }
+        }
+        return (S32)(block - block_start);
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Check a SNPB v2 block of block_bytes bytes, returns its section table (NULL on error)
+    //
+    // Every section must be inside the block, SPARAMS_ALIGN aligned and of n_points elements, and the
+    // frequencies plus valid and RI of each parameter must be present
+    // --------------------------------------------------------------------------------------------------
+    const SPARAM::BIN_SECTION *bin_sections(const U8 *block, U64 block_bytes)
+    {
+        const SPARAM::BIN_HEADER *H = (const SPARAM::BIN_HEADER *)block;
+
+        if ((block_bytes < sizeof(SPARAM::BIN_HEADER)) ||
+            (H->version != SPARAM::BIN_VERSION) ||
+            (H->header_bytes != sizeof(SPARAM::BIN_HEADER)) ||
+            (H->n_ports < 1) || (H->n_ports > 16) || (H->n_points < 1) ||
+            ((H->forms & ~SNPTYPE::ALL) != 0) || !(H->forms & SNPTYPE::RI) ||
+            (H->n_sections > (block_bytes - sizeof(SPARAM::BIN_HEADER)) / sizeof(SPARAM::BIN_SECTION)))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Corrupt SNPB v2 header");
+            return NULL;
+        }
+
+        const SPARAM::BIN_SECTION *section = (const SPARAM::BIN_SECTION *)(block + sizeof(SPARAM::BIN_HEADER));
+        U32 n_required = 0;
+
+        for (U32 s = 0; s < H->n_sections; s++)
+        {
+            const SPARAM::BIN_SECTION *S = &section[s];
+            bool param = (S->type != SPARAM::BIN_SECTION_FREQ);
+
+            if (((S->type != SPARAM::BIN_SECTION_VALID) && param && !(S->type & H->forms)) ||
+                (SPARAM::bin_element_size(S->type) == 0) ||
+                (param && ((S->b < 0) || (S->b >= H->n_ports) || (S->a < 0) || (S->a >= H->n_ports))) ||
+                (S->bytes != (U64)H->n_points * SPARAM::bin_element_size(S->type)) ||
+                ((S->offset % SPARAMS_ALIGN) != 0) ||
+                (S->offset > block_bytes) || (S->bytes > block_bytes - S->offset))
+            {
+                message_printf(SPARAM::MSG_ERROR, (C8*)"Corrupt SNPB v2 section %d", s);
+                return NULL;
+            }
+
+            if ((S->type == SPARAM::BIN_SECTION_FREQ) || (S->type == SPARAM::BIN_SECTION_VALID) || (S->type == SNPTYPE::RI))
+            {
+                n_required++;
+            }
+        }
+
+        if (n_required < 1 + 2 * (U32)(H->n_ports * H->n_ports))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Missing SNPB v2 sections");
+            return NULL;
+        }
+
+        return section;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Array of the SPARAMS database matching a SNPB v2 section
+    // --------------------------------------------------------------------------------------------------
+    void *bin_array(const SPARAM::BIN_SECTION *S)
+    {
+        switch (S->type)
+        {
+            case SPARAM::BIN_SECTION_FREQ:  return freq_Hz;
+            case SPARAM::BIN_SECTION_VALID: return valid[S->b][S->a];
+            case SNPTYPE::MA:               return MA[S->b][S->a];
+            case SNPTYPE::DB:               return DB[S->b][S->a];
+            case SNPTYPE::RI:               return RI[S->b][S->a];
+            case SNPTYPE::CZ:               return CZ[S->b][S->a];
+        }
+        return NULL;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Use a SNPB v2 block of block_bytes bytes in place: the arrays point into the block (SPARAMS_ALIGN
+    // aligned, must stay valid and writable until clear()), only the [b][a] pointer tables are allocated
+    //
+    // Returns # of bytes processed or -1 on error
+    // (0 = data not recognized as a SNPB v2 block)
+    // --------------------------------------------------------------------------------------------------
+    virtual S32 attach(U8 *block, U64 block_bytes)
+    {
+        SPARAM::BIN_HEADER *H = (SPARAM::BIN_HEADER *)block;
+
+        if ((block_bytes < 12) || (H->ID != SPARAM::BIN_ID) || (H->version != SPARAM::BIN_VERSION))
+        {
+            message_printf(SPARAM::MSG_VERBOSE, (C8*)"Unrecognized block ID");
+            return 0;
+        }
+
+        clear();
+        init();
+
+        if (((uintptr_t)block % SPARAMS_ALIGN) != 0)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"SNPB block not aligned");
+            return -1;
+        }
+
+        if ((U64)H->n_data_bytes + 12 > block_bytes)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Missing or corrupt binary SNP data (%d bytes expected, %d read)",
+                    H->n_data_bytes,
+                    (S32)(block_bytes - 12));
+            return -1;
+        }
+
+        const SPARAM::BIN_SECTION *section = bin_sections(block, (U64)H->n_data_bytes + 12);
+
+        if (section == NULL)
+        {
+            return -1;
+        }
+
+        S32 ports = H->n_ports;
+        arena = (U8 *)calloc(5 * (ports + ports * ports), sizeof(void *));
+
+        if (arena == NULL)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+            return -1;
+        }
+
+        n_ports = ports;
+        n_points = H->n_points;
+        forms = (U8)H->forms;
+        min_Hz = H->min_Hz;
+        max_Hz = H->max_Hz;
+        Zo = COMPLEX_DOUBLE(H->Zo_real, H->Zo_imag);
+
+        void **table = (void **)arena;
+        U8 *no_data = NULL;
+
+        valid = (U8 ***)arena_matrix(&table, &no_data, 0);
+        RI = (SPARAM::RI ***)arena_matrix(&table, &no_data, 0);
+        if (forms & SNPTYPE::MA) MA = (SPARAM::MA ***)arena_matrix(&table, &no_data, 0);
+        if (forms & SNPTYPE::DB) DB = (SPARAM::DB ***)arena_matrix(&table, &no_data, 0);
+        if (forms & SNPTYPE::CZ) CZ = (SPARAM::CZ ***)arena_matrix(&table, &no_data, 0);
+
+        for (U32 s = 0; s < H->n_sections; s++)
+        {
+            void *array = block + section[s].offset;
+
+            switch (section[s].type)
+            {
+                case SPARAM::BIN_SECTION_FREQ:  freq_Hz = (DOUBLE *)array; break;
+                case SPARAM::BIN_SECTION_VALID: valid[section[s].b][section[s].a] = (U8 *)array; break;
+                case SNPTYPE::MA:               MA[section[s].b][section[s].a] = (SPARAM::MA *)array; break;
+                case SNPTYPE::DB:               DB[section[s].b][section[s].a] = (SPARAM::DB *)array; break;
+                case SNPTYPE::RI:               RI[section[s].b][section[s].a] = (SPARAM::RI *)array; break;
+                case SNPTYPE::CZ:               CZ[section[s].b][section[s].a] = (SPARAM::CZ *)array; break;
+            }
+        }
+
+        //
+        // Every array must come from a section (cached forms are stored for all the parameters)
+        //
+        bool complete = (freq_Hz != NULL);
+
+        for (S32 b = 0; b < n_ports; b++)
+        {
+            for (S32 a = 0; a < n_ports; a++)
+            {
+                complete = complete && (valid[b][a] != NULL) && (RI[b][a] != NULL) &&
+                        ((MA == NULL) || (MA[b][a] != NULL)) &&
+                        ((DB == NULL) || (DB[b][a] != NULL)) &&
+                        ((CZ == NULL) || (CZ[b][a] != NULL));
+            }
+        }
+
+        if (!complete)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Missing SNPB v2 sections");
+            clear();
+            return -1;
+        }
+
+        return H->n_data_bytes + 12;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Save to binary SNPB file (serialize() block)
+    // --------------------------------------------------------------------------------------------------
+    virtual bool write_SNPB_file(const C8 *filename, U8 cache_forms = 0)
+    {
+        S32 n_bytes = 0;
+        U8 *block = serialize(&n_bytes, cache_forms);
+
+        if (block == NULL)
+        {
+            return FALSE;
+        }
+
+        FILE *out = fopen(filename, "wb");
 
-        if (block == NULL)
+        if (out == NULL)
         {
-            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
-            return -1;
+            FREE(block);
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't open %s", filename);
+            return FALSE;
         }
 
-        U8 *block_start = block;
-
-        memcpy(block, &HDR, sizeof(HDR)); block += sizeof(HDR);
+        bool result = (fwrite(block, n_bytes, 1, out) == 1);
 
-        if (fread(block, HDR.n_data_bytes, 1, in) != 1)
+        if (fclose(out) != 0)
         {
-            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't read data from SNPB file");
-            return -1;
+            result = FALSE;
         }
 
-        S32 result = deserialize(block_start);
+        FREE(block);
 
-        FREE(block_start);
+        if (!result)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't write to %s", filename);
+        }
 
         return result;
     }
 
     // --------------------------------------------------------------------------------------------------
-    // Deserialize from memory block
+    // Load binary SNPB file
     //
-    // Returns # of bytes processed or -1 on error
-    // (0 = data not recognized as a serialized .S2P file)
+    // v2 files are memory mapped (private copy on write mapping) and used in place with attach(), so
+    // the sections of a parameter are only read from disk when they are accessed.
+    // v1 files (or if the file can't be mapped) are loaded with deserialize()
     // --------------------------------------------------------------------------------------------------
-    virtual S32 deserialize(U8 *block)
+    virtual bool read_SNPB_file(const C8 *filename)
     {
-        U32 read_ID = *(U32 *)block;
-
-        if (read_ID != SPARAM::BIN_ID)
-        {
-            //
-            // This isn't our block -- return without fetching any data or reporting an error
-            //
-            message_printf(SPARAM::MSG_VERBOSE, (C8*)"Unrecognized block ID");
-            return 0;
-        }
-
         clear();
         init();
 
-        U8 *block_start = block;
-        block += sizeof(read_ID);
-
-        U32 read_version = *(U32 *)block; block += sizeof(read_version);
+        QFile *file = new QFile(QString::fromLocal8Bit(filename));
 
-        if (read_version != SPARAM::BIN_VERSION)
+        if (!file->open(QIODevice::ReadOnly))
         {
-            message_printf(SPARAM::MSG_ERROR, (C8*)"Binary version 0x.08X not supported by version 0x.08X parser", read_version, SPARAM::BIN_VERSION);
-            return -1;
+            delete file;
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't open %s", filename);
+            return FALSE;
         }
 
-        S32 expect_n_data_bytes = *(S32 *)block; block += sizeof(expect_n_data_bytes);
-
-        U8 *data_start = block;
-
-        S32 read_n_ports = *(S32 *)block; block += sizeof(read_n_ports);
-        S32 read_n_points = *(S32 *)block; block += sizeof(read_n_points);
-
-        min_Hz = *(DOUBLE *)block; block += sizeof(min_Hz);
-        max_Hz = *(DOUBLE *)block; block += sizeof(max_Hz);
-        Zo = *(COMPLEX_DOUBLE *)block; block += sizeof(Zo);
+        U64 file_size = (U64)file->size();
+        U8 *block = (file_size >= sizeof(SPARAM::BIN_HEADER)) ? file->map(0, file->size(), QFileDevice::MapPrivateOption) : NULL;
+        S32 result = 0;
 
-        if (alloc(read_n_ports, read_n_points))
+        if ((block != NULL) && (((SPARAM::BIN_HEADER *)block)->version == SPARAM::BIN_VERSION))
         {
-            memcpy(&freq_Hz[0], block, n_points * sizeof(freq_Hz[0])); block += n_points * sizeof(freq_Hz[0]);
+            result = attach(block, file_size);
 
-            for (S32 b = 0; b < n_ports; b++)
+            if (result > 0)
             {
-                for (S32 a = 0; a < n_ports; a++)
-                {
-                    memcpy(&valid[b][a][0], block, n_points * sizeof(valid[b][a][0])); block += n_points * sizeof(valid[b][a][0]);
-                    memcpy(&MA[b][a][0], block, n_points * sizeof(MA[b][a][0])); block += n_points * sizeof(MA[b][a][0]);
-                    memcpy(&DB[b][a][0], block, n_points * sizeof(DB[b][a][0])); block += n_points * sizeof(DB[b][a][0]);
-                    memcpy(&RI[b][a][0], block, n_points * sizeof(RI[b][a][0])); block += n_points * sizeof(RI[b][a][0]);
-                    memcpy(&CZ[b][a][0], block, n_points * sizeof(CZ[b][a][0])); block += n_points * sizeof(CZ[b][a][0]);
-                }
+                mapped_file = file;
+                return TRUE;
             }
+        }
+        else if ((block != NULL) && (file_size >= 12) && ((U64)((SPARAM::BIN_HEADER *)block)->n_data_bytes + 12 <= file_size))
+        {
+            result = deserialize(block);
+        }
+        else
+        {
+            FILE *in = fopen(filename, "rb");
 
-            S32 bytes_read = (S32)(block - data_start);
-
-            if (bytes_read != expect_n_data_bytes)
+            if (in != NULL)
             {
-                message_printf(SPARAM::MSG_ERROR, (C8*)"Missing or corrupt binary SNP data (%d bytes expected, %d read)",
-                        expect_n_data_bytes,
-                        bytes_read);
-
-                return -1;
+                result = deserialize(in);
+                fclose(in);
             }
         }
-        return (S32)(block - block_start);
+
+        delete file;
+
+        if (result == 0)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"%s is not a SNPB file", filename);
+        }
+
+        return (result > 0);
     }
 
     // --------------------------------------------------------------------------------------------------
@@ -585,15 +1583,15 @@ struct SPARAMS
     // --------------------------------------------------------------------------------------------------
     virtual C8 *sanitize(const C8 *input)
     {
-        static C8 output[MAX_PATH];
+        C8 *output = sanitize_text;     // Per instance (SPARAMS objects can be used by several threads)
 
         C8 *ptr = output;
 
         S32 len = strlen(input);
 
-        if (len >= sizeof(output))
+        if (len >= (S32)sizeof(sanitize_text))
         {
-            len = sizeof(output) - 1;
+            len = sizeof(sanitize_text) - 1;
         }
 
         for (S32 i = 0; i < len; i++)
@@ -617,21 +1615,84 @@ struct SPARAMS
     }
 
     // --------------------------------------------------------------------------------------------------
-    // Find data point closest to the specified frequency, or -1 if out of range
+    // Frequency lookup
     //
-    // alpha=0.0 if point matches freq_Hz[result] (or is an endpoint),
-    // 1.0 if point matches freq_Hz[result+1]
+    // freq_Hz is checked on the first lookup after alloc(): for a uniform sweep (e.g. LINFREQ) the
+    // interval is computed from the frequency (then corrected against freq_Hz so the result is the
+    // same as a search), else a branchless binary search is used (batches reuse the previous
+    // interval instead, see nearest_freq_Hz(query_Hz, ...)).
+    // An application changing freq_Hz in place must set freq_grid to -1.
     // --------------------------------------------------------------------------------------------------
-    static int search_double_array(const void *keyval, const void *datum)
+    void freq_grid_check(void)
     {
-        DOUBLE key = *(DOUBLE *)keyval;
+        freq_grid = 0;
 
-        if (key < ((DOUBLE *)datum)[0]) return -1;
-        if (key >= ((DOUBLE *)datum)[1]) return  1;
+        if (n_points < 3)
+        {
+            return;
+        }
 
-        return 0;
+        DOUBLE f0 = freq_Hz[0];
+        DOUBLE step = (freq_Hz[n_points - 1] - f0) / (n_points - 1);
+        DOUBLE error = 0.0;
+
+        if (!(step > 0.0))
+        {
+            return;
+        }
+
+        for (S32 i = 0; i < n_points; i++)
+        {
+            error = max(error, fabs(freq_Hz[i] - (f0 + i * step)));
+        }
+
+        if (error <= 0.25 * step)                    // Computed index off by one at most
+        {
+            freq_step_inv = 1.0 / step;
+            freq_grid = 1;
+        }
+    }
+
+    //
+    // Interval i of freq_Hz[0] < Hz < freq_Hz[n_points - 1]: freq_Hz[i] <= Hz < freq_Hz[i + 1]
+    //
+    inline S32 freq_interval(DOUBLE Hz)
+    {
+        if (freq_grid < 0)
+        {
+            freq_grid_check();
+        }
+
+        if (freq_grid == 1)
+        {
+            S32 i = min(max((S32)((Hz - freq_Hz[0]) * freq_step_inv), 0), n_points - 2);
+
+            while ((i > 0) && (freq_Hz[i] > Hz)) i--;
+            while ((i < n_points - 2) && (freq_Hz[i + 1] <= Hz)) i++;
+
+            return i;
+        }
+
+        const DOUBLE *base = freq_Hz;
+        S32 n = n_points - 1;
+
+        while (n > 1)
+        {
+            S32 half = n >> 1;
+
+            base = (base[half] <= Hz) ? (base + half) : base;   // (cmov)
+            n -= half;
+        }
+
+        return (S32)(base - freq_Hz);
     }
 
+    // --------------------------------------------------------------------------------------------------
+    // Find data point closest to the specified frequency, or -1 if out of range
+    //
+    // alpha=0.0 if point matches freq_Hz[result] (or is an endpoint),
+    // 1.0 if point matches freq_Hz[result+1]
+    // --------------------------------------------------------------------------------------------------
     S32 nearest_freq_Hz(DOUBLE Hz, DOUBLE *alpha = NULL)
     {
         if (Hz <= freq_Hz[0])
@@ -649,18 +1710,11 @@ struct SPARAMS
         //
         // Find index where freq_Hz[i+1] < Hz > freq_Hz[i]
         //
-        DOUBLE *ptr = (DOUBLE *)bsearch(&Hz,
-                freq_Hz,
-                n_points - 1,
-                sizeof(DOUBLE),
-                search_double_array);
-        assert(ptr != NULL);
+        S32 result = freq_interval(Hz);
 
         //
         // Return fractional result in alpha
         //
-        S32 result = (S32)(ptr - freq_Hz);
-
         if (alpha != NULL)
         {
             *alpha = (Hz - freq_Hz[result]) / (freq_Hz[result + 1] - freq_Hz[result]);
@@ -669,6 +1723,56 @@ struct SPARAMS
         return result;
     }
 
+    // --------------------------------------------------------------------------------------------------
+    // Batch nearest_freq_Hz(): index[n] and alpha[n] (optional) of query_Hz[n], same results
+    //
+    // Ascending queries (usual sweep/screen grid) reuse the previous interval (galloping search) when
+    // freq_Hz is not uniform, any order is supported
+    // --------------------------------------------------------------------------------------------------
+    void nearest_freq_Hz(const DOUBLE *query_Hz, S32 n, S32 *index, DOUBLE *alpha)
+    {
+        if (freq_grid < 0)
+        {
+            freq_grid_check();
+        }
+
+        DOUBLE first_Hz = freq_Hz[0];
+        DOUBLE last_Hz = freq_Hz[n_points - 1];
+        S32 u = 0;
+
+        for (S32 q = 0; q < n; q++)
+        {
+            DOUBLE Hz = query_Hz[q];
+            S32 result;
+
+            if (Hz <= first_Hz)
+            {
+                result = 0;
+            }
+            else if (Hz >= last_Hz)
+            {
+                result = n_points - 1;
+            }
+            else if (freq_grid == 1)
+            {
+                result = freq_interval(Hz);
+            }
+            else
+            {
+                u = lerp_upper(freq_Hz, n_points, u, Hz);
+                result = u - 1;
+            }
+
+            index[q] = result;
+
+            if (alpha != NULL)
+            {
+                alpha[q] = ((Hz <= first_Hz) || (Hz >= last_Hz)) ? 0.0 :
+                        (Hz - freq_Hz[result]) / (freq_Hz[result + 1] - freq_Hz[result]);
+            }
+        }
+    }
+
     // --------------------------------------------------------------------------------------------------
     // Return TRUE if value at specified point is available in any format
     // --------------------------------------------------------------------------------------------------
@@ -694,12 +1798,14 @@ struct SPARAMS
 
         RI[b][a][pt] = val;
         valid[b][a][pt] = SNPTYPE::RI;
+        spline_invalidate();
     }
 
     virtual void set_RI(S32 pt, S32 b, S32 a, COMPLEX_DOUBLE val)
     {
         RI[b][a][pt] = val;
         valid[b][a][pt] = SNPTYPE::RI;
+        spline_invalidate();
     }
 
     // --------------------------------------------------------------------------------------------------
@@ -774,6 +1880,11 @@ struct SPARAMS
 
     virtual SPARAM::MA get_MA(S32 pt, S32 b, S32 a)
     {
+        if (MA == NULL)     // Not stored (see alloc()), converted without caching
+        {
+            return SPARAM::MA(get_RI(pt, b, a));
+        }
+
         if (valid[b][a][pt] & SNPTYPE::MA)
         {
             return MA[b][a][pt];
@@ -815,6 +1926,11 @@ struct SPARAMS
 
     virtual SPARAM::DB get_DB(S32 pt, S32 b, S32 a)
     {
+        if (DB == NULL)     // Not stored (see alloc()), converted without caching
+        {
+            return SPARAM::DB(get_RI(pt, b, a));
+        }
+
         if (valid[b][a][pt] & SNPTYPE::DB)
         {
             return DB[b][a][pt];
@@ -856,15 +1972,182 @@ struct SPARAMS
 
     virtual SPARAM::CZ get_CZ(S32 pt, S32 b, S32 a)
     {
+        if (CZ == NULL)     // Not stored (see alloc()), converted without caching
+        {
+            return SPARAM::CZ(get_MA(pt, b, a), Zo.real);
+        }
+
         if (valid[b][a][pt] & SNPTYPE::CZ)
         {
             return CZ[b][a][pt];
         }
 
-        CZ[b][a][pt] = SPARAM::CZ(get_MA(pt, b, a), Zo.real);
-
-        valid[b][a][pt] |= SNPTYPE::CZ;
-        return CZ[b][a][pt];
+        CZ[b][a][pt] = SPARAM::CZ(get_MA(pt, b, a), Zo.real);
+
+        valid[b][a][pt] |= SNPTYPE::CZ;
+        return CZ[b][a][pt];
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Whole trace accessors: parameter [b][a] converted for all the points at once into dest[n_points]
+    // with the SPARAM batch kernels (mode = SPARAM::CONV_EXACT or SPARAM::CONV_FAST, see SPARAM::CONV_FAST)
+    //
+    // The source is the format valid for every point of the trace (picked in the same order as the
+    // per point accessors), else the per point accessors are used.
+    // The stored formats are not updated (see materialize())
+    // --------------------------------------------------------------------------------------------------
+    virtual U8 trace_forms(S32 b, S32 a)
+    {
+        U8 forms_valid = SNPTYPE::ALL;
+        U8 *v = valid[b][a];
+
+        for (S32 pt = 0; pt < n_points; pt++)
+        {
+            forms_valid &= v[pt];
+        }
+
+        return forms_valid;
+    }
+
+    virtual void get_RI_trace(S32 b, S32 a, SPARAM::RI *dest, U8 mode = SPARAM::CONV_EXACT)
+    {
+        U8 src = trace_forms(b, a);
+
+        if (src & SNPTYPE::RI)
+        {
+            memcpy(dest, RI[b][a], n_points * sizeof(dest[0]));
+        }
+        else if (src & SNPTYPE::MA)
+        {
+            SPARAM::MA_to_RI(MA[b][a], dest, n_points, mode);
+        }
+        else if (src & SNPTYPE::DB)
+        {
+            SPARAM::DB_to_RI(DB[b][a], dest, n_points, mode);
+        }
+        else
+        {
+            for (S32 pt = 0; pt < n_points; pt++)
+            {
+                dest[pt] = get_RI(pt, b, a);
+            }
+        }
+    }
+
+    virtual void get_MA_trace(S32 b, S32 a, SPARAM::MA *dest, U8 mode = SPARAM::CONV_EXACT)
+    {
+        U8 src = trace_forms(b, a);
+
+        if (src & SNPTYPE::MA)
+        {
+            memcpy(dest, MA[b][a], n_points * sizeof(dest[0]));
+        }
+        else if (src & SNPTYPE::DB)
+        {
+            SPARAM::DB_to_MA(DB[b][a], dest, n_points, mode);
+        }
+        else if (src & SNPTYPE::RI)
+        {
+            SPARAM::RI_to_MA(RI[b][a], dest, n_points, mode);
+        }
+        else
+        {
+            for (S32 pt = 0; pt < n_points; pt++)
+            {
+                dest[pt] = get_MA(pt, b, a);
+            }
+        }
+    }
+
+    virtual void get_DB_trace(S32 b, S32 a, SPARAM::DB *dest, U8 mode = SPARAM::CONV_EXACT)
+    {
+        U8 src = trace_forms(b, a);
+
+        if (src & SNPTYPE::DB)
+        {
+            memcpy(dest, DB[b][a], n_points * sizeof(dest[0]));
+        }
+        else if (src & SNPTYPE::MA)
+        {
+            SPARAM::MA_to_DB(MA[b][a], dest, n_points, mode);
+        }
+        else if (src & SNPTYPE::RI)
+        {
+            SPARAM::RI_to_DB(RI[b][a], dest, n_points, mode);
+        }
+        else
+        {
+            for (S32 pt = 0; pt < n_points; pt++)
+            {
+                dest[pt] = get_DB(pt, b, a);
+            }
+        }
+    }
+
+    virtual bool get_CZ_trace(S32 b, S32 a, SPARAM::CZ *dest, U8 mode = SPARAM::CONV_EXACT)
+    {
+        if (trace_forms(b, a) & SNPTYPE::CZ)
+        {
+            memcpy(dest, CZ[b][a], n_points * sizeof(dest[0]));
+            return TRUE;
+        }
+
+        SPARAM::MA *ma = (SPARAM::MA *)malloc(n_points * sizeof(SPARAM::MA));
+
+        if (ma == NULL)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+            return FALSE;
+        }
+
+        get_MA_trace(b, a, ma, mode);
+        SPARAM::MA_to_CZ(ma, dest, n_points, Zo.real, mode);
+
+        free(ma);
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Convert and store format (SNPTYPE::MA, DB, RI or CZ) for all the points of parameter [b][a]
+    // (e.g. materialize(SNPTYPE::DB, 1, 0) for S21), the per point accessors then return it directly
+    //
+    // Returns FALSE if the format is not stored (see alloc())
+    // --------------------------------------------------------------------------------------------------
+    virtual bool materialize(U8 format, S32 b, S32 a, U8 mode = SPARAM::CONV_EXACT)
+    {
+        bool result = TRUE;
+
+        if (!(forms & format))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Format 0x%X not stored", format);
+            return FALSE;
+        }
+
+        if ((trace_forms(b, a) & format) == format)
+        {
+            return TRUE;
+        }
+
+        switch (format)
+        {
+            case SNPTYPE::RI: get_RI_trace(b, a, RI[b][a], mode); break;
+            case SNPTYPE::MA: get_MA_trace(b, a, MA[b][a], mode); break;
+            case SNPTYPE::DB: get_DB_trace(b, a, DB[b][a], mode); break;
+            case SNPTYPE::CZ: result = get_CZ_trace(b, a, CZ[b][a], mode); break;
+            default: assert(0);
+        }
+
+        if (result)
+        {
+            U8 *v = valid[b][a];
+
+            for (S32 pt = 0; pt < n_points; pt++)
+            {
+                v[pt] |= format;
+            }
+        }
+
+        return result;
     }
 
     // --------------------------------------------------------------------------------------------------
@@ -1077,35 +2360,26 @@ struct SPARAMS
     }
 
     // --------------------------------------------------------------------------------------------------
-    // Save data to Touchstone 1.1 file
+    // Write Touchstone 1.1 header (comments and option line) to an open file
+    // Only n_ports, n_points, min_Hz, max_Hz and Zo are used (data not needed, see capture pipeline)
     // --------------------------------------------------------------------------------------------------
     /* Parameters
-        const C8 *filename // Output filename
-        const C8 *data_format = SPARAM::DEF_DATA_FORMAT // e.g., "MA",
-        const C8 *freq_format = SPARAM::DEF_FREQ_FORMAT // e.g., "GHZ",
-        const C8 *header = NULL	// optional
-        const C8 *single_param_type = NULL // optional
+        FILE *out // Output file
+        const C8 *data_format // e.g., "MA"
+        const C8 *freq_format // e.g., "GHZ"
+        const C8 *header // optional
+        const C8 *single_param_type // optional
+        DOUBLE *freq_div // Returns the frequency divisor of the data rows
+        U8 *format // Returns the SNPTYPE of the data rows
     */
-    virtual bool write_SNP_file(const C8 *filename,
-                                const C8 *data_format = SPARAM::DEF_DATA_FORMAT,
-                                const C8 *freq_format = SPARAM::DEF_FREQ_FORMAT,
-                                const C8 *header = NULL,
-                                const C8 *single_param_type = NULL)
+    virtual void write_SNP_header(FILE *out,
+                                  const C8 *data_format,
+                                  const C8 *freq_format,
+                                  const C8 *header,
+                                  const C8 *single_param_type,
+                                  DOUBLE *freq_div,
+                                  U8 *format)
     {
-        if (n_ports > 2)
-        {
-            message_printf(SPARAM::MSG_ERROR, (C8*)">2 ports not supported");
-            return FALSE;
-        }
-
-        FILE *out = fopen(filename, "wt");
-
-        if (out == NULL)
-        {
-            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't open %s", filename);
-            return FALSE;
-        }
-
         if (header != NULL)
         {
             fprintf(out, "%s", sanitize(header));
@@ -1150,12 +2424,12 @@ struct SPARAMS
             }
         }
 
-        U8 format = SNPTYPE::MA;
+        *format = SNPTYPE::MA;
 
-        if (!_stricmp(data_format, "DB")) format = SNPTYPE::DB;
-        else if (!_stricmp(data_format, "RI")) format = SNPTYPE::RI;
+        if (!_stricmp(data_format, "DB")) *format = SNPTYPE::DB;
+        else if (!_stricmp(data_format, "RI")) *format = SNPTYPE::RI;
 
-        switch (format)
+        switch (*format)
         {
             case SNPTYPE::MA: fprintf(out, "# %s S MA R %lG\n", freq_txt[freq_fmt], Zo.real); break;
             case SNPTYPE::DB: fprintf(out, "# %s S DB R %lG\n", freq_txt[freq_fmt], Zo.real); break;
@@ -1163,51 +2437,129 @@ struct SPARAMS
             default: assert(0);
         }
 
-        for (S32 i = 0; i < n_points; i++)
+        *freq_div = freq_fac[freq_fmt];
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Save data to Touchstone 1.1 file
+    //
+    // Values converted with conversion_mode and written with text_digits (see SPARAM::print_double())
+    // --------------------------------------------------------------------------------------------------
+    /* Parameters
+        const C8 *filename // Output filename
+        const C8 *data_format = SPARAM::DEF_DATA_FORMAT // e.g., "MA",
+        const C8 *freq_format = SPARAM::DEF_FREQ_FORMAT // e.g., "GHZ",
+        const C8 *header = NULL	// optional
+        const C8 *single_param_type = NULL // optional
+    */
+    virtual bool write_SNP_file(const C8 *filename,
+                                const C8 *data_format = SPARAM::DEF_DATA_FORMAT,
+                                const C8 *freq_format = SPARAM::DEF_FREQ_FORMAT,
+                                const C8 *header = NULL,
+                                const C8 *single_param_type = NULL)
+    {
+        if (n_ports > 2)
         {
-            fprintf(out, "%lf ", freq_Hz[i] / freq_fac[freq_fmt]);
+            message_printf(SPARAM::MSG_ERROR, (C8*)">2 ports not supported");
+            return FALSE;
+        }
 
-            for (S32 a = 0; a < n_ports; a++)
+        FILE *out = fopen(filename, "wt");
+
+        if (out == NULL)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't open %s", filename);
+            return FALSE;
+        }
+
+        DOUBLE freq_div = 1E9;
+        U8 format = SNPTYPE::MA;
+        write_SNP_header(out, data_format, freq_format, header, single_param_type, &freq_div, &format);
+
+        //
+        // Convert each parameter as a whole trace (see get_MA_trace()), [a][b] file order
+        //
+        DOUBLE *trace = (DOUBLE *)malloc((size_t)n_ports * n_ports * n_points * 2 * sizeof(DOUBLE));
+
+        if (trace == NULL)
+        {
+            fclose(out);
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+            return FALSE;
+        }
+
+        for (S32 a = 0; a < n_ports; a++)
+        {
+            for (S32 b = 0; b < n_ports; b++)
             {
-                for (S32 b = 0; b < n_ports; b++)
+                DOUBLE *col = &trace[(size_t)(a * n_ports + b) * n_points * 2];
+
+                switch (format)
                 {
-                    switch (format)
-                    {
-                        case SNPTYPE::MA:
-                        {
-                            SPARAM::MA val = get_MA(i, b, a);
+                    case SNPTYPE::MA: get_MA_trace(b, a, (SPARAM::MA *)col, conversion_mode); break;
+                    case SNPTYPE::DB: get_DB_trace(b, a, (SPARAM::DB *)col, conversion_mode); break;
+                    case SNPTYPE::RI: get_RI_trace(b, a, (SPARAM::RI *)col, conversion_mode); break;
+                    default: assert(0);
+                }
+            }
+        }
 
-                            fprintf(out, "%lf %lf ", val.mag, val.deg);
-                            break;
-                        }
+        //
+        // Text formatted in a large block (SPARAM::print_double()), one fwrite() per block
+        //
+        S32 n_cols = n_ports * n_ports;
+        U32 row_max = (1 + 2 * n_cols) * (SPARAM::TEXT_MAX_VALUE + 1) + 1;
+        C8 *buf = (C8 *)malloc(SPARAM::TEXT_BUFFER_SIZE + row_max);
+        U32 len = 0;
+        bool result = TRUE;
 
-                        case SNPTYPE::DB:
-                        {
-                            SPARAM::DB val = get_DB(i, b, a);
+        if (buf == NULL)
+        {
+            free(trace);
+            fclose(out);
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+            return FALSE;
+        }
 
-                            fprintf(out, "%lf %lf ", val.dB, val.deg);
-                            break;
-                        }
+        for (S32 i = 0; (i < n_points) && result; i++)
+        {
+            len += SPARAM::print_double(&buf[len], freq_Hz[i] / freq_div, text_digits);
+            buf[len++] = ' ';
 
-                        case SNPTYPE::RI:
-                        {
-                            SPARAM::RI val = get_RI(i, b, a);
+            for (S32 col = 0; col < n_cols; col++)
+            {
+                DOUBLE *val = &trace[((size_t)col * n_points + i) * 2];
 
-                            fprintf(out, "%lf %lf ", val.real, val.imag);
-                            break;
-                        }
+                len += SPARAM::print_pair(&buf[len], val[0], val[1], text_digits);
+            }
+            buf[len++] = '\n';
 
-                        default:
-                                assert(0);
-                    }
-                }
+            if (len >= SPARAM::TEXT_BUFFER_SIZE)
+            {
+                result = (fwrite(buf, 1, len, out) == len);
+                len = 0;
             }
-            fprintf(out, "\n");
         }
 
-        fclose(out);
+        if (result && (len > 0))
+        {
+            result = (fwrite(buf, 1, len, out) == len);
+        }
+
+        free(buf);
+        free(trace);
 
-        return TRUE;
+        if (fclose(out) != 0)
+        {
+            result = FALSE;
+        }
+
+        if (!result)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't write %s", filename);
+        }
+
+        return result;
     }
 
     // --------------------------------------------------------------------------------------------------
@@ -1215,13 +2567,13 @@ struct SPARAMS
     //
     // NB: There's no straightforward way to tell how many ports are specified in a
     // Touchstone 1.X file, so the target database size must be specified in file_ports
+    //
+    // The file is memory mapped (QFile::map()) and parsed in a single pass (any line length) with
+    // SPARAM::text_parse_double(), the values are stored in a growable row array then in the
+    // database once the number of points is known
     // --------------------------------------------------------------------------------------------------
     virtual bool read_SNP_file(const C8 *filename, S32 file_ports)
     {
-        //
-        // Pass 1: Discard any existing data, then count # of points defined in file and allocate arrays
-        // Pass 2: Read data from the file
-        //
         clear();
         init();
 
@@ -1231,226 +2583,273 @@ struct SPARAMS
         DOUBLE file_R = 50.0;
         S32    file_points = 0;
 
-        S32 pt = 0;
+        QFile file(QString::fromLocal8Bit(filename));
 
-        for (S32 pass = 1; pass <= 2; pass++)
+        if (!file.open(QIODevice::ReadOnly))
         {
-            FILE *in = fopen(filename, "rt");
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't open %s", filename);
+            return FALSE;
+        }
 
-            if (in == NULL)
-            {
-                message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't open %s", filename);
-                return FALSE;
-            }
+        size_t file_size = (size_t)file.size();
+        const C8 *text = NULL;
+        C8 *text_copy = NULL;           // File read in memory if it can't be mapped
+
+        if (file_size > 0)
+        {
+            text = (const C8 *)file.map(0, file.size());
 
-            if (pass == 2)
+            if (text == NULL)
             {
-                message_printf(SPARAM::MSG_VERBOSE, (C8*)"  Points: %d\n", file_points);
+                text_copy = (C8 *)malloc(file_size);
 
-                if (!alloc(file_ports, file_points))
+                if ((text_copy == NULL) || (file.read(text_copy, file.size()) != file.size()))
                 {
+                    FREE(text_copy);
+                    message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't read %s", filename);
                     return FALSE;
                 }
+                text = text_copy;
             }
+        }
 
-            for (;;)
-            {
-                C8 linbuf[2048] = { 0 };
+        //
+        // Rows of 1 + 2 * file_ports^2 values (frequency then R,I pairs in S11, S21, S12, S22 order)
+        //
+        S32 row_values = (file_ports == 1) ? 3 : 9;
+        S32 max_rows = (S32)min((size_t)0x7FFFFFFF, file_size / (row_values * 8) + 16);
+        DOUBLE *rows = (DOUBLE *)malloc(max_rows * row_values * sizeof(DOUBLE));
+        C8 *option_line = NULL;
+        bool result = (rows != NULL);
 
-                C8 *result = fgets(linbuf,
-                        sizeof(linbuf) - 1,
-                        in);
+        if (!result)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+        }
 
-                if (result == NULL)
-                {
-                    break;
-                }
+        DOUBLE last_Hz = -DBL_MAX;
+        const C8 *line = text;
+        const C8 *file_end = text + file_size;
 
-                //
-                // Remove leading and trailing spaces as well as text on lines
-                // following '!' comments, and skip any blank lines
-                //
+        while (result && (line < file_end))
+        {
+            const C8 *line_end = (const C8 *)memchr(line, '\n', file_end - line);
+            const C8 *next_line = (line_end == NULL) ? file_end : (line_end + 1);
 
-                C8 *txt = linbuf;
-                C8 *end = linbuf;
-                bool leading = TRUE;
+            if (line_end == NULL)
+            {
+                line_end = file_end;
+            }
 
-                S32 l = strlen(linbuf);
+            //
+            // Remove leading and trailing spaces as well as text on lines
+            // following '!' comments, and skip any blank lines
+            //
+            const C8 *comment = (const C8 *)memchr(line, '!', line_end - line);
+            if (comment != NULL)
+            {
+                line_end = comment;
+            }
 
-                for (S32 i = 0; i < l; i++)
-                {
-                    if (linbuf[i] == '!')
-                    {
-                        break;
-                    }
+            while ((line < line_end) && isspace((U8)*line))
+            {
+                line++;
+            }
+            while ((line_end > line) && isspace((U8)line_end[-1]))
+            {
+                line_end--;
+            }
 
-                    if (!isspace((U8)linbuf[i]))
-                    {
-                        if (leading)
-                        {
-                            txt = &linbuf[i];
-                            leading = FALSE;
-                        }
-                        end = &linbuf[i];
-                    }
-                }
-                end[1] = 0;
+            const C8 *txt = line;
+            line = next_line;
+
+            if (txt == line_end)
+            {
+                continue;
+            }
+
+            //
+            // Only V1.x format supported for now, so flag any 2.X/IBIS-style options
+            //
+            if (txt[0] == '[')
+            {
+                message_printf(SPARAM::MSG_ERROR, (C8*)"Touchstone 2.0 and later files not supported");
+                result = FALSE;
+                break;
+            }
 
-                if (leading || (!strlen(txt)))
+            //
+            // Parse option line (e.g., # GHZ S MA R 50)
+            //
+            if (txt[0] == '#')
+            {
+                if (file_points != 0)      // must be the first non-comment line in the file
                 {
                     continue;
                 }
 
-                //
-                // Only V1.x format supported for now, so flag any 2.X/IBIS-style options
-                //
-                if (txt[0] == '[')
+                FREE(option_line);
+                option_line = (C8 *)malloc(line_end - txt + 1);
+                if (option_line == NULL)
                 {
-                    message_printf(SPARAM::MSG_ERROR, (C8*)"Touchstone 2.0 and later files not supported");
-                    return FALSE;
+                    message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+                    result = FALSE;
+                    break;
                 }
+                memcpy(option_line, txt, line_end - txt);
+                option_line[line_end - txt] = 0;
 
-                //
-                // Parse option line (e.g., # GHZ S MA R 50)
-                //
-                if (txt[0] == '#')
+                _strupr(option_line);
+                C8 *src = &option_line[1];
+
+                while (*src)
                 {
-                    if (file_points == 0)      // must be the first non-comment line in the file
+                    if (!_strnicmp(src, "GHZ", 3)) { file_scale = 1E9; src += 3; continue; }
+                    if (!_strnicmp(src, "MHZ", 3)) { file_scale = 1E6; src += 3; continue; }
+                    if (!_strnicmp(src, "KHZ", 3)) { file_scale = 1E3; src += 3; continue; }
+                    if (!_strnicmp(src, "HZ", 2))  { file_scale = 1E0; src += 2; continue; }
+
+                    if (!_strnicmp(src, "DB", 2))  { file_format = SNPTYPE::DB; src += 2; continue; }
+                    if (!_strnicmp(src, "MA", 2))  { file_format = SNPTYPE::MA; src += 2; continue; }
+                    if (!_strnicmp(src, "RI", 2))  { file_format = SNPTYPE::RI; src += 2; continue; }
+
+                    if (!_strnicmp(src, "S", 1))   { file_param = 'S'; src += 1; continue; } // Scattering parameters
+                    if (!_strnicmp(src, "Y", 1))   { file_param = 'Y'; src += 1; continue; } // Admittance parameters
+                    if (!_strnicmp(src, "Z", 1))   { file_param = 'Z'; src += 1; continue; } // Impedance parameters
+                    if (!_strnicmp(src, "H", 1))   { file_param = 'H'; src += 1; continue; } // Hybrid-h parameters
+                    if (!_strnicmp(src, "G", 1))   { file_param = 'G'; src += 1; continue; } // Hybrid-g parameters
+
+                    if (!_strnicmp(src, "R ", 2))
                     {
-                        _strupr(txt);
-                        C8 *src = &txt[1];
-
-                        while (*src)
-                        {
-                            if (!_strnicmp(src, "GHZ", 3)) { file_scale = 1E9; src += 3; continue; }
-                            if (!_strnicmp(src, "MHZ", 3)) { file_scale = 1E6; src += 3; continue; }
-                            if (!_strnicmp(src, "KHZ", 3)) { file_scale = 1E3; src += 3; continue; }
-                            if (!_strnicmp(src, "HZ", 2))  { file_scale = 1E0; src += 2; continue; }
-
-                            if (!_strnicmp(src, "DB", 2))  { file_format = SNPTYPE::DB; src += 2; continue; }
-                            if (!_strnicmp(src, "MA", 2))  { file_format = SNPTYPE::MA; src += 2; continue; }
-                            if (!_strnicmp(src, "RI", 2))  { file_format = SNPTYPE::RI; src += 2; continue; }
-
-                            if (!_strnicmp(src, "S", 1))   { file_param = 'S'; src += 1; continue; } // Scattering parameters
-                            if (!_strnicmp(src, "Y", 1))   { file_param = 'Y'; src += 1; continue; } // Admittance parameters
-                            if (!_strnicmp(src, "Z", 1))   { file_param = 'Z'; src += 1; continue; } // Impedance parameters
-                            if (!_strnicmp(src, "H", 1))   { file_param = 'H'; src += 1; continue; } // Hybrid-h parameters
-                            if (!_strnicmp(src, "G", 1))   { file_param = 'G'; src += 1; continue; } // Hybrid-g parameters
-
-                            if (!_strnicmp(src, "R ", 2))
-                            {
-                                S32 len = 0;
-                                sscanf(src, "R %lf%n", &file_R, &len);
-                                src += len;
-                                continue;
-                            }
-
-                            if (!isspace((U8)*src))
-                            {
-                                message_printf(SPARAM::MSG_WARNING, (C8*)"Unknown option '%s' in %s\n", src, filename);
-                            }
-
-                            src++;
-                        }
-
-                        message_printf(SPARAM::MSG_VERBOSE, (C8*)"\nFilename: %s\n  Header: %s\n   Scale: %lf\n   Param: %c\n    Type: 0x%.2X\n       R: %lf\n",
-                                filename, txt, file_scale, file_param, file_format, file_R);
+                        S32 len = 0;
+                        sscanf(src, "R %lf%n", &file_R, &len);
+                        src += len;
+                        continue;
+                    }
 
-                        if (file_param != 'S')
-                        {
-                            message_printf(SPARAM::MSG_ERROR, (C8*)"%c-parameter files not supported", file_param);
-                            return FALSE;
-                        }
+                    if (!isspace((U8)*src))
+                    {
+                        message_printf(SPARAM::MSG_WARNING, (C8*)"Unknown option '%s' in %s\n", src, filename);
                     }
-                    continue;
+
+                    src++;
                 }
 
-                if (pass == 1)
+                message_printf(SPARAM::MSG_VERBOSE, (C8*)"\nFilename: %s\n  Header: %s\n   Scale: %lf\n   Param: %c\n    Type: 0x%.2X\n       R: %lf\n",
+                        filename, option_line, file_scale, file_param, file_format, file_R);
+
+                if (file_param != 'S')
                 {
-                    ++file_points;
-                    continue;
+                    message_printf(SPARAM::MSG_ERROR, (C8*)"%c-parameter files not supported", file_param);
+                    result = FALSE;
+                    break;
                 }
+                continue;
+            }
 
-                //
-                // Store frequency and complex port data for each point in file
-                //
-                // Frequency must increase monotonically -- if it doesn't, we'll assume we've
-                // hit a noise-parameter block and truncate the record accordingly
-                //
-                DOUBLE R[2][2] = { 0 };
-                DOUBLE I[2][2] = { 0 };
+            //
+            // Store frequency and complex port data for each point in file (missing values are 0)
+            //
+            // Frequency must increase monotonically -- if it doesn't, we'll assume we've
+            // hit a noise-parameter block and truncate the record accordingly
+            //
+            if (file_points == max_rows)
+            {
+                DOUBLE *grow = (max_rows < 0x3FFFFFFF) ? (DOUBLE *)realloc(rows, (size_t)max_rows * 2 * row_values * sizeof(DOUBLE)) : NULL;
 
-                if (n_ports == 1)
+                if (grow == NULL)
                 {
-                    sscanf(txt, "%lf %lf %lf",
-                            &freq_Hz[pt],
-                            &R[0][0], &I[0][0]); // S11
+                    message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+                    result = FALSE;
+                    break;
                 }
-                else
+                rows = grow;
+                max_rows *= 2;
+            }
+
+            DOUBLE *row = &rows[(size_t)file_points * row_values];
+            const C8 *src = txt;
+
+            for (S32 i = 0; i < row_values; i++)
+            {
+                while ((src < line_end) && isspace((U8)*src))
                 {
-                    sscanf(txt, "%lf %lf %lf %lf %lf %lf %lf %lf %lf",
-                            &freq_Hz[pt],
-                            &R[0][0], &I[0][0],  // S11
-                            &R[1][0], &I[1][0],  // S21
-                            &R[0][1], &I[0][1],  // S12
-                            &R[1][1], &I[1][1]); // S22
+                    src++;
                 }
 
-                freq_Hz[pt] *= file_scale;
+                S32 used = (src < line_end) ? SPARAM::text_parse_double(src, line_end, &row[i]) : 0;
 
-                if (freq_Hz[pt] < max_Hz)
+                if (used == 0)
                 {
-                    message_printf(SPARAM::MSG_VERBOSE, (C8*)"  Notice: Truncating file to %d points due to presence of noise record\n", pt);
-                    file_points = n_points = pt;
+                    memset(&row[i], 0, (row_values - i) * sizeof(DOUBLE));
                     break;
                 }
+                src += used;
+            }
+
+            row[0] *= file_scale;
+
+            if (row[0] < last_Hz)
+            {
+                message_printf(SPARAM::MSG_VERBOSE, (C8*)"  Notice: Truncating file to %d points due to presence of noise record\n", file_points);
+                break;
+            }
+
+            last_Hz = row[0];
+            file_points++;
+        }
+
+        FREE(option_line);
+        FREE(text_copy);
+        file.close();
+
+        if (result)
+        {
+            message_printf(SPARAM::MSG_VERBOSE, (C8*)"  Points: %d\n", file_points);
+            result = alloc(file_ports, file_points);
+        }
 
-                if (freq_Hz[pt] < min_Hz) min_Hz = freq_Hz[pt];
-                if (freq_Hz[pt] > max_Hz) max_Hz = freq_Hz[pt];
+        if (result)
+        {
+            //
+            // Values stored in the file data format
+            //
+            for (S32 pt = 0; pt < file_points; pt++)
+            {
+                const DOUBLE *row = &rows[(size_t)pt * row_values];
+                freq_Hz[pt] = row[0];
+            }
+
+            min_Hz = freq_Hz[0];
+            max_Hz = freq_Hz[file_points - 1];
 
-                for (S32 b = 0; b < n_ports; b++)
+            for (S32 b = 0; b < n_ports; b++)
+            {
+                for (S32 a = 0; a < n_ports; a++)
                 {
-                    for (S32 a = 0; a < n_ports; a++)
-                    {
-                        valid[b][a][pt] = file_format;
+                    const DOUBLE *row = &rows[1 + 2 * (a * n_ports + b)];
 
+                    for (S32 pt = 0; pt < file_points; pt++, row += row_values)
+                    {
                         switch (file_format)
                         {
-                            case SNPTYPE::DB:
-                            {
-                                DB[b][a][pt].dB = R[b][a];
-                                DB[b][a][pt].deg = I[b][a];
-                                break;
-                            }
-
-                            case SNPTYPE::MA:
-                            {
-                                MA[b][a][pt].mag = R[b][a];
-                                MA[b][a][pt].deg = I[b][a];
-                                break;
-                            }
-
-                            case SNPTYPE::RI:
-                            {
-                                RI[b][a][pt].real = R[b][a];
-                                RI[b][a][pt].imag = I[b][a];
-                                break;
-                            }
+                            case SNPTYPE::DB: DB[b][a][pt] = SPARAM::DB(row[0], row[1]); break;
+                            case SNPTYPE::RI: RI[b][a][pt] = SPARAM::RI(row[0], row[1]); break;
+                            default: MA[b][a][pt] = SPARAM::MA(row[0], row[1]); break;
                         }
                     }
+                    memset(valid[b][a], file_format, file_points);
                 }
+            }
 
-                pt++;
-            } //  end for (;;)
-            fclose(in);
-            in = NULL;
-        } // for (S32 pass = 1; pass <= 2; pass++)
+            message_printf(SPARAM::MSG_VERBOSE, (C8*)"  Min Hz: %lf\n  Max Hz: %lf\n", min_Hz, max_Hz);
+            message_printf(SPARAM::MSG_VERBOSE, (C8*)"\n");
 
-        message_printf(SPARAM::MSG_VERBOSE, (C8*)"  Min Hz: %lf\n  Max Hz: %lf\n", min_Hz, max_Hz);
-        message_printf(SPARAM::MSG_VERBOSE, (C8*)"\n");
+            Zo = file_R;
+        }
 
-        Zo = file_R;
-        return TRUE;
+        FREE(rows);
+        return result;
     }
 
     // --------------------------------------------------------------------------------------------------
@@ -1493,39 +2892,66 @@ struct SPARAMS
         DOUBLE Hz = out_min_Hz;
         DOUBLE d_Hz = (out_max_Hz - out_min_Hz) / n_out_points;
 
-        for (S32 i = 0; i < n_out_points; i++)
+        for (S32 i = 0; i < n_out_points; i++)
+        {
+            out_Hz[i] = Hz;
+            Hz += d_Hz;
+        }
+    }
+
+    // ---------------------------------
+    // Spline interpolators
+    //
+    // The MA magnitude (which = 0) or phase (which = 1) trace of [b][a] is solved once by
+    // spline_trace() and kept in spline_plan[which] until the data changes or another parameter
+    // is interpolated, so zoom/pan re-evaluations only evaluate the plan (no allocation)
+    // ---------------------------------
+
+    SPLINE_PLAN *spline_trace(S32 which, S32 b, S32 a)
+    {
+        SPLINE_PLAN *plan = &spline_plan[which];
+        S32 param = b * n_ports + a;
+
+        if (spline_param[which] == param)
+        {
+            return plan;
+        }
+
+        spline_param[which] = -1;
+
+        if (!spline_plan_reserve(plan, n_points))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+            return NULL;
+        }
+
+        memcpy(plan->X, freq_Hz, n_points * sizeof(DOUBLE));
+
+        for (S32 i = 0; i < n_points; i++)
+        {
+            SPARAM::MA val = get_MA(i, b, a);
+            plan->Y[i] = (which == 0) ? val.mag : val.deg;
+        }
+
+        if (!spline_plan_solve(plan, SPLINE_NATURAL))
         {
-            out_Hz[i] = Hz;
-            Hz += d_Hz;
+            return NULL;
         }
-    }
 
-    // ---------------------------------
-    // Spline interpolators
-    // ---------------------------------
+        spline_param[which] = param;
+        return plan;
+    }
 
-    virtual void spline_dB(S32     b,
+    void spline_trace_eval(S32     which,
+            S32     b,
             S32     a,
             DOUBLE  out_min_Hz,
             DOUBLE  out_max_Hz,
             S32     n_out_points,
-            DOUBLE *out_dB,
-            DOUBLE *out_Hz = NULL)
+            DOUBLE  out_of_range_Y,
+            DOUBLE *dest_X,
+            DOUBLE *dest_Y)
     {
-        Q_UNUSED(b);
-        Q_UNUSED(a);
-        DOUBLE *src_X = (DOUBLE *)alloca(n_points * sizeof(DOUBLE));
-        DOUBLE *src_Y = (DOUBLE *)alloca(n_points * sizeof(DOUBLE));
-
-        for (S32 i = 0; i < n_points; i++)
-        {
-            src_X[i] = freq_Hz[i];
-            src_Y[i] = get_MA(i, 1, 0).mag;
-        }
-
-        DOUBLE *dest_X = (DOUBLE *)alloca(n_out_points * sizeof(DOUBLE));
-        DOUBLE *dest_Y = (DOUBLE *)alloca(n_out_points * sizeof(DOUBLE));
-
         S32 p0 = -1;
         S32 p1 = -1;
 
@@ -1535,7 +2961,7 @@ struct SPARAMS
         for (S32 i = 0; i < n_out_points; i++)         // Find first and last screen points that have valid S2P data
         {
             dest_X[i] = Hz;
-            dest_Y[i] = 1E-15;
+            dest_Y[i] = out_of_range_Y;
 
             if ((Hz >= min_Hz) && (p0 == -1))
                 p0 = i;
@@ -1549,14 +2975,11 @@ struct SPARAMS
         if ((p0 != -1) && (p1 != -1))
         {
             S32 dN = p1 - p0 + 1;
+            SPLINE_PLAN *plan = (dN > 0) ? spline_trace(which, b, a) : NULL;
 
-            if (dN > 0)
+            if (plan != NULL)
             {
-                DOUBLE *dX = &dest_X[p0];              // Interpolate S2P data to uniform grid between frequencies of interest
-                DOUBLE *dY = &dest_Y[p0];
-
-                spline_gen(src_X, src_Y, n_points,
-                        dX, dY, dN);
+                spline_plan_eval(plan, &dest_X[p0], &dest_Y[p0], dN);   // Interpolate S2P data to uniform grid between frequencies of interest
             }
         }
 
@@ -1571,105 +2994,67 @@ struct SPARAMS
             for (S32 i = p1 + 1; i < n_out_points; i++)
                 dest_Y[i] = dest_Y[p1];
         }
+    }
 
-        if (out_Hz == NULL)                          // Return interpolated linear magnitude in dB
-        {
-            for (S32 i = 0; i < n_out_points; i++)      // Clamp the log10() argument since steep edges can cause ringing into the negative range
-            {
-                out_dB[i] = 20.0 * log10(max(1E-15, dest_Y[i]));
-            }
-        }
-        else
+    DOUBLE *spline_grid(S32 n_out_points)
+    {
+        if (n_out_points > spline_Hz_size)
         {
-            for (S32 i = 0; i < n_out_points; i++)
+            FREE(spline_Hz);
+            spline_Hz_size = 0;
+
+            spline_Hz = (DOUBLE *)malloc(n_out_points * sizeof(DOUBLE));
+
+            if (spline_Hz == NULL)
             {
-                out_Hz[i] = dest_X[i];
-                out_dB[i] = 20.0 * log10(max(1E-15, dest_Y[i]));
+                message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+                return NULL;
             }
+            spline_Hz_size = n_out_points;
         }
+
+        return spline_Hz;
     }
 
-    virtual void spline_deg(S32     b,
+    virtual void spline_dB(S32     b,
             S32     a,
             DOUBLE  out_min_Hz,
             DOUBLE  out_max_Hz,
             S32     n_out_points,
-            DOUBLE *out_deg,
+            DOUBLE *out_dB,
             DOUBLE *out_Hz = NULL)
     {
-        DOUBLE *src_X = (DOUBLE *)alloca(n_points * sizeof(DOUBLE));
-        DOUBLE *src_Y = (DOUBLE *)alloca(n_points * sizeof(DOUBLE));
-
-        for (S32 i = 0; i < n_points; i++)
-        {
-            src_X[i] = freq_Hz[i];
-            src_Y[i] = get_MA(i, b, a).deg;
-        }
-
-        DOUBLE *dest_X = (DOUBLE *)alloca(n_out_points * sizeof(DOUBLE));
-        DOUBLE *dest_Y = (DOUBLE *)alloca(n_out_points * sizeof(DOUBLE));
-
-        DOUBLE Hz = out_min_Hz;
-        DOUBLE d_Hz = (out_max_Hz - out_min_Hz) / n_out_points;
-
-        S32 p0 = -1;
-        S32 p1 = -1;
+        DOUBLE *dest_X = (out_Hz != NULL) ? out_Hz : spline_grid(n_out_points);
 
-        for (S32 i = 0; i < n_out_points; i++)         // Find first and last screen points that have valid S2P data
+        if (dest_X == NULL)
         {
-            dest_X[i] = Hz;
-            dest_Y[i] = 180.0;
-
-            if ((Hz >= min_Hz) && (p0 == -1))
-                    p0 = i;
-
-            if (Hz <= max_Hz)
-                    p1 = i;
-
-            Hz += d_Hz;
+            return;
         }
 
-        if ((p0 != -1) && (p1 != -1))
-        {
-            S32 dN = p1 - p0 + 1;
-
-            if (dN > 0)
-            {
-                DOUBLE *dX = &dest_X[p0];              // Interpolate S2P data to uniform grid between frequencies of interest
-                DOUBLE *dY = &dest_Y[p0];
+        spline_trace_eval(0, b, a, out_min_Hz, out_max_Hz, n_out_points, 1E-15, dest_X, out_dB);
 
-                spline_gen(src_X, src_Y, n_points,
-                        dX, dY, dN);
-            }
+        for (S32 i = 0; i < n_out_points; i++)          // Return interpolated linear magnitude in dB
+        {                                               // Clamp the log10() argument since steep edges can cause ringing into the negative range
+            out_dB[i] = 20.0 * log10(max(1E-15, out_dB[i]));
         }
+    }
 
-        if (p0 != -1)                                // Set all other points equal to first/last valid values
-        {
-            for (S32 i = 0; i < p0; i++)
-                dest_Y[i] = dest_Y[p0];
-        }
+    virtual void spline_deg(S32     b,
+            S32     a,
+            DOUBLE  out_min_Hz,
+            DOUBLE  out_max_Hz,
+            S32     n_out_points,
+            DOUBLE *out_deg,
+            DOUBLE *out_Hz = NULL)
+    {
+        DOUBLE *dest_X = (out_Hz != NULL) ? out_Hz : spline_grid(n_out_points);
 
-        if (p1 != -1)
+        if (dest_X == NULL)
         {
-            for (S32 i = p1 + 1; i < n_out_points; i++)
-                dest_Y[i] = dest_Y[p1];
+            return;
         }
 
-        if (out_Hz == NULL)
-        {
-            for (S32 i = 0; i < n_out_points; i++)
-            {
-                out_deg[i] = dest_Y[i];
-            }
-        }
-        else
-        {
-            for (S32 i = 0; i < n_out_points; i++)
-            {
-                out_Hz[i] = dest_X[i];
-                out_deg[i] = dest_Y[i];
-            }
-        }
+        spline_trace_eval(1, b, a, out_min_Hz, out_max_Hz, n_out_points, 180.0, dest_X, out_deg);
     }
 
     // ---------------------------------
@@ -1685,6 +3070,11 @@ struct SPARAMS
             bool   *out_valid,
             U8      flags)
     {
+        if (forms & SNPTYPE::MA)                 // Interpolation is done on MA (see get_MA(Hz, ...)), convert it once
+        {
+            materialize(SNPTYPE::MA, b, a);
+        }
+
         DOUBLE Hz = out_min_Hz;
         DOUBLE d_Hz = (out_max_Hz - out_min_Hz) / n_out_points;
 
@@ -1717,6 +3107,11 @@ struct SPARAMS
             bool   *out_valid,
             U8      flags)
     {
+        if (forms & SNPTYPE::MA)                 // Interpolation is done on MA (see get_MA(Hz, ...)), convert it once
+        {
+            materialize(SNPTYPE::MA, b, a);
+        }
+
         DOUBLE Hz = out_min_Hz;
         DOUBLE d_Hz = (out_max_Hz - out_min_Hz) / n_out_points;
 
@@ -1738,5 +3133,320 @@ struct SPARAMS
             }
         }
     }
+    // ---------------------------------
+    // Batched resampling
+    // ---------------------------------
+
+    // --------------------------------------------------------------------------------------------------
+    // Resample all the parameters at once on dest_Hz[n_dest] (any order, ascending is the fast path)
+    //
+    // The source interval of each destination frequency is located once (galloping search from the
+    // previous one, same interval and fraction as nearest_freq_Hz()) and used for all the parameters.
+    // The outputs are interleaved per point, parameters in Touchstone order (S11, S21, S12, S22):
+    //
+    //   out_RI[pt * n_ports * n_ports + param]  Real-imag
+    //   out_DB[pt * n_ports * n_ports + param]  dB-angle
+    //   out_valid[pt]                           FALSE if out of range without extrapolation (see flags)
+    //
+    // Any output can be NULL.
+    //
+    //   SPARAM::RESAMPLE_LINEAR: same values as get_RI(Hz) and get_DB(Hz) (linear real-imag, linear
+    //                            magnitude and wrapped phase)
+    //   SPARAM::RESAMPLE_SPLINE: natural spline of real-imag, magnitude and phase (same values as
+    //                            spline_dB()/spline_deg()), the traces are solved once until the data
+    //                            changes (see spline_invalidate())
+    //
+    // Out of range frequencies follow flags (SPARAM::EXT_xx, see get_RI(Hz)).
+    // Grids of more than SPARAM::RESAMPLE_THREAD_POINTS points are split over up to n_threads threads.
+    // --------------------------------------------------------------------------------------------------
+    virtual bool resample(const DOUBLE *dest_Hz,
+            S32         n_dest,
+            SPARAM::RI *out_RI,
+            SPARAM::DB *out_DB,
+            bool       *out_valid = NULL,
+            U8          flags = 0,
+            U8          mode = SPARAM::RESAMPLE_LINEAR,
+            S32         n_threads = 1)
+    {
+        if (n_points < 1)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Empty data set");
+            return FALSE;
+        }
+
+        if (n_ports * n_ports > SPARAM::RESAMPLE_MAX_PARAMS)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)">4 ports not supported");
+            return FALSE;
+        }
+
+        //
+        // Source formats converted once (the workers only read the database)
+        //
+        for (S32 b = 0; b < n_ports; b++)
+        {
+            for (S32 a = 0; a < n_ports; a++)
+            {
+                materialize(SNPTYPE::RI, b, a, conversion_mode);
+
+                if ((out_DB != NULL) && (forms & SNPTYPE::MA))
+                {
+                    materialize(SNPTYPE::MA, b, a, conversion_mode);
+                }
+            }
+        }
+
+        if ((mode == SPARAM::RESAMPLE_SPLINE) && (n_points > 1) && !resample_solve())
+        {
+            return FALSE;
+        }
+
+        n_threads = max(1, min(n_threads, n_dest / SPARAM::RESAMPLE_THREAD_POINTS));
+
+        if (n_threads == 1)
+        {
+            resample_range(dest_Hz, 0, n_dest, out_RI, out_DB, out_valid, flags, mode);
+            return TRUE;
+        }
+
+        std::vector<std::thread> workers;
+        S32 chunk = (n_dest + n_threads - 1) / n_threads;
+
+        for (S32 t = 1; t < n_threads; t++)
+        {
+            S32 begin = t * chunk;
+            S32 end = min(n_dest, begin + chunk);
+
+            workers.push_back(std::thread(&SPARAMS::resample_range, this, dest_Hz, begin, end, out_RI, out_DB, out_valid, flags, mode));
+        }
+
+        resample_range(dest_Hz, 0, chunk, out_RI, out_DB, out_valid, flags, mode);
+
+        for (size_t t = 0; t < workers.size(); t++)
+        {
+            workers[t].join();
+        }
+
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Solve the resample() spline traces: real, imag, magnitude and phase of each parameter
+    // --------------------------------------------------------------------------------------------------
+    bool resample_solve(void)
+    {
+        S32 n_plans = 4 * n_ports * n_ports;
+
+        if (resample_solved)
+        {
+            return TRUE;
+        }
+
+        if (n_plans > resample_n_plans)
+        {
+            delete[] resample_plans;
+            resample_plans = new SPLINE_PLAN[n_plans];
+            resample_n_plans = n_plans;
+        }
+
+        for (S32 param = 0; param < n_ports * n_ports; param++)
+        {
+            S32 b = param % n_ports;
+            S32 a = param / n_ports;
+            SPLINE_PLAN *plan = &resample_plans[4 * param];
+
+            for (S32 q = 0; q < 4; q++)
+            {
+                if (!spline_plan_reserve(&plan[q], n_points))
+                {
+                    message_printf(SPARAM::MSG_ERROR, (C8*)"Out of memory");
+                    return FALSE;
+                }
+                memcpy(plan[q].X, freq_Hz, n_points * sizeof(DOUBLE));
+            }
+
+            for (S32 i = 0; i < n_points; i++)
+            {
+                SPARAM::MA ma = get_MA(i, b, a);
+
+                plan[0].Y[i] = RI[b][a][i].real;
+                plan[1].Y[i] = RI[b][a][i].imag;
+                plan[2].Y[i] = ma.mag;
+                plan[3].Y[i] = ma.deg;
+            }
+
+            for (S32 q = 0; q < 4; q++)
+            {
+                spline_plan_solve(&plan[q], SPLINE_NATURAL);
+            }
+        }
+
+        resample_solved = TRUE;
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // resample() of the destination points [begin, end) (read only, run by the worker threads)
+    // --------------------------------------------------------------------------------------------------
+    void resample_range(const DOUBLE *dest_Hz,
+            S32         begin,
+            S32         end,
+            SPARAM::RI *out_RI,
+            SPARAM::DB *out_DB,
+            bool       *out_valid,
+            U8          flags,
+            U8          mode)
+    {
+        S32 n_params = n_ports * n_ports;
+        S32 last = n_points - 1;
+        bool spline = (mode == SPARAM::RESAMPLE_SPLINE) && (n_points > 1);
+
+        const SPARAM::RI *src_RI[SPARAM::RESAMPLE_MAX_PARAMS];
+        const SPARAM::MA *src_MA[SPARAM::RESAMPLE_MAX_PARAMS];
+
+        for (S32 param = 0; param < n_params; param++)
+        {
+            src_RI[param] = RI[param % n_ports][param / n_ports];
+            src_MA[param] = (MA != NULL) ? MA[param % n_ports][param / n_ports] : NULL;
+        }
+
+        S32 u = 0;
+
+        for (S32 i = begin; i < end; i++)
+        {
+            DOUBLE Hz = dest_Hz[i];
+            SPARAM::RI *RI_i = (out_RI != NULL) ? &out_RI[i * n_params] : NULL;
+            SPARAM::DB *DB_i = (out_DB != NULL) ? &out_DB[i * n_params] : NULL;
+
+            //
+            // Source interval p0, p1 (= p0 at the ends) and fraction A, or zero value
+            //
+            S32 p0 = 0;
+            S32 p1 = 0;
+            DOUBLE A = 0.0;
+            bool zero = FALSE;
+            bool in_range = TRUE;
+            bool interpolate = FALSE;
+
+            if ((Hz < min_Hz) || (Hz > max_Hz))
+            {
+                bool low = (Hz < min_Hz);
+
+                if (flags & SPARAM::EXT_ZERO)
+                {
+                    zero = TRUE;
+                }
+                else if (flags & (low ? SPARAM::EXT_LEND : SPARAM::EXT_REND))
+                {
+                    p0 = p1 = low ? 0 : last;
+                }
+                else
+                {
+                    zero = TRUE;
+                    in_range = FALSE;
+                }
+            }
+            else
+            {
+                u = lerp_upper(freq_Hz, n_points, u, Hz);
+
+                if (u <= 0)
+                {
+                    p0 = p1 = 0;
+                }
+                else if (u > last)
+                {
+                    p0 = p1 = last;
+                }
+                else
+                {
+                    p0 = u - 1;
+                    p1 = u;
+                    A = (Hz - freq_Hz[p0]) / (freq_Hz[p1] - freq_Hz[p0]);
+                }
+                interpolate = spline;
+            }
+
+            if (out_valid != NULL)
+            {
+                out_valid[i] = in_range;
+            }
+
+            if (zero)
+            {
+                for (S32 param = 0; param < n_params; param++)
+                {
+                    if (RI_i != NULL) RI_i[param] = SPARAM::RI(0.0, 0.0);
+                    if (DB_i != NULL) DB_i[param] = SPARAM::DB(SPARAM::MA(0.0, 0.0));
+                }
+                continue;
+            }
+
+            if (interpolate)
+            {
+                //
+                // Spline weights of the interval (same arithmetic as spline_plan_eval())
+                //
+                S32 cur = min(max(u - 1, 0), last - 1);
+                S32 next = cur + 1;
+
+                DOUBLE h = freq_Hz[next] - freq_Hz[cur];
+
+                if (h <= 0.0) h = 0.0001;
+
+                DOUBLE wa = (freq_Hz[next] - Hz) / h;
+                DOUBLE wb = (Hz - freq_Hz[cur]) / h;
+                DOUBLE wa3 = wa * wa * wa - wa;
+                DOUBLE wb3 = wb * wb * wb - wb;
+                DOUBLE hh = h * h;
+
+                for (S32 param = 0; param < n_params; param++)
+                {
+                    DOUBLE y[4];
+                    const SPLINE_PLAN *plan = &resample_plans[4 * param];
+
+                    for (S32 q = 0; q < 4; q++)
+                    {
+                        y[q] = (wa * plan[q].Y[cur]) + (wb * plan[q].Y[next]) + ((wa3 * plan[q].D[cur]) + (wb3 * plan[q].D[next])) * hh / 6.0;
+                    }
+
+                    if (RI_i != NULL) RI_i[param] = SPARAM::RI(y[0], y[1]);
+                    if (DB_i != NULL) DB_i[param] = SPARAM::DB(20.0 * log10(max(1E-15, y[2])), y[3]);
+                }
+                continue;
+            }
+
+            for (S32 param = 0; param < n_params; param++)
+            {
+                if (RI_i != NULL)
+                {
+                    SPARAM::RI v0 = src_RI[param][p0];
+                    SPARAM::RI v1 = src_RI[param][p1];
+
+                    RI_i[param] = SPARAM::RI(v0.real + ((v1.real - v0.real) * A),
+                            v0.imag + ((v1.imag - v0.imag) * A));
+                }
+
+                if (DB_i != NULL)
+                {
+                    SPARAM::MA v0 = (src_MA[param] != NULL) ? src_MA[param][p0] : SPARAM::MA(src_RI[param][p0]);
+                    SPARAM::MA v1 = (src_MA[param] != NULL) ? src_MA[param][p1] : SPARAM::MA(src_RI[param][p1]);
+
+                    DOUBLE d = v1.deg - v0.deg;
+
+                    while (d < -180.0) d += 360.0;      // Same phase wrap as get_MA(Hz)
+                    while (d > 180.0) d -= 360.0;
+
+                    DOUBLE interp_mag = v0.mag + ((v1.mag - v0.mag) * A);
+                    DOUBLE interp_deg = v0.deg + (d * A);
+
+                    while (interp_deg < -180.0) interp_deg += 360.0;
+                    while (interp_deg > 180.0) interp_deg -= 360.0;
+
+                    DB_i[param] = SPARAM::DB(SPARAM::MA(interp_mag, interp_deg));
+                }
+            }
+        }
+    }
 };
 
@@ -1,150 +1,211 @@
 //***************************************************************************
 //
-// For each destination X, find pair of source points containing it and interpolate the corresponding
-// source Y interval to destination Y
+// First source index u with src_X[u] > x (src_len if none) for ascending src_X, galloping
+// (1, 2, 4... steps then binary search) from the previous result u
 //
 //***************************************************************************
 
-void lerp_gen (DOUBLE *src_X,  DOUBLE *src_Y,  S32 src_len, //)
-               DOUBLE *dest_X, DOUBLE *dest_Y, S32 dest_len)
+static inline S32 lerp_upper (DOUBLE *src_X, S32 src_len, S32 u, DOUBLE x)
 {
-   if ((dest_X[0] < src_X[0]) || (dest_X[dest_len-1] > src_X[src_len-1]))
+   if ((u < src_len) && (src_X[u] <= x))
       {
-      assert(0);
-      }
+      S32 lo   = u;                              // src_X[lo] <= x
+      S32 step = 1;
 
-   S32 s=0,d=0;
+      while ((lo + step < src_len) && (src_X[lo + step] <= x))
+         {
+         lo   += step;
+         step <<= 1;
+         }
 
-   for (d=0; d < dest_len; d++)
-      {
-      DOUBLE x = dest_X[d];
+      S32 hi = min(lo + step, src_len);           // src_X[hi] > x (or src_len)
 
-      for (s=0; s < src_len-1; s++)
+      while (hi - lo > 1)
          {
-         if ((src_X[s] <= x) && (src_X[s+1] >= x))
-            {
-            break;
-            }
+         S32 mid = (lo + hi) >> 1;
+
+         if (src_X[mid] <= x) lo = mid; else hi = mid;
          }
 
-      assert(s < src_len-1);
+      return hi;
+      }
 
-      DOUBLE ds = src_X[s+1] - src_X[s];
+   if ((u > 0) && (src_X[u-1] > x))
+      {
+      S32 hi   = u-1;                            // src_X[hi] > x
+      S32 step = 1;
 
-      assert(fabs(ds) > 1E-30);
+      while ((hi - step >= 0) && (src_X[hi - step] > x))
+         {
+         hi   -= step;
+         step <<= 1;
+         }
 
-      DOUBLE alpha = (x - src_X[s]) / ds;       // fraction from s to s+1
+      S32 lo = max(hi - step, -1);                // src_X[lo] <= x (or -1)
 
-      ds = src_Y[s+1] - src_Y[s];
+      while (hi - lo > 1)
+         {
+         S32 mid = (lo + hi) >> 1;
 
-      dest_Y[d] = src_Y[s] + (ds * alpha);
+         if (src_X[mid] <= x) lo = mid; else hi = mid;
+         }
+
+      return hi;
       }
+
+   return u;
 }
 
 //***************************************************************************
 //
-// Cubic spline interpolators from Wolberg, Digital Image Warping, p. 293
+// For each destination X, find pair of source points containing it and interpolate the corresponding
+// source Y interval to destination Y
 //
-// Alternative version (spline_gen) derived from Numerical Recipes 3rd Edition, p. 121
-// has slightly better endpoint behavior
+// src_X must be in ascending order, else FALSE is returned and dest_Y is not written. Duplicated
+// X values are allowed: zero width intervals are skipped, so a duplicated X returns the Y of its
+// last point (steps in the source data are kept).
+// Destination points outside src_X[0]..src_X[src_len-1] get the end point value (src_Y[0] or
+// src_Y[src_len-1]).
+// dest_X can be in any order. The interval is searched from the previous one (galloping search) and
+// consecutive destination points of the same interval are interpolated in one (vectorized) loop,
+// so ascending dest_X (usual resampling case) is O(src_len + dest_len).
 //
 //***************************************************************************
 
-void spline_gen (DOUBLE *src_X,  DOUBLE *src_Y,  S32 src_len, //)
-                 DOUBLE *dest_X, DOUBLE *dest_Y, S32 dest_len)
+bool lerp_gen (DOUBLE *src_X,  DOUBLE *src_Y,  S32 src_len, //)
+               DOUBLE *dest_X, DOUBLE *dest_Y, S32 dest_len)
 {
-   if ((dest_X[0] < src_X[0]) || (dest_X[dest_len-1] > src_X[src_len-1]))
+   if (src_len < 1)
       {
-      assert(0);
+      return FALSE;
       }
 
-   //
-   // Calculate second derivatives at input points, guarding against
-   // division by infinitesimals or zero that can happen with
-   // vertical or coincident segments
-   //
-
-   DOUBLE *D2  = (DOUBLE *) malloc(src_len * sizeof(DOUBLE)); if (D2 == NULL) {           return; }
-   DOUBLE *YD  = (DOUBLE *) malloc(src_len * sizeof(DOUBLE)); if (YD == NULL) { free(D2); return; }
-
-   D2[0] = YD[0] = 0.0;
+   bool ascending = TRUE;
 
-   for (S32 i=1; i < src_len-1; i++)
+   for (S32 s=1; s < src_len; s++)
       {
-      DOUBLE epsilon = fabs(src_X[i]) * 1E-6;
+      ascending &= (src_X[s] >= src_X[s-1]);     // (FALSE for NaN)
+      }
 
-      DOUBLE h0 =  src_X[i]   - src_X[i-1];
-      DOUBLE h1 =  src_X[i+1] - src_X[i-1];
-      DOUBLE h2 =  src_X[i+1] - src_X[i];
+   if (!ascending)
+      {
+      return FALSE;
+      }
 
-      if (fabs(h0) < epsilon) h0 = epsilon;
-      if (fabs(h1) < epsilon) h1 = epsilon;
-      if (fabs(h2) < epsilon) h2 = epsilon;
+   S32 last = src_len-1;
+   S32 u = 0;
+   S32 d = 0;
 
-      DOUBLE r0 = (src_Y[i]   - src_Y[i-1]) / h0;
-      DOUBLE r1 = (src_Y[i+1] - src_Y[i])   / h2;
+   while (d < dest_len)
+      {
+      u = lerp_upper(src_X, src_len, u, dest_X[d]);
 
-      DOUBLE h = h0 / h1;
-      DOUBLE p = 1.0 / (h * D2[i-1] + 2.0);
+      S32 s   = u-1;                             // src_X[s] <= x < src_X[s+1]
+      S32 end = d+1;                             // Run of destination points in the same interval
 
-      D2[i] = (h - 1.0) * p;
-      YD[i] = (((6.0 * (r1 - r0)) / h1) - (h * YD[i-1])) * p;
-      }
+      if (s < 0)
+         {
+         while ((end < dest_len) && (dest_X[end] < src_X[0])) end++;
 
-   D2[src_len-1] = 0.0;
+         for (; d < end; d++) dest_Y[d] = src_Y[0];
+         continue;
+         }
 
-   for (S32 i=src_len-2; i >= 0; i--)
-      {
-      D2[i] = (D2[i] * D2[i+1]) + YD[i];
-      }
+      if (s >= last)
+         {
+         while ((end < dest_len) && (dest_X[end] >= src_X[last])) end++;
 
-   //
-   // For each output X...
-   //
+         for (; d < end; d++) dest_Y[d] = src_Y[last];
+         continue;
+         }
 
-   S32 cur = 0;
+      DOUBLE x0 = src_X[s];
+      DOUBLE x1 = src_X[s+1];
 
-   for (S32 i=0; i < dest_len; i++)
-      {
-      DOUBLE x = dest_X[i];
+      while ((end < dest_len) && (dest_X[end] >= x0) && (dest_X[end] < x1)) end++;
 
-      //
-      // Find input interval containing this X
-      //
+      DOUBLE ds = x1 - x0;                       // > 0 (zero width intervals are never selected)
+      DOUBLE y0 = src_Y[s];
+      DOUBLE dy = src_Y[s+1] - y0;
 
-      while ((src_X[cur+1] <= x) && (cur+1 < src_len))
+      for (; d < end; d++)
          {
-         cur++;
+         DOUBLE alpha = (dest_X[d] - x0) / ds;   // fraction from s to s+1
+
+         dest_Y[d] = y0 + (dy * alpha);
          }
+      }
 
-      //
-      // Perform cubic spline interpolation
-      //
+   return TRUE;
+}
 
-      S32 next = cur+1;
+//***************************************************************************
+//
+// Spline plan: source trace copied and its derivatives solved once (spline_plan_set() or
+// spline_plan_reserve() + fill X/Y + spline_plan_solve()), then evaluated on any number of
+// destination grids with spline_plan_eval() in O(dest_len) for ascending destination X.
+// The buffer is kept (only grown) when the plan is set again, so a reused plan costs no
+// allocation. spline_plan_eval() doesn't modify the plan (can be shared by several threads).
+//
+// SPLINE_NATURAL: natural cubic spline of spline_gen()
+// SPLINE_HERMITE: cubic Hermite spline with continuous second derivatives of ispline_gen()
+//
+//***************************************************************************
 
-      DOUBLE h = src_X[next] - src_X[cur];
+const S32 SPLINE_NATURAL = 0;
+const S32 SPLINE_HERMITE = 1;
+
+struct SPLINE_PLAN
+{
+   S32     kind;                  // SPLINE_NATURAL or SPLINE_HERMITE (valid after spline_plan_solve())
+   S32     n;                     // Source points
+   S32     capacity;              // Source points allocated in buffer
+   DOUBLE *buffer;
+   DOUBLE *X;                     // [n] Source X (ascending)
+   DOUBLE *Y;                     // [n] Source Y
+   DOUBLE *D;                     // [n] Second (SPLINE_NATURAL) or first (SPLINE_HERMITE) derivatives
+   DOUBLE *W;                     // [4*n] Solve work arrays
+
+   SPLINE_PLAN() : kind(-1), n(0), capacity(0), buffer(NULL), X(NULL), Y(NULL), D(NULL), W(NULL)
+      {
+      }
+
+   ~SPLINE_PLAN()
+      {
+      FREE(buffer);
+      }
 
-      if (h <= 0.0) h = 0.0001;                 // HACK
-      assert(h > 0.0);                          // TODO: fired in Phase view 
+   SPLINE_PLAN(const SPLINE_PLAN &) = delete;
+   SPLINE_PLAN &operator = (const SPLINE_PLAN &) = delete;
+};
 
-      DOUBLE a = (src_X[next] - x) / h;
-      DOUBLE b = (x - src_X[cur])  / h;
+bool spline_plan_reserve (SPLINE_PLAN *plan, S32 src_len)
+{
+   if (src_len > plan->capacity)
+      {
+      DOUBLE *buffer = (DOUBLE *) malloc(7 * (size_t) src_len * sizeof(DOUBLE));
+      if (buffer == NULL) return FALSE;
 
-      dest_Y[i] = (a*src_Y[cur]) + (b*src_Y[next]) + (((a*a*a-a)*D2[cur]) + ((b*b*b-b)*D2[next])) * (h*h) / 6.0;
+      FREE(plan->buffer);
+      plan->buffer   = buffer;
+      plan->capacity = src_len;
       }
 
-   free(YD);
-   free(D2);
+   plan->kind = -1;
+   plan->n    = src_len;
+   plan->X    = plan->buffer;
+   plan->Y    = plan->X + src_len;
+   plan->D    = plan->Y + src_len;
+   plan->W    = plan->D + src_len;
+
+   return TRUE;
 }
 
-static void tridiag_gen(DOUBLE *A, DOUBLE *B, DOUBLE *C, DOUBLE *D, S32 len)
+static void tridiag_gen(DOUBLE *A, DOUBLE *B, DOUBLE *C, DOUBLE *D, S32 len, //)
+                        DOUBLE *F)
 {
    S32 i;
-   DOUBLE b, *F;
-
-   F = (DOUBLE *) malloc(len * sizeof(DOUBLE)); 
-   if (F == NULL) return;
+   DOUBLE b;
 
    b = B[0];
    D[0] = D[0] / b;
@@ -163,18 +224,18 @@ static void tridiag_gen(DOUBLE *A, DOUBLE *B, DOUBLE *C, DOUBLE *D, S32 len)
       {
       D[i] -= (D[i+1] * F[i+1]);
       }
-
-   free(F);
 }
 
-static void getYD_gen(DOUBLE *X, DOUBLE *Y, DOUBLE *YD, S32 len)
+static void getYD_gen(DOUBLE *X, DOUBLE *Y, DOUBLE *YD, S32 len, //)
+                      DOUBLE *W)
 {
    S32 i;
-   DOUBLE h0, h1, r0, r1, *A, *B, *C;
+   DOUBLE h0, h1, r0, r1;
 
-   A = (DOUBLE *) malloc(len * sizeof(DOUBLE)); if (A == NULL) {                   return; }
-   B = (DOUBLE *) malloc(len * sizeof(DOUBLE)); if (B == NULL) { free(A);          return; }
-   C = (DOUBLE *) malloc(len * sizeof(DOUBLE)); if (C == NULL) { free(B); free(A); return; }
+   DOUBLE *A = W;                 // Work arrays W[4*len]
+   DOUBLE *B = A + len;
+   DOUBLE *C = B + len;
+   DOUBLE *F = C + len;
 
    h0 = X[1] - X[0];
    h1 = X[2] - X[1];
@@ -201,57 +262,217 @@ static void getYD_gen(DOUBLE *X, DOUBLE *Y, DOUBLE *YD, S32 len)
    B[i] = h0 * (h0 + h1);
    YD[i] = r0 * h1 * h1 + r1 * (3.0 * h0 * h1 + 2.0 * h0 * h0);
 
-   tridiag_gen(A, B, C, YD, len);
-
-   free(C);
-   free(B);
-   free(A);
+   tridiag_gen(A, B, C, YD, len, F);
 }
 
-void ispline_gen(DOUBLE *X1, DOUBLE *Y1, S32 len1, //)
-                 DOUBLE *X2, DOUBLE *Y2, S32 len2)
+//
+// Solve the derivatives of plan->X/Y[plan->n] (FALSE if there are not enough points:
+// 2 for SPLINE_NATURAL, 3 for SPLINE_HERMITE)
+//
+
+bool spline_plan_solve (SPLINE_PLAN *plan, S32 kind)
 {
-   S32 i,j;
-   DOUBLE *YD=NULL, A0=0.0, A1=0.0, A2=0.0, A3=0.0, x=0.0, dx=0.0, dy=0.0, p1=0.0, p2=0.0, p3=0.0;
+   DOUBLE *src_X  = plan->X;
+   DOUBLE *src_Y  = plan->Y;
+   S32     src_len = plan->n;
 
-   YD = (DOUBLE *) malloc(len1 * sizeof(DOUBLE));
-   if (YD == NULL) return;
+   plan->kind = -1;
 
-   getYD_gen(X1, Y1, YD, len1);
+   if (kind == SPLINE_HERMITE)
+      {
+      if (src_len < 3) return FALSE;
 
-   if (X2[0] < X1[0] || X2[len2-1] > X1[len1-1])
+      getYD_gen(src_X, src_Y, plan->D, src_len, plan->W);
+      plan->kind = kind;
+      return TRUE;
+      }
+
+   if (src_len < 2) return FALSE;
+
+   //
+   // Calculate second derivatives at input points, guarding against
+   // division by infinitesimals or zero that can happen with
+   // vertical or coincident segments
+   //
+
+   DOUBLE *D2 = plan->D;
+   DOUBLE *YD = plan->W;
+
+   D2[0] = YD[0] = 0.0;
+
+   for (S32 i=1; i < src_len-1; i++)
       {
-      assert(0);
+      DOUBLE epsilon = fabs(src_X[i]) * 1E-6;
+
+      DOUBLE h0 =  src_X[i]   - src_X[i-1];
+      DOUBLE h1 =  src_X[i+1] - src_X[i-1];
+      DOUBLE h2 =  src_X[i+1] - src_X[i];
+
+      if (fabs(h0) < epsilon) h0 = epsilon;
+      if (fabs(h1) < epsilon) h1 = epsilon;
+      if (fabs(h2) < epsilon) h2 = epsilon;
+
+      DOUBLE r0 = (src_Y[i]   - src_Y[i-1]) / h0;
+      DOUBLE r1 = (src_Y[i+1] - src_Y[i])   / h2;
+
+      DOUBLE h = h0 / h1;
+      DOUBLE p = 1.0 / (h * D2[i-1] + 2.0);
+
+      D2[i] = (h - 1.0) * p;
+      YD[i] = (((6.0 * (r1 - r0)) / h1) - (h * YD[i-1])) * p;
+      }
+
+   D2[src_len-1] = 0.0;
+
+   for (S32 i=src_len-2; i >= 0; i--)
+      {
+      D2[i] = (D2[i] * D2[i+1]) + YD[i];
       }
 
-   p3 = X2[0] - 1;
-   for (i=j=0; i < len2; i++)
+   plan->kind = kind;
+   return TRUE;
+}
+
+bool spline_plan_set (SPLINE_PLAN *plan, S32 kind, DOUBLE *src_X, DOUBLE *src_Y, S32 src_len)
+{
+   if (!spline_plan_reserve(plan, src_len))
       {
-      p2 = X2[i];
+      return FALSE;
+      }
+
+   memcpy(plan->X, src_X, src_len * sizeof(DOUBLE));
+   memcpy(plan->Y, src_Y, src_len * sizeof(DOUBLE));
+
+   return spline_plan_solve(plan, kind);
+}
+
+//
+// Evaluate a solved plan at dest_X[dest_len] (any order, destination points outside the source
+// range are extrapolated from the first/last interval)
+//
+
+void spline_plan_eval (SPLINE_PLAN *plan, DOUBLE *dest_X, DOUBLE *dest_Y, S32 dest_len)
+{
+   DOUBLE *src_X   = plan->X;
+   DOUBLE *src_Y   = plan->Y;
+   DOUBLE *D       = plan->D;
+   S32     src_len = plan->n;
+
+   assert(plan->kind != -1);
+
+   S32 u = 0;
+   S32 d = 0;
+
+   while (d < dest_len)
+      {
+      //
+      // Find input interval containing this X (cur, next), then the run of
+      // destination points in the same interval
+      //
 
-      if (p2 > p3)
+      u = lerp_upper(src_X, src_len, u, dest_X[d]);
+
+      S32 cur  = min(max(u-1, 0), src_len-2);
+      S32 next = cur+1;
+      S32 end  = d+1;
+
+      DOUBLE lo_x = (cur == 0)         ? -DBL_MAX : src_X[cur];
+      DOUBLE hi_x = (next == src_len-1) ?  DBL_MAX : src_X[next];
+
+      while ((end < dest_len) && (dest_X[end] >= lo_x) && (dest_X[end] < hi_x)) end++;
+
+      DOUBLE h = src_X[next] - src_X[cur];
+
+      if (plan->kind == SPLINE_NATURAL)
          {
-         for (; j < len1 && p2 > X1[j]; j++);
+         //
+         // Perform cubic spline interpolation
+         //
 
-         if (p2 < X1[j]) j--;
+         if (h <= 0.0) h = 0.0001;                 // HACK
+         assert(h > 0.0);                          // TODO: fired in Phase view 
 
-         p1 = X1[j];
-         p3 = X1[j+1];
+         for (; d < end; d++)
+            {
+            DOUBLE x = dest_X[d];
 
-         dx = 1.0 / (X1[j+1] - X1[j]);
-         dy = (Y1[j+1] - Y1[j]) * dx;
+            DOUBLE a = (src_X[next] - x) / h;
+            DOUBLE b = (x - src_X[cur])  / h;
 
-         A0 = Y1[j];
-         A1 = YD[j];
-         A2 = dx * (3.0 * dy - 2.0 * YD[j] - YD[j+1]);
-         A3 = dx * dx * (-2.0 * dy + YD[j] + YD[j+1]);
+            dest_Y[d] = (a*src_Y[cur]) + (b*src_Y[next]) + (((a*a*a-a)*D[cur]) + ((b*b*b-b)*D[next])) * (h*h) / 6.0;
+            }
          }
+      else
+         {
+         DOUBLE dx = 1.0 / h;
+         DOUBLE dy = (src_Y[next] - src_Y[cur]) * dx;
 
-      x = p2 - p1;
-      Y2[i] = ((A3 * x + A2) * x + A1) * x + A0;
+         DOUBLE A0 = src_Y[cur];
+         DOUBLE A1 = D[cur];
+         DOUBLE A2 = dx * (3.0 * dy - 2.0 * D[cur] - D[next]);
+         DOUBLE A3 = dx * dx * (-2.0 * dy + D[cur] + D[next]);
+
+         for (; d < end; d++)
+            {
+            DOUBLE x = dest_X[d] - src_X[cur];
+
+            dest_Y[d] = ((A3 * x + A2) * x + A1) * x + A0;
+            }
+         }
       }
+}
 
-   free(YD);
+//***************************************************************************
+//
+// Cubic spline interpolators from Wolberg, Digital Image Warping, p. 293
+//
+// Alternative version (spline_gen) derived from Numerical Recipes 3rd Edition, p. 121
+// has slightly better endpoint behavior
+//
+// (One-shot versions, use a SPLINE_PLAN to evaluate the same source several times)
+//
+// src_X/X1 must be in ascending order with dest_X/X2 inside the source range. FALSE is returned
+// and dest_Y/Y2 is not written if the source has too few points (spline_gen() 2, ispline_gen() 3,
+// see spline_plan_solve()) or if the plan can't be allocated: use lerp_gen() for shorter sources.
+//
+//***************************************************************************
+
+bool spline_gen (DOUBLE *src_X,  DOUBLE *src_Y,  S32 src_len, //)
+                 DOUBLE *dest_X, DOUBLE *dest_Y, S32 dest_len)
+{
+   if ((dest_X[0] < src_X[0]) || (dest_X[dest_len-1] > src_X[src_len-1]))
+      {
+      assert(0);
+      }
+
+   SPLINE_PLAN plan;
+
+   if (!spline_plan_set(&plan, SPLINE_NATURAL, src_X, src_Y, src_len))
+      {
+      return FALSE;
+      }
+
+   spline_plan_eval(&plan, dest_X, dest_Y, dest_len);
+   return TRUE;
+}
+
+bool ispline_gen(DOUBLE *X1, DOUBLE *Y1, S32 len1, //)
+                 DOUBLE *X2, DOUBLE *Y2, S32 len2)
+{
+   if (X2[0] < X1[0] || X2[len2-1] > X1[len1-1])
+      {
+      assert(0);
+      }
+
+   SPLINE_PLAN plan;
+
+   if (!spline_plan_set(&plan, SPLINE_HERMITE, X1, Y1, len1))
+      {
+      return FALSE;
+      }
+
+   spline_plan_eval(&plan, X2, Y2, len2);
+   return TRUE;
 }
 
 static void tridiag(DOUBLE *D, S32 len)
@@ -0,0 +1,1006 @@
+/*********************************************************************/
+//
+// Sweep archive: append-only time series of S-parameter sweeps
+// (long streaming captures, see acquisition::stream_SnP()), with
+// random access to any sweep and export to Touchstone via SPARAMS
+//
+// Requires sparams.cpp (included before this file)
+//
+/*********************************************************************/
+#include <QByteArray>
+
+#include <string>
+#include <vector>
+
+#define SWEEP_ARCHIVE_EXT ".snpa"
+#define SWEEP_ARCHIVE_CHUNK_FRAMES (16) // Default frames per chunk (unit of the compression and of the reads)
+#define SWEEP_ARCHIVE_PACK_LEVEL (1) // qCompress() level of the packed chunks (fastest, the byte shuffle does most of the work)
+#define SWEEP_ARCHIVE_PACK_SAMPLE (8192) // Bytes of a byte plane compressed first to skip the incompressible (noise) planes
+
+namespace SNPA
+{
+    // --------------------------------------------------------------------------------------------------
+    // File layout (little-endian), only appended while capturing:
+    //   ARC_HEADER, freq_Hz[n_points] (shared by all the frames)
+    //   Records (ARC_RECORD + bytes of payload):
+    //     ARC_RECORD_STATE: U32 state id + instrument state text (NUL terminated), before the first
+    //                       frame using it
+    //     ARC_RECORD_CHUNK: ARC_CHUNK + ARC_FRAME[n_frames] + frame data, chunk_frames frames in every
+    //                       chunk but the last one. Frame data = RI[b][a][n_points] of each frame, raw or
+    //                       packed (see SWEEP_ARCHIVE::pack_chunk())
+    //     ARC_RECORD_INDEX: ARC_INDEX + ARC_FRAME[n_frames] + U64 chunk offset[n_chunks] + U64 state offset[n_states]
+    //   ARC_TRAILER (offset of the index record)
+    // The index and the trailer are written by close(). Without trailer (capture interrupted) open() scans
+    // the records instead, an incomplete last record is ignored.
+    // --------------------------------------------------------------------------------------------------
+    const U32 ARC_ID = 'APNS';               // Archive identifier 'SNPA' (little-endian)
+    const U32 ARC_VERSION = 0x00000001;
+    const U32 ARC_RECORD_ID = 'DCRA';        // 'ARCD'
+    const U32 ARC_TRAILER_ID = 'DNEA';       // 'AEND'
+
+    const U32 ARC_RECORD_STATE = 1;
+    const U32 ARC_RECORD_CHUNK = 2;
+    const U32 ARC_RECORD_INDEX = 3;
+
+    const U32 ARC_PACKED = 0x01;             // ARC_HEADER: chunks packed when smaller, ARC_CHUNK: this chunk is packed
+
+#pragma pack(push,1)
+    struct ARC_HEADER
+    {
+        U32 ID;                 // ARC_ID
+        U32 version;            // ARC_VERSION
+        U32 header_bytes;       // sizeof(ARC_HEADER)
+        S32 n_ports;
+        S32 n_points;
+        S32 chunk_frames;       // Frames per chunk
+        U32 flags;              // ARC_PACKED
+        U32 reserved;
+        DOUBLE min_Hz;
+        DOUBLE max_Hz;
+        DOUBLE Zo_real;
+        DOUBLE Zo_imag;
+        S64 start_time;         // Capture start (time_t), ARC_FRAME::time_us is relative to it
+    };
+
+    struct ARC_RECORD
+    {
+        U32 ID;                 // ARC_RECORD_ID
+        U32 type;               // ARC_RECORD_xx
+        U64 bytes;              // Payload following this header
+    };
+
+    struct ARC_CHUNK
+    {
+        U32 n_frames;
+        U32 flags;              // ARC_PACKED
+        U64 data_bytes;         // Frame data once unpacked (n_frames * frame bytes)
+    };
+
+    struct ARC_FRAME
+    {
+        U64 sweep;              // Sweep number of the capture (gaps = frames dropped by the capture)
+        U64 time_us;            // Capture time since start_time
+        U32 state_id;           // ARC_RECORD_STATE of the instrument state
+        U32 reserved;
+    };
+
+    struct ARC_INDEX
+    {
+        U64 n_frames;
+        U32 n_chunks;
+        U32 n_states;
+    };
+
+    struct ARC_TRAILER
+    {
+        U64 index_offset;       // ARC_RECORD of the index
+        U32 ID;                 // ARC_TRAILER_ID
+        U32 reserved;
+    };
+#pragma pack(pop)
+}
+
+static_assert(sizeof(SPARAM::RI) == 2 * sizeof(U64), "Frame data is the SPARAM::RI bits (2 U64 per point)");
+
+struct SWEEP_ARCHIVE
+{
+    C8                       message_text[4096];     // Error text buffer for optional app access
+
+    SNPA::ARC_HEADER         H;
+    std::vector<DOUBLE>      freq_Hz;                // [n_points]
+    std::vector<SNPA::ARC_FRAME> frames;             // Every frame of the archive (written + pending when writing)
+    std::vector<U64>         chunk_offset;           // ARC_RECORD of each chunk
+    std::vector<U64>         state_offset;           // ARC_RECORD of each state
+    std::vector<std::string> states;                 // Instrument state text of each state id
+
+    FILE                    *file;
+    bool                     writing;                // create() else open()
+    U64                      end_offset;             // Writer: next record offset
+    bool                     write_failed;           // Writer: a record write failed (end of file unknown, no more records)
+    S64                      loaded_chunk;           // Reader: last chunk read (-1 = none)
+    U64                      loaded_data_offset;     // Reader: frame data of loaded_chunk if not packed (read per frame), else 0
+    std::vector<U64>         chunk_data;             // Writer: pending frames, reader: unpacked frames of loaded_chunk
+    std::vector<U8>          pack_buffer;            // pack_chunk() byte planes
+    std::vector<U8>          packed_data;            // Packed chunk (written or read)
+    SPARAMS                  export_frame_data;      // export_frame() database
+
+    // --------------------------------------------------------------------------------------------------
+    // Error/status message sink can be subclassed if desired
+    // to redirect output
+    // --------------------------------------------------------------------------------------------------
+
+    virtual void message_sink(SPARAM::MSGLVL level,
+            C8            *text)
+    {
+        Q_UNUSED(level);
+        ::printf("%s\n", text);
+    }
+
+    virtual void message_printf(SPARAM::MSGLVL level,
+            C8            *fmt,
+            ...)
+    {
+        va_list ap;
+
+        va_start(ap,
+                fmt);
+
+        _vsnprintf(message_text,
+                sizeof(message_text) - 1,
+                fmt,
+                ap);
+
+        va_end(ap);
+
+        message_sink(level,
+                message_text);
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Construction/destruction
+    // --------------------------------------------------------------------------------------------------
+    SWEEP_ARCHIVE()
+    {
+        memset(message_text, 0, sizeof(message_text));
+        memset(&H, 0, sizeof(H));
+        file = NULL;
+        writing = FALSE;
+        end_offset = 0;
+        write_failed = FALSE;
+        loaded_chunk = -1;
+        loaded_data_offset = 0;
+    }
+
+    virtual ~SWEEP_ARCHIVE()
+    {
+        close();
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Sizes
+    // --------------------------------------------------------------------------------------------------
+    U64 n_frames(void)
+    {
+        return frames.size();
+    }
+
+    size_t frame_values(void)
+    {
+        return (size_t)H.n_ports * H.n_ports * H.n_points * 2;     // U64 (DOUBLE bits) per frame
+    }
+
+    size_t frame_bytes(void)
+    {
+        return frame_values() * sizeof(U64);
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Create a new archive (replaces an existing file), then add_state() and append() the frames, close()
+    // --------------------------------------------------------------------------------------------------
+    /* Parameters
+        const C8 *filename // Output filename (SWEEP_ARCHIVE_EXT)
+        S32 ports, points // Frame dimensions (1 or 2 ports)
+        const DOUBLE *freq // Frequency of each point (points)
+        DOUBLE min, max // Touchstone header info (see SPARAMS::min_Hz/max_Hz)
+        COMPLEX_DOUBLE Z // Reference impedance
+        time_t start_time // Capture start
+        S32 frames_per_chunk = SWEEP_ARCHIVE_CHUNK_FRAMES
+        bool pack = TRUE // Chunks packed if smaller (see pack_chunk())
+    */
+    virtual bool create(const C8 *filename,
+                        S32 ports,
+                        S32 points,
+                        const DOUBLE *freq,
+                        DOUBLE min,
+                        DOUBLE max,
+                        COMPLEX_DOUBLE Z,
+                        time_t start_time,
+                        S32 frames_per_chunk = SWEEP_ARCHIVE_CHUNK_FRAMES,
+                        bool pack = TRUE)
+    {
+        close();
+
+        if ((ports < 1) || (ports > 2) || (points < 1) || (frames_per_chunk < 1) ||
+            ((U64)ports * ports * points * 2 * sizeof(U64) * frames_per_chunk >= 0x7FFFFFFF))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Invalid archive dimensions (%d ports, %d points, %d frames per chunk)",
+                    ports, points, frames_per_chunk);
+            return FALSE;
+        }
+
+        memset(&H, 0, sizeof(H));
+        H.ID = SNPA::ARC_ID;
+        H.version = SNPA::ARC_VERSION;
+        H.header_bytes = sizeof(SNPA::ARC_HEADER);
+        H.n_ports = ports;
+        H.n_points = points;
+        H.chunk_frames = frames_per_chunk;
+        H.flags = pack ? SNPA::ARC_PACKED : 0;
+        H.min_Hz = min;
+        H.max_Hz = max;
+        H.Zo_real = Z.real;
+        H.Zo_imag = Z.imag;
+        H.start_time = (S64)start_time;
+        freq_Hz.assign(freq, freq + points);
+
+        file = fopen(filename, "wb");
+
+        if (file == NULL)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't open %s", filename);
+            return FALSE;
+        }
+
+        writing = TRUE;
+        chunk_data.reserve(frame_values() * frames_per_chunk);
+
+        if ((fwrite(&H, sizeof(H), 1, file) != 1) ||
+            (fwrite(freq_Hz.data(), points * sizeof(DOUBLE), 1, file) != 1))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't write to %s", filename);
+            close();
+            return FALSE;
+        }
+
+        end_offset = sizeof(H) + points * sizeof(DOUBLE);
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Instrument state of the next frames (IF bandwidth, power, averaging, correction...), one text line
+    // per setting. Identical states are stored once.
+    //
+    // Returns the state id (-1 on write error)
+    // --------------------------------------------------------------------------------------------------
+    virtual S32 add_state(const C8 *text)
+    {
+        for (size_t i = 0; i < states.size(); i++)
+        {
+            if (states[i] == text)
+            {
+                return (S32)i;
+            }
+        }
+
+        U32 id = (U32)states.size();
+        U64 offset = end_offset;
+
+        if ((!writing) || (write_failed) || (!write_record(SNPA::ARC_RECORD_STATE, &id, sizeof(id), text, strlen(text) + 1, NULL, 0)))
+        {
+            return -1;
+        }
+
+        states.push_back(text);
+        state_offset.push_back(offset);
+        return (S32)id;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Append the RI data of a sweep (same dimensions as the archive), written with its chunk
+    // After a write error (record partly written, end_offset no longer the end of the file) the archive
+    // takes no more records: append() and add_state() fail and close() writes no index, open() then scans
+    // the records written before the error
+    // --------------------------------------------------------------------------------------------------
+    virtual bool append(const SPARAMS *src, U64 sweep, U64 time_us, S32 state_id)
+    {
+        if (write_failed)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Archive write failed, frame not appended");
+            return FALSE;
+        }
+
+        if ((!writing) || (src->n_ports != H.n_ports) || (src->n_points != H.n_points) ||
+            (state_id < 0) || ((size_t)state_id >= states.size()))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Frame doesn't match the archive");
+            return FALSE;
+        }
+
+        SNPA::ARC_FRAME F;
+        memset(&F, 0, sizeof(F));
+        F.sweep = sweep;
+        F.time_us = time_us;
+        F.state_id = (U32)state_id;
+        frames.push_back(F);
+
+        size_t trace_values = (size_t)H.n_points * 2;
+        size_t pos = chunk_data.size();
+        chunk_data.resize(pos + frame_values());
+
+        for (S32 b = 0; b < H.n_ports; b++)
+        {
+            for (S32 a = 0; a < H.n_ports; a++)
+            {
+                memcpy(&chunk_data[pos], src->RI[b][a], trace_values * sizeof(U64));
+                pos += trace_values;
+            }
+        }
+
+        if (chunk_data.size() == frame_values() * H.chunk_frames)
+        {
+            return write_chunk();
+        }
+
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Writer: last chunk, index and trailer. Reader: release the file
+    // --------------------------------------------------------------------------------------------------
+    virtual bool close(void)
+    {
+        bool result = TRUE;
+
+        if (file == NULL)
+        {
+            return TRUE;
+        }
+
+        if (writing)
+        {
+            result = (!write_failed) && write_chunk();
+
+            if (result)
+            {
+                SNPA::ARC_INDEX I;
+                SNPA::ARC_TRAILER T;
+                U64 index_offset = end_offset;
+
+                I.n_frames = frames.size();
+                I.n_chunks = (U32)chunk_offset.size();
+                I.n_states = (U32)state_offset.size();
+                result = write_record(SNPA::ARC_RECORD_INDEX, &I, sizeof(I),
+                        frames.data(), frames.size() * sizeof(SNPA::ARC_FRAME),
+                        chunk_offset.data(), chunk_offset.size() * sizeof(U64), state_offset.size() * sizeof(U64)) &&
+                    (fwrite(state_offset.data(), sizeof(U64), state_offset.size(), file) == state_offset.size());
+
+                T.index_offset = index_offset;
+                T.ID = SNPA::ARC_TRAILER_ID;
+                T.reserved = 0;
+                result = result && (fwrite(&T, sizeof(T), 1, file) == 1);
+            }
+
+            if (fclose(file) != 0)
+            {
+                result = FALSE;
+            }
+
+            if (!result)
+            {
+                message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't write the archive index");
+            }
+        }
+        else
+        {
+            fclose(file);
+        }
+
+        file = NULL;
+        writing = FALSE;
+        write_failed = FALSE;
+        frames.clear();
+        chunk_offset.clear();
+        state_offset.clear();
+        states.clear();
+        chunk_data.clear();
+        loaded_chunk = -1;
+        loaded_data_offset = 0;
+
+        return result;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Open an archive for reading
+    //
+    // Frame table, chunk and state offsets are loaded from the index, or rebuilt by scanning the records
+    // if the capture was interrupted before close()
+    // --------------------------------------------------------------------------------------------------
+    virtual bool open(const C8 *filename)
+    {
+        close();
+
+        file = fopen(filename, "rb");
+
+        if (file == NULL)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't open %s", filename);
+            return FALSE;
+        }
+
+        _fseeki64(file, 0, SEEK_END);
+        U64 file_size = (U64)_ftelli64(file);
+
+        if ((!read_at(0, &H, sizeof(H))) || (H.ID != SNPA::ARC_ID))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"%s is not a sweep archive", filename);
+            close();
+            return FALSE;
+        }
+
+        if ((H.version != SNPA::ARC_VERSION) || (H.header_bytes != sizeof(SNPA::ARC_HEADER)) ||
+            (H.n_ports < 1) || (H.n_ports > 2) || (H.n_points < 1) || (H.chunk_frames < 1) ||
+            (file_size < sizeof(H) + (U64)H.n_points * sizeof(DOUBLE)))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Sweep archive version 0x%.08X not supported or corrupt header", H.version);
+            close();
+            return FALSE;
+        }
+
+        freq_Hz.resize(H.n_points);
+        U64 records_offset = sizeof(H) + H.n_points * sizeof(DOUBLE);
+        bool result = read_at(sizeof(H), freq_Hz.data(), H.n_points * sizeof(DOUBLE));
+
+        if (result && (!read_index(file_size)))
+        {
+            result = scan_records(records_offset, file_size);
+        }
+
+        //
+        // Every chunk is full but the last one (frame i in chunk i / chunk_frames)
+        //
+        U64 max_frames = (U64)chunk_offset.size() * H.chunk_frames;
+
+        if (result && ((frames.size() > max_frames) || (frames.size() + H.chunk_frames <= max_frames)))
+        {
+            result = FALSE;
+        }
+
+        for (size_t i = 0; result && (i < frames.size()); i++)
+        {
+            result = (frames[i].state_id < states.size());
+        }
+
+        if (!result)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Corrupt sweep archive %s", filename);
+            close();
+        }
+
+        return result;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Frame lookups (-1 if none)
+    //
+    // Frame of a sweep number: arithmetic when the sweeps have no gaps, else binary search
+    // Frame of a capture time: last frame captured at or before time_us (binary search)
+    // --------------------------------------------------------------------------------------------------
+    S64 find_sweep(U64 sweep)
+    {
+        if (frames.empty() || (sweep < frames.front().sweep) || (sweep > frames.back().sweep))
+        {
+            return -1;
+        }
+
+        if (frames.back().sweep - frames.front().sweep == frames.size() - 1)
+        {
+            return (S64)(sweep - frames.front().sweep);
+        }
+
+        auto it = std::lower_bound(frames.begin(), frames.end(), sweep,
+                [](const SNPA::ARC_FRAME &F, U64 s) { return F.sweep < s; });
+
+        return ((it != frames.end()) && (it->sweep == sweep)) ? (S64)(it - frames.begin()) : -1;
+    }
+
+    S64 find_time(U64 time_us)
+    {
+        auto it = std::upper_bound(frames.begin(), frames.end(), time_us,
+                [](U64 t, const SNPA::ARC_FRAME &F) { return t < F.time_us; });
+
+        return (it == frames.begin()) ? -1 : (S64)(it - frames.begin()) - 1;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Load frame i into dest (RI): only this frame is read from a raw chunk, a packed chunk is read and
+    // unpacked (kept for the next frames)
+    // --------------------------------------------------------------------------------------------------
+    virtual bool read_frame(U64 i, SPARAMS *dest)
+    {
+        if ((writing) || (file == NULL) || (i >= frames.size()))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Frame %llu not in the archive", (unsigned long long)i);
+            return FALSE;
+        }
+
+        S64 chunk = (S64)(i / H.chunk_frames);
+
+        if ((chunk != loaded_chunk) && (!read_chunk(chunk)))
+        {
+            return FALSE;
+        }
+
+        if ((dest->n_ports != H.n_ports) || (dest->n_points != H.n_points) || (dest->RI == NULL))
+        {
+            if (!dest->alloc(H.n_ports, H.n_points, SNPTYPE::RI))
+            {
+                message_printf(SPARAM::MSG_ERROR, (C8*)"%s", dest->message_text);
+                return FALSE;
+            }
+        }
+
+        memcpy(dest->freq_Hz, freq_Hz.data(), H.n_points * sizeof(DOUBLE));
+        dest->freq_grid = -1;
+        dest->min_Hz = H.min_Hz;
+        dest->max_Hz = H.max_Hz;
+        dest->Zo = COMPLEX_DOUBLE(H.Zo_real, H.Zo_imag);
+
+        size_t trace_values = (size_t)H.n_points * 2;
+        const U64 *src = (loaded_data_offset == 0) ? &chunk_data[(i % H.chunk_frames) * frame_values()] : NULL;
+        bool result = (src != NULL) || read_at(loaded_data_offset + (i % H.chunk_frames) * frame_bytes(), NULL, 0);
+
+        for (S32 b = 0; b < H.n_ports; b++)
+        {
+            for (S32 a = 0; a < H.n_ports; a++)
+            {
+                if (src != NULL)
+                {
+                    memcpy((void *)dest->RI[b][a], src, trace_values * sizeof(U64));
+                    src += trace_values;
+                }
+                else
+                {
+                    result = result && (fread(dest->RI[b][a], trace_values * sizeof(U64), 1, file) == 1);
+                }
+                memset(dest->valid[b][a], SNPTYPE::RI, H.n_points);
+            }
+        }
+
+        if (!result)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't read frame %llu", (unsigned long long)i);
+            return FALSE;
+        }
+
+        dest->spline_invalidate();
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Touchstone header of frame i: sweep, time and instrument state lines
+    // --------------------------------------------------------------------------------------------------
+    virtual void frame_header(U64 i, C8 *dest, S32 size)
+    {
+        const SNPA::ARC_FRAME *F = &frames[i];
+        time_t start_time = (time_t)H.start_time;
+        C8 start_time_text[64] = { 0 };
+
+        strftime(start_time_text, sizeof(start_time_text) - 1, "%a %b %d %H:%M:%S %Y", localtime(&start_time));
+        S32 len = _snprintf(dest, size - 1, "! Sweep %llu at %.3f s (capture started %s)\n!\n",
+                (unsigned long long)F->sweep, F->time_us / 1000000.0, start_time_text);
+
+        const C8 *line = states[F->state_id].c_str();
+
+        while ((*line != 0) && (len >= 0) && (len < size - 1))
+        {
+            const C8 *end = strchr(line, '\n');
+            S32 line_len = (end != NULL) ? (S32)(end - line) : (S32)strlen(line);
+
+            len += _snprintf(&dest[len], size - 1 - len, "! %.*s\n", line_len, line);
+            line += line_len + ((end != NULL) ? 1 : 0);
+        }
+
+        dest[size - 1] = 0;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Save frame i to a Touchstone 1.1 file (see SPARAMS::write_SNP_file())
+    // --------------------------------------------------------------------------------------------------
+    virtual bool export_frame(U64 i,
+                              const C8 *filename,
+                              const C8 *data_format = SPARAM::DEF_DATA_FORMAT,
+                              const C8 *freq_format = SPARAM::DEF_FREQ_FORMAT)
+    {
+        C8 header[2048];
+
+        if (!read_frame(i, &export_frame_data))
+        {
+            return FALSE;
+        }
+
+        frame_header(i, header, sizeof(header));
+
+        if (!export_frame_data.write_SNP_file(filename, data_format, freq_format, header))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"%s", export_frame_data.message_text);
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Chunk packing: each value XOR the same value of the previous frame (successive sweeps share the
+    // sign, exponent and high mantissa bits), bytes shuffled by significance in 8 planes of n values so
+    // the zero bytes are contiguous. Each plane is then qCompress()ed, unless a sample of it doesn't
+    // compress (low mantissa bytes are measurement noise) or the result isn't smaller: stored raw.
+    //
+    // Packed data: U32 plane_bytes[8], then the planes (raw if plane_bytes = n)
+    //
+    // Returns the packed size in packed_data (0 if not smaller than the frames)
+    // --------------------------------------------------------------------------------------------------
+    U64 pack_chunk(size_t n_frames_chunk)
+    {
+        size_t n_values = frame_values();
+        size_t n = n_values * n_frames_chunk;
+        const U64 *data = chunk_data.data();
+        U32 plane_bytes[8];
+
+        pack_buffer.resize(n * 8);
+
+        for (size_t k = 0; k < n; k++)
+        {
+            U64 v = (k < n_values) ? data[k] : (data[k] ^ data[k - n_values]);
+
+            for (S32 byte = 0; byte < 8; byte++)
+            {
+                pack_buffer[byte * n + k] = (U8)(v >> (byte * 8));
+            }
+        }
+
+        packed_data.resize(sizeof(plane_bytes));
+
+        for (S32 byte = 0; byte < 8; byte++)
+        {
+            const U8 *plane = &pack_buffer[byte * n];
+            S32 sample = (S32)min(n, (size_t)SWEEP_ARCHIVE_PACK_SAMPLE);
+            QByteArray packed;
+
+            if (qCompress(plane, sample, SWEEP_ARCHIVE_PACK_LEVEL).size() < sample - sample / 16)
+            {
+                packed = qCompress(plane, (int)n, SWEEP_ARCHIVE_PACK_LEVEL);
+            }
+
+            if ((packed.size() > 0) && ((size_t)packed.size() < n))
+            {
+                plane_bytes[byte] = (U32)packed.size();
+                packed_data.insert(packed_data.end(), (const U8 *)packed.constData(), (const U8 *)packed.constData() + packed.size());
+            }
+            else
+            {
+                plane_bytes[byte] = (U32)n;
+                packed_data.insert(packed_data.end(), plane, plane + n);
+            }
+        }
+
+        memcpy(packed_data.data(), plane_bytes, sizeof(plane_bytes));
+        return (packed_data.size() < n * sizeof(U64)) ? packed_data.size() : 0;
+    }
+
+    bool unpack_chunk(const U8 *packed, U64 packed_bytes, size_t n_frames_chunk)
+    {
+        size_t n_values = frame_values();
+        size_t n = n_values * n_frames_chunk;
+        U32 plane_bytes[8];
+        const U8 *plane[8];
+        QByteArray unpacked[8];
+
+        if (packed_bytes < sizeof(plane_bytes))
+        {
+            return FALSE;
+        }
+
+        memcpy(plane_bytes, packed, sizeof(plane_bytes));
+        U64 pos = sizeof(plane_bytes);
+
+        for (S32 byte = 0; byte < 8; byte++)
+        {
+            if ((plane_bytes[byte] > n) || (pos + plane_bytes[byte] > packed_bytes))
+            {
+                return FALSE;
+            }
+
+            plane[byte] = &packed[pos];
+
+            if (plane_bytes[byte] < n)
+            {
+                unpacked[byte] = qUncompress(&packed[pos], (int)plane_bytes[byte]);
+
+                if ((size_t)unpacked[byte].size() != n)
+                {
+                    return FALSE;
+                }
+
+                plane[byte] = (const U8 *)unpacked[byte].constData();
+            }
+
+            pos += plane_bytes[byte];
+        }
+
+        U64 *data = chunk_data.data();
+
+        for (size_t k = 0; k < n; k++)
+        {
+            U64 v = 0;
+
+            for (S32 byte = 0; byte < 8; byte++)
+            {
+                v |= (U64)plane[byte][k] << (byte * 8);
+            }
+
+            data[k] = (k < n_values) ? v : (v ^ data[k - n_values]);
+        }
+
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Writer: record of up to 3 parts appended at end_offset (+ extra_bytes written by the caller)
+    // --------------------------------------------------------------------------------------------------
+    bool write_record(U32 type, const void *p1, U64 n1, const void *p2, U64 n2, const void *p3, U64 n3,
+                      U64 extra_bytes = 0)
+    {
+        SNPA::ARC_RECORD R;
+
+        R.ID = SNPA::ARC_RECORD_ID;
+        R.type = type;
+        R.bytes = n1 + n2 + n3 + extra_bytes;
+
+        bool result = (fwrite(&R, sizeof(R), 1, file) == 1) &&
+            ((n1 == 0) || (fwrite(p1, (size_t)n1, 1, file) == 1)) &&
+            ((n2 == 0) || (fwrite(p2, (size_t)n2, 1, file) == 1)) &&
+            ((n3 == 0) || (fwrite(p3, (size_t)n3, 1, file) == 1));
+
+        if (!result)
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't write to the archive");
+            write_failed = TRUE;
+            return FALSE;
+        }
+
+        end_offset += sizeof(R) + R.bytes;
+        return TRUE;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Writer: pending frames to a chunk record (flushed, a capture interrupted later keeps it)
+    // --------------------------------------------------------------------------------------------------
+    bool write_chunk(void)
+    {
+        size_t n_values = chunk_data.size();
+
+        if (n_values == 0)
+        {
+            return TRUE;
+        }
+
+        SNPA::ARC_CHUNK C;
+        C.n_frames = (U32)(n_values / frame_values());
+        C.flags = 0;
+        C.data_bytes = n_values * sizeof(U64);
+
+        const void *data = chunk_data.data();
+        U64 data_bytes = C.data_bytes;
+
+        if ((H.flags & SNPA::ARC_PACKED) && ((data_bytes = pack_chunk(C.n_frames)) > 0))
+        {
+            C.flags = SNPA::ARC_PACKED;
+            data = packed_data.data();
+        }
+        else
+        {
+            data_bytes = C.data_bytes;
+        }
+
+        size_t first_frame = frames.size() - C.n_frames;
+        U64 offset = end_offset;
+        bool result = write_record(SNPA::ARC_RECORD_CHUNK, &C, sizeof(C),
+                &frames[first_frame], C.n_frames * sizeof(SNPA::ARC_FRAME), data, data_bytes) &&
+            (fflush(file) == 0);
+
+        chunk_data.clear();
+
+        if (result)
+        {
+            chunk_offset.push_back(offset);
+        }
+        else
+        {
+            frames.resize(first_frame);
+            write_failed = TRUE;
+        }
+
+        return result;
+    }
+
+    // --------------------------------------------------------------------------------------------------
+    // Reader helpers
+    // --------------------------------------------------------------------------------------------------
+    bool read_at(U64 offset, void *dest, U64 bytes)
+    {
+        return (_fseeki64(file, (S64)offset, SEEK_SET) == 0) &&
+            ((bytes == 0) || (fread(dest, (size_t)bytes, 1, file) == 1));
+    }
+
+    bool read_record(U64 offset, U64 file_size, SNPA::ARC_RECORD *R)
+    {
+        return (offset + sizeof(*R) <= file_size) &&
+            read_at(offset, R, sizeof(*R)) &&
+            (R->ID == SNPA::ARC_RECORD_ID) &&
+            (R->bytes <= file_size - offset - sizeof(*R));
+    }
+
+    bool read_state(U64 offset, U64 file_size)
+    {
+        SNPA::ARC_RECORD R;
+        U32 id = 0;
+
+        if ((!read_record(offset, file_size, &R)) || (R.type != SNPA::ARC_RECORD_STATE) || (R.bytes <= sizeof(id)))
+        {
+            return FALSE;
+        }
+
+        std::vector<C8> text((size_t)(R.bytes - sizeof(id)) + 1, 0);
+
+        if ((!read_at(offset + sizeof(R), &id, sizeof(id))) || (id != states.size()) ||
+            (fread(text.data(), text.size() - 1, 1, file) != 1))
+        {
+            return FALSE;
+        }
+
+        states.push_back(text.data());
+        state_offset.push_back(offset);
+        return TRUE;
+    }
+
+    // Index of a closed archive (FALSE if missing)
+    bool read_index(U64 file_size)
+    {
+        SNPA::ARC_TRAILER T;
+        SNPA::ARC_RECORD R;
+        SNPA::ARC_INDEX I;
+
+        if ((file_size < sizeof(T)) || (!read_at(file_size - sizeof(T), &T, sizeof(T))) ||
+            (T.ID != SNPA::ARC_TRAILER_ID) || (!read_record(T.index_offset, file_size, &R)) ||
+            (R.type != SNPA::ARC_RECORD_INDEX) || (R.bytes < sizeof(I)) ||
+            (!read_at(T.index_offset + sizeof(R), &I, sizeof(I))) ||
+            (R.bytes != sizeof(I) + I.n_frames * sizeof(SNPA::ARC_FRAME) + ((U64)I.n_chunks + I.n_states) * sizeof(U64)))
+        {
+            return FALSE;
+        }
+
+        std::vector<U64> state_offsets(I.n_states);
+        frames.resize((size_t)I.n_frames);
+        chunk_offset.resize(I.n_chunks);
+
+        bool result = ((I.n_frames == 0) || (fread(frames.data(), (size_t)I.n_frames * sizeof(SNPA::ARC_FRAME), 1, file) == 1)) &&
+            ((I.n_chunks == 0) || (fread(chunk_offset.data(), I.n_chunks * sizeof(U64), 1, file) == 1)) &&
+            ((I.n_states == 0) || (fread(state_offsets.data(), I.n_states * sizeof(U64), 1, file) == 1));
+
+        for (U32 s = 0; result && (s < I.n_states); s++)
+        {
+            result = read_state(state_offsets[s], file_size);
+        }
+
+        if (!result)
+        {
+            frames.clear();
+            chunk_offset.clear();
+            state_offset.clear();
+            states.clear();
+        }
+
+        return result;
+    }
+
+    // Rebuild the tables from the records (archive not closed)
+    bool scan_records(U64 offset, U64 file_size)
+    {
+        SNPA::ARC_RECORD R;
+
+        while (read_record(offset, file_size, &R))
+        {
+            if (R.type == SNPA::ARC_RECORD_STATE)
+            {
+                if (!read_state(offset, file_size))
+                {
+                    return FALSE;
+                }
+            }
+            else if (R.type == SNPA::ARC_RECORD_CHUNK)
+            {
+                SNPA::ARC_CHUNK C;
+
+                if ((R.bytes < sizeof(C)) || (!read_at(offset + sizeof(R), &C, sizeof(C))) ||
+                    (R.bytes < sizeof(C) + (U64)C.n_frames * sizeof(SNPA::ARC_FRAME)))
+                {
+                    return FALSE;
+                }
+
+                size_t first_frame = frames.size();
+                frames.resize(first_frame + C.n_frames);
+
+                if ((C.n_frames > 0) && (fread(&frames[first_frame], C.n_frames * sizeof(SNPA::ARC_FRAME), 1, file) != 1))
+                {
+                    return FALSE;
+                }
+
+                chunk_offset.push_back(offset);
+            }
+            else if (R.type == SNPA::ARC_RECORD_INDEX)
+            {
+                break;
+            }
+
+            offset += sizeof(R) + R.bytes;
+        }
+
+        return TRUE;
+    }
+
+    // Chunk of the next read_frame(): packed frames unpacked to chunk_data, else offset of the raw frames.
+    // Rejected unless its n_frames is the number of frames of this chunk in the index (full chunks but the last one)
+    bool read_chunk(S64 chunk)
+    {
+        SNPA::ARC_RECORD R;
+        SNPA::ARC_CHUNK C;
+        U64 offset = chunk_offset[(size_t)chunk];
+        U64 index_frames = min((U64)H.chunk_frames, (U64)frames.size() - (U64)chunk * H.chunk_frames);
+
+        loaded_chunk = -1;
+
+        if ((!read_at(offset, &R, sizeof(R))) || (!read_at(offset + sizeof(R), &C, sizeof(C))) ||
+            (R.type != SNPA::ARC_RECORD_CHUNK) || (C.n_frames != index_frames) ||
+            (C.data_bytes != C.n_frames * frame_bytes()) ||
+            (R.bytes < sizeof(C) + C.n_frames * sizeof(SNPA::ARC_FRAME)))
+        {
+            message_printf(SPARAM::MSG_ERROR, (C8*)"Corrupt archive chunk %lld", (long long)chunk);
+            return FALSE;
+        }
+
+        U64 stored_bytes = R.bytes - sizeof(C) - C.n_frames * sizeof(SNPA::ARC_FRAME);
+        U64 data_offset = offset + sizeof(R) + sizeof(C) + C.n_frames * sizeof(SNPA::ARC_FRAME);
+
+        loaded_data_offset = 0;
+
+        if (!(C.flags & SNPA::ARC_PACKED))
+        {
+            if (stored_bytes != C.data_bytes)
+            {
+                message_printf(SPARAM::MSG_ERROR, (C8*)"Corrupt archive chunk %lld", (long long)chunk);
+                return FALSE;
+            }
+            loaded_data_offset = data_offset;
+        }
+        else
+        {
+            chunk_data.resize((size_t)(C.data_bytes / sizeof(U64)));
+            packed_data.resize((size_t)stored_bytes);
+
+            if (!read_at(data_offset, packed_data.data(), stored_bytes))
+            {
+                message_printf(SPARAM::MSG_ERROR, (C8*)"Couldn't read archive chunk %lld", (long long)chunk);
+                return FALSE;
+            }
+
+            if (!unpack_chunk(packed_data.data(), stored_bytes, C.n_frames))
+            {
+                message_printf(SPARAM::MSG_ERROR, (C8*)"Corrupt packed archive chunk %lld", (long long)chunk);
+                return FALSE;
+            }
+        }
+
+        loaded_chunk = chunk;
+        return TRUE;
+    }
+};
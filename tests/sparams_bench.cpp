@@ -0,0 +1,463 @@
+/*
+sparams_bench: throughput of the SPARAMS Touchstone file access and interpolation (see sparams_bench.pro)
+- write_SNP_file(): S2P in MA with 6 decimals ("%lf") and 15 significant digits vs the previous writer
+  (one fprintf("%lf %lf ") per value pair)
+- read_SNP_file(): same S2P files vs the previous reader (fgets() of 2048 bytes lines in 2 passes, count then
+  sscanf() of each row)
+- lerp_gen(): ns per destination point over a matrix of source/destination sizes vs the previous lerp_gen()
+  (linear search of the interval from the first source point for each destination point)
+- nearest_freq_Hz(): ns per query of the single and batch lookups vs the previous bsearch() per query, uniform
+  (LINFREQ) and log sweeps, ascending and random queries
+The files are written to the current directory (sparams_bench_*.S2P, deleted at the end).
+Usage: sparams_bench [points] (Default 100000)
+*/
+#include <QObject>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+
+#include "spline.cpp"
+#include "sparams.cpp"
+
+#define BENCH_MIN_SECONDS (1.0) // Each file access is repeated at least this long
+
+static DOUBLE now_s(void)
+{
+    return std::chrono::duration<DOUBLE>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+Repeat run() (at least 3 times), return the average time of one run in s
+*/
+template <typename F>
+static DOUBLE bench_s(F run)
+{
+    S64 n_runs = 0;
+    DOUBLE start = now_s();
+    DOUBLE elapsed;
+
+    do
+    {
+        run();
+        n_runs++;
+        elapsed = now_s() - start;
+    } while ((elapsed < BENCH_MIN_SECONDS) || (n_runs < 3));
+
+    return elapsed / (DOUBLE)n_runs;
+}
+
+/*
+Only the warnings and errors are printed (not the read_SNP_file() file summary)
+*/
+struct BENCH_SPARAMS : SPARAMS
+{
+    virtual void message_sink(SPARAM::MSGLVL level, C8 *text)
+    {
+        if (level >= SPARAM::MSG_WARNING)
+        {
+            ::printf("%s\n", text);
+        }
+    }
+};
+
+static S64 file_size(const C8 *filename)
+{
+    FILE *in = fopen(filename, "rb");
+    if (in == NULL)
+    {
+        return 0;
+    }
+
+    fseek(in, 0, SEEK_END);
+    S64 size = (S64)ftell(in);
+    fclose(in);
+    return size;
+}
+
+/*
+S2P sweep from 30 kHz to 6 GHz (8753 range), RI data of a lossy line
+*/
+static bool make_S2P(SPARAMS *S, S32 n_points)
+{
+    if (!S->alloc(2, n_points))
+    {
+        return false;
+    }
+
+    for (S32 i = 0; i < n_points; i++)
+    {
+        DOUBLE Hz = 30E3 + (6E9 - 30E3) * i / (n_points - 1);
+        DOUBLE phi = -2.0 * PI * Hz * 1E-9;
+        DOUBLE loss = exp(-Hz * 1E-10);
+
+        S->freq_Hz[i] = Hz;
+        S->set_RI(i, 0, 0, COMPLEX_DOUBLE(0.1 * loss * cos(2.0 * phi), 0.1 * loss * sin(2.0 * phi)));
+        S->set_RI(i, 1, 0, COMPLEX_DOUBLE(loss * cos(phi), loss * sin(phi)));
+        S->set_RI(i, 0, 1, COMPLEX_DOUBLE(loss * cos(phi), loss * sin(phi)));
+        S->set_RI(i, 1, 1, COMPLEX_DOUBLE(0.12 * loss * cos(2.0 * phi + 0.3), 0.12 * loss * sin(2.0 * phi + 0.3)));
+    }
+    S->min_Hz = S->freq_Hz[0];
+    S->max_Hz = S->freq_Hz[n_points - 1];
+
+    return true;
+}
+
+/*
+Previous write_SNP_file() rows: one fprintf() per value pair (MA, GHZ)
+*/
+static bool write_S2P_fprintf(SPARAMS *S, const C8 *filename)
+{
+    FILE *out = fopen(filename, "wt");
+    if (out == NULL)
+    {
+        return false;
+    }
+
+    fprintf(out, "# GHZ S MA R 50\n");
+
+    std::vector<DOUBLE> trace((size_t)4 * S->n_points * 2);
+    for (S32 a = 0; a < 2; a++)
+    {
+        for (S32 b = 0; b < 2; b++)
+        {
+            S->get_MA_trace(b, a, (SPARAM::MA *)&trace[(size_t)(a * 2 + b) * S->n_points * 2], SPARAM::CONV_EXACT);
+        }
+    }
+
+    for (S32 i = 0; i < S->n_points; i++)
+    {
+        fprintf(out, "%lf ", S->freq_Hz[i] / 1E9);
+
+        for (S32 col = 0; col < 4; col++)
+        {
+            DOUBLE *val = &trace[((size_t)col * S->n_points + i) * 2];
+
+            fprintf(out, "%lf %lf ", val[0], val[1]);
+        }
+        fprintf(out, "\n");
+    }
+
+    return (fclose(out) == 0);
+}
+
+static void bench_write_SNP(SPARAMS *S)
+{
+    const C8 *ref_name = "sparams_bench_fprintf.S2P";
+    DOUBLE ref_s = bench_s([&]()
+    {
+        write_S2P_fprintf(S, ref_name);
+    });
+    DOUBLE ref_MBps = file_size(ref_name) / ref_s / 1E6;
+    printf("write %d points S2P: fprintf per value %.1f MB/s (%.1f ms)\n", S->n_points, ref_MBps, ref_s * 1E3);
+    remove(ref_name);
+
+    static const S32 digits[] = { 0, 15 };
+
+    for (S32 d = 0; d < (S32)(sizeof(digits) / sizeof(digits[0])); d++)
+    {
+        C8 name[64];
+        snprintf(name, sizeof(name), "sparams_bench_%d.S2P", digits[d]);
+
+        S->text_digits = digits[d];
+        DOUBLE write_s = bench_s([&]()
+        {
+            S->write_SNP_file(name, "MA", "GHZ");
+        });
+        DOUBLE MBps = file_size(name) / write_s / 1E6;
+        printf("write %d points S2P: write_SNP_file digits %d %.1f MB/s (%.1f ms, x%.1f)\n",
+               S->n_points, digits[d], MBps, write_s * 1E3, ref_s / write_s);
+        remove(name);
+    }
+    S->text_digits = 0;
+}
+
+/*
+Previous read_SNP_file(): count the rows, then fgets() and sscanf() each row again (S2P, no option parsing)
+Return the number of points read
+*/
+static S32 read_S2P_sscanf(const C8 *filename, std::vector<DOUBLE> *values)
+{
+    S32 n_points = 0;
+
+    for (S32 pass = 1; pass <= 2; pass++)
+    {
+        FILE *in = fopen(filename, "rt");
+        if (in == NULL)
+        {
+            return 0;
+        }
+
+        if (pass == 2)
+        {
+            values->resize((size_t)n_points * 9);
+        }
+
+        S32 pt = 0;
+        C8 linbuf[2048];
+
+        while (fgets(linbuf, sizeof(linbuf) - 1, in) != NULL)
+        {
+            C8 *txt = linbuf;
+            while (isspace((U8)*txt)) txt++;
+
+            if ((*txt == 0) || (*txt == '!') || (*txt == '#'))
+            {
+                continue;
+            }
+
+            if (pass == 1)
+            {
+                n_points++;
+                continue;
+            }
+
+            DOUBLE *v = &(*values)[(size_t)pt * 9];
+            sscanf(txt, "%lf %lf %lf %lf %lf %lf %lf %lf %lf", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8]);
+            pt++;
+        }
+        fclose(in);
+    }
+
+    return n_points;
+}
+
+static void bench_read_SNP(SPARAMS *S)
+{
+    static const S32 digits[] = { 0, 15 };
+
+    for (S32 d = 0; d < (S32)(sizeof(digits) / sizeof(digits[0])); d++)
+    {
+        C8 name[64];
+        snprintf(name, sizeof(name), "sparams_bench_%d.S2P", digits[d]);
+
+        S->text_digits = digits[d];
+        if (!S->write_SNP_file(name, "MA", "GHZ"))
+        {
+            continue;
+        }
+        S->text_digits = 0;
+        S64 size = file_size(name);
+
+        std::vector<DOUBLE> values;
+        S32 ref_points = 0;
+        DOUBLE ref_s = bench_s([&]()
+        {
+            ref_points = read_S2P_sscanf(name, &values);
+        });
+
+        BENCH_SPARAMS R;
+        S32 n_points = 0;
+        DOUBLE read_s = bench_s([&]()
+        {
+            R.read_SNP_file(name, 2);
+            n_points = R.n_points;
+        });
+
+        printf("read %d points S2P digits %d: fgets/sscanf %.1f MB/s (%.1f ms), read_SNP_file %.1f MB/s (%.1f ms, x%.1f)\n",
+               n_points, digits[d], size / ref_s / 1E6, ref_s * 1E3, size / read_s / 1E6, read_s * 1E3, ref_s / read_s);
+        if (n_points != ref_points)
+        {
+            printf("Error read_SNP_file %d points, fgets/sscanf %d points\n", n_points, ref_points);
+        }
+        remove(name);
+    }
+}
+
+/*
+Previous lerp_gen(): src_X scanned from 0 for each destination point (dest_X in src_X range)
+*/
+static void lerp_linear_scan(DOUBLE *src_X, DOUBLE *src_Y, S32 src_len, DOUBLE *dest_X, DOUBLE *dest_Y, S32 dest_len)
+{
+    for (S32 d = 0; d < dest_len; d++)
+    {
+        DOUBLE x = dest_X[d];
+        S32 s;
+
+        for (s = 0; s < src_len - 1; s++)
+        {
+            if ((src_X[s] <= x) && (src_X[s + 1] >= x))
+            {
+                break;
+            }
+        }
+
+        DOUBLE alpha = (x - src_X[s]) / (src_X[s + 1] - src_X[s]);
+
+        dest_Y[d] = src_Y[s] + ((src_Y[s + 1] - src_Y[s]) * alpha);
+    }
+}
+
+static void bench_lerp_gen(void)
+{
+    static const S32 sizes[] = { 201, 1601, 10000, 100000 };
+    const S32 n_sizes = (S32)(sizeof(sizes) / sizeof(sizes[0]));
+    const DOUBLE ref_max_steps = 2E9; // The linear scan of larger matrix cells is not measured (O(src_len * dest_len))
+
+    for (S32 s = 0; s < n_sizes; s++)
+    {
+        std::vector<DOUBLE> src_X(sizes[s]);
+        std::vector<DOUBLE> src_Y(sizes[s]);
+
+        for (S32 i = 0; i < sizes[s]; i++)
+        {
+            src_X[i] = 30E3 + (6E9 - 30E3) * i / (sizes[s] - 1);
+            src_Y[i] = sin(src_X[i] * 1E-9);
+        }
+
+        for (S32 d = 0; d < n_sizes; d++)
+        {
+            std::vector<DOUBLE> dest_X(sizes[d]);
+            std::vector<DOUBLE> dest_Y(sizes[d]);
+
+            // Resampling on a grid inside the source range (required by the previous lerp_gen())
+            for (S32 i = 0; i < sizes[d]; i++)
+            {
+                dest_X[i] = 1E6 + (5.9E9 - 1E6) * i / (sizes[d] - 1);
+            }
+
+            DOUBLE lerp_s = bench_s([&]()
+            {
+                lerp_gen(src_X.data(), src_Y.data(), sizes[s], dest_X.data(), dest_Y.data(), sizes[d]);
+            });
+            DOUBLE lerp_ns = lerp_s * 1E9 / sizes[d];
+
+            if ((DOUBLE)sizes[s] * sizes[d] > ref_max_steps)
+            {
+                printf("lerp_gen %6d -> %6d points: linear scan not measured, lerp_gen %.2f ns/point\n", sizes[s], sizes[d], lerp_ns);
+                continue;
+            }
+
+            DOUBLE ref_s = bench_s([&]()
+            {
+                lerp_linear_scan(src_X.data(), src_Y.data(), sizes[s], dest_X.data(), dest_Y.data(), sizes[d]);
+            });
+            DOUBLE ref_ns = ref_s * 1E9 / sizes[d];
+
+            printf("lerp_gen %6d -> %6d points: linear scan %.2f ns/point, lerp_gen %.2f ns/point (x%.1f)\n",
+                   sizes[s], sizes[d], ref_ns, lerp_ns, ref_s / lerp_s);
+        }
+    }
+}
+
+/*
+Previous nearest_freq_Hz(): bsearch() of the interval (Hz strictly inside freq_Hz[0]..freq_Hz[n_points - 1])
+*/
+static int search_double_array(const void *keyval, const void *datum)
+{
+    DOUBLE key = *(DOUBLE *)keyval;
+
+    if (key < ((DOUBLE *)datum)[0]) return -1;
+    if (key >= ((DOUBLE *)datum)[1]) return  1;
+
+    return 0;
+}
+
+static S32 nearest_freq_bsearch(SPARAMS *S, DOUBLE Hz, DOUBLE *alpha)
+{
+    if ((Hz <= S->freq_Hz[0]) || (Hz >= S->freq_Hz[S->n_points - 1]))
+    {
+        *alpha = 0.0;
+        return (Hz <= S->freq_Hz[0]) ? 0 : S->n_points - 1;
+    }
+
+    DOUBLE *ptr = (DOUBLE *)bsearch(&Hz, S->freq_Hz, S->n_points - 1, sizeof(DOUBLE), search_double_array);
+    S32 result = (S32)(ptr - S->freq_Hz);
+
+    *alpha = (Hz - S->freq_Hz[result]) / (S->freq_Hz[result + 1] - S->freq_Hz[result]);
+    return result;
+}
+
+static void bench_nearest_freq_Hz(void)
+{
+    static const S32 sizes[] = { 1601, 100000 };
+    const S32 n_queries = 10000;
+
+    for (S32 s = 0; s < (S32)(sizeof(sizes) / sizeof(sizes[0])); s++)
+    {
+        for (S32 log_sweep = 0; log_sweep <= 1; log_sweep++)
+        {
+            BENCH_SPARAMS S;
+            if (!S.alloc(1, sizes[s]))
+            {
+                return;
+            }
+
+            for (S32 i = 0; i < sizes[s]; i++)
+            {
+                DOUBLE f = (DOUBLE)i / (sizes[s] - 1);
+                S.freq_Hz[i] = log_sweep ? (30E3 * pow(6E9 / 30E3, f)) : (30E3 + (6E9 - 30E3) * f);
+            }
+            S.freq_grid = -1;
+
+            for (S32 random = 0; random <= 1; random++)
+            {
+                std::vector<DOUBLE> query_Hz(n_queries);
+                std::vector<S32> index(n_queries);
+                std::vector<S32> ref_index(n_queries);
+                std::vector<DOUBLE> alpha(n_queries);
+                U32 seed = 12345;
+
+                // Screen/resampling grid (ascending) or cursor readouts (random)
+                for (S32 q = 0; q < n_queries; q++)
+                {
+                    seed = seed * 1664525U + 1013904223U;
+                    DOUBLE f = random ? ((seed >> 8) / 16777216.0) : ((DOUBLE)q / (n_queries - 1));
+                    query_Hz[q] = 1E6 + (5.9E9 - 1E6) * f;
+                }
+
+                DOUBLE ref_s = bench_s([&]()
+                {
+                    for (S32 q = 0; q < n_queries; q++)
+                    {
+                        ref_index[q] = nearest_freq_bsearch(&S, query_Hz[q], &alpha[q]);
+                    }
+                });
+                DOUBLE single_s = bench_s([&]()
+                {
+                    for (S32 q = 0; q < n_queries; q++)
+                    {
+                        index[q] = S.nearest_freq_Hz(query_Hz[q], &alpha[q]);
+                    }
+                });
+                bool same = (index == ref_index);
+                DOUBLE batch_s = bench_s([&]()
+                {
+                    S.nearest_freq_Hz(query_Hz.data(), n_queries, index.data(), alpha.data());
+                });
+                same &= (index == ref_index);
+
+                printf("nearest_freq_Hz %6d points %s sweep, %s queries: bsearch %.1f ns, single %.1f ns (x%.1f), batch %.1f ns (x%.1f)%s\n",
+                       sizes[s], log_sweep ? "log" : "uniform", random ? "random" : "ascending",
+                       ref_s * 1E9 / n_queries, single_s * 1E9 / n_queries, ref_s / single_s,
+                       batch_s * 1E9 / n_queries, ref_s / batch_s, same ? "" : " Error different index");
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    S32 n_points = (argc > 1) ? atoi(argv[1]) : 100000;
+
+    if (n_points < 2)
+    {
+        printf("Usage: sparams_bench [points]\n");
+        return 1;
+    }
+
+    BENCH_SPARAMS S;
+    if (!make_S2P(&S, n_points))
+    {
+        return 1;
+    }
+
+    bench_write_SNP(&S);
+    bench_read_SNP(&S);
+    bench_lerp_gen();
+    bench_nearest_freq_Hz();
+
+    return 0;
+}
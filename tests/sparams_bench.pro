@@ -0,0 +1,25 @@
+# sparams_bench: throughput of the SPARAMS Touchstone file access and interpolation (build in release)
+# (Qt core only, no VISA)
+QT = core
+
+TARGET = sparams_bench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+# For Visual Studio Compiler
+DEFINES += _CRT_SECURE_NO_WARNINGS
+
+# GCC/Clang vectorization flags of the SPARAMS conversion kernels
+include(../vna_compiler.pri)
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        ../trace_decode.cpp \
+        sparams_bench.cpp
+
+HEADERS += \
+        ../trace_decode.h \
+        ../typedefs.h
@@ -0,0 +1,261 @@
+/*
+trace_decode_bench: throughput of the trace decoders (see trace_decode_bench.pro)
+- FORM4: parse_FORM4_trace() vs one sscanf("%lf,%lf") per point (previous viScanf() loop)
+- FORM1: decode_FORM1_trace() with each DECODE_ISA supported vs conv_form1_real_imag() per point
+Synthetic traces of 201, 401, 801 and 1601 points (the 8753 max) are measured in one run.
+Usage: trace_decode_bench [recorded payload]
+The optional recorded payload is either a REC: transcript (vna_transcript.h), every FORM4 trace read
+(OUTPDATA/OUTPFORM/OUTPRAW after FORM4) is measured, or a FORM4 text file (capture_FORM4_raw() output).
+*/
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "trace_decode.h"
+#include "vna_transport.h"
+
+#define BENCH_MIN_SECONDS (0.5) // Each decoder is repeated at least this long
+
+static DOUBLE now_s(void)
+{
+    return std::chrono::duration<DOUBLE>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+Repeat decode(), return the throughput in points/s
+*/
+template <typename F>
+static DOUBLE bench_points_per_s(S32 n_points, F decode)
+{
+    S64 n_runs = 0;
+    DOUBLE start = now_s();
+    DOUBLE elapsed;
+
+    do
+    {
+        decode();
+        n_runs++;
+        elapsed = now_s() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+
+    return (DOUBLE)n_runs * n_points / elapsed;
+}
+
+/*
+8753 FORM4 trace ("%24.15E,%24.15E\n" per point)
+*/
+static std::string make_FORM4_trace(S32 n_points)
+{
+    std::string trace;
+    C8 line[64];
+
+    for (S32 i = 0; i < n_points; i++)
+    {
+        DOUBLE phi = 0.01 * i;
+        S32 len = snprintf(line, sizeof(line), "%24.15E,%24.15E\n", 0.9 * cos(phi) / (1.0 + i), -0.9 * sin(phi) * 1E-3);
+        trace.append(line, len);
+    }
+    return trace;
+}
+
+/*
+Parameters:
+const C8 *name => payload name printed
+const std::string &trace => FORM4 text
+S32 n_points => points in trace
+*/
+static void bench_FORM4(const C8 *name, const std::string &trace, S32 n_points)
+{
+    std::vector<COMPLEX_DOUBLE> dest(n_points, COMPLEX_DOUBLE(0.0, 0.0));
+    const C8 *src = trace.c_str();
+    S32 len = (S32)trace.size();
+    S32 n = 0;
+
+    DOUBLE fast = bench_points_per_s(n_points, [&]()
+    {
+        n = parse_FORM4_trace(src, len, dest.data(), n_points);
+    });
+    DOUBLE sscanf_rate = bench_points_per_s(n_points, [&]()
+    {
+        const C8 *p = src;
+        for (S32 i = 0; i < n_points; i++)
+        {
+            S32 used = 0;
+            sscanf(p, "%lf,%lf%n", &dest[i].real, &dest[i].imag, &used);
+            p += used;
+        }
+    });
+
+    printf("FORM4 %s %d points (%d decoded): parse_FORM4_trace %.1f Mpoints/s, sscanf %.1f Mpoints/s (x%.1f)\n",
+           name, n_points, n, fast / 1E6, sscanf_rate / 1E6, fast / sscanf_rate);
+}
+
+static U32 get_u32(const U8 *src)
+{
+    return (U32)src[0] | ((U32)src[1] << 8) | ((U32)src[2] << 16) | ((U32)src[3] << 24);
+}
+
+/*
+Extract the FORM4 traces read in a REC: transcript (format in vna_transcript.h)
+The reads following a trace query (OUTPDATA/OUTPFORM/OUTPRAW) are joined until END
+while FORM4 is the last output format selected.
+Parameters:
+const std::string &file => transcript file content
+std::vector<std::string> *traces => dest FORM4 traces
+Return FALSE if file is not a transcript
+*/
+static bool transcript_FORM4_traces(const std::string &file, std::vector<std::string> *traces)
+{
+    const U8 *data = (const U8 *)file.data();
+    size_t size = file.size();
+    size_t pos = 8; // "VNATRC" + U16 version
+    bool form4 = false;
+    bool query = false;
+    std::string trace;
+
+    if ((size < pos) || (memcmp(data, "VNATRC", 6) != 0))
+    {
+        return false;
+    }
+
+    while (pos + 13 <= size)
+    {
+        // U8 type + U32 delta_us + S32 status + U32 len
+        U8 type = data[pos];
+        S32 status = (S32)get_u32(&data[pos + 5]);
+        U32 len = get_u32(&data[pos + 9]);
+        pos += 13;
+        if (len > size - pos)
+        {
+            break;
+        }
+        std::string record((const C8 *)&data[pos], len);
+        pos += len;
+
+        if (type == 'W')
+        {
+            size_t form = record.rfind("FORM");
+            if ((form != std::string::npos) && (form + 4 < record.size()) && (record[form + 4] >= '1') && (record[form + 4] <= '5'))
+            {
+                form4 = (record[form + 4] == '4');
+            }
+            query = form4 && ((record.find("OUTPDATA") != std::string::npos) ||
+                              (record.find("OUTPFORM") != std::string::npos) ||
+                              (record.find("OUTPRAW") != std::string::npos));
+            trace.clear();
+        }
+        else if ((type == 'R') && query)
+        {
+            trace += record;
+            if (status != VNA_SUCCESS_MAX_CNT)
+            {
+                traces->push_back(trace);
+                trace.clear();
+                query = false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+Measure every FORM4 trace of a recorded payload (transcript or FORM4 text file)
+*/
+static bool bench_FORM4_recorded(const C8 *filename)
+{
+    FILE *in = fopen(filename, "rb");
+    if (in == NULL)
+    {
+        printf("Error cannot open %s\n", filename);
+        return false;
+    }
+
+    std::string file;
+    C8 buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+        file.append(buf, n);
+    }
+    fclose(in);
+
+    std::vector<std::string> traces;
+    if (!transcript_FORM4_traces(file, &traces))
+    {
+        traces.push_back(file);
+    }
+
+    S32 n_benched = 0;
+    for (size_t i = 0; i < traces.size(); i++)
+    {
+        // At least 4 bytes per point ("0,0\n")
+        std::vector<COMPLEX_DOUBLE> dest(traces[i].size() / 4 + 1);
+        S32 n_points = parse_FORM4_trace(traces[i].c_str(), (S32)traces[i].size(), dest.data(), (S32)dest.size());
+        if (n_points > 0)
+        {
+            C8 name[64];
+            snprintf(name, sizeof(name), "recorded #%d", (S32)i);
+            bench_FORM4(name, traces[i], n_points);
+            n_benched++;
+        }
+    }
+
+    if (n_benched == 0)
+    {
+        printf("Error no FORM4 trace in %s\n", filename);
+        return false;
+    }
+    return true;
+}
+
+static void bench_FORM1(S32 n_points)
+{
+    std::vector<U8> src(n_points * FORM1_BYTES_PER_POINT);
+    std::vector<COMPLEX_DOUBLE> dest(n_points, COMPLEX_DOUBLE(0.0, 0.0));
+
+    for (S32 i = 0; i < (S32)src.size(); i++)
+    {
+        src[i] = (U8)((i * 2654435761U) >> 13);
+    }
+
+    DOUBLE ref_rate = bench_points_per_s(n_points, [&]()
+    {
+        for (S32 i = 0; i < n_points; i++)
+        {
+            conv_form1_real_imag((t_form1_raw_imag_real *)&src[i * FORM1_BYTES_PER_POINT], &dest[i].real, &dest[i].imag);
+        }
+    });
+    printf("FORM1 %d points: conv_form1_real_imag %.1f Mpoints/s\n", n_points, ref_rate / 1E6);
+
+    for (S32 isa = DECODE_ISA_SCALAR; isa <= decode_best_isa(); isa++)
+    {
+        DOUBLE rate = bench_points_per_s(n_points, [&]()
+        {
+            decode_FORM1_trace(src.data(), (S32)src.size(), dest.data(), n_points, (DECODE_ISA)isa);
+        });
+        printf("FORM1 %d points: decode_FORM1_trace %s %.1f Mpoints/s (x%.1f)\n",
+               n_points, decode_isa_name((DECODE_ISA)isa), rate / 1E6, rate / ref_rate);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const S32 bench_points[] = { 201, 401, 801, 1601 };
+
+    for (S32 i = 0; i < (S32)(sizeof(bench_points) / sizeof(bench_points[0])); i++)
+    {
+        bench_FORM4("synthetic", make_FORM4_trace(bench_points[i]), bench_points[i]);
+    }
+    for (S32 i = 0; i < (S32)(sizeof(bench_points) / sizeof(bench_points[0])); i++)
+    {
+        bench_FORM1(bench_points[i]);
+    }
+
+    if ((argc > 1) && !bench_FORM4_recorded(argv[1]))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+# trace_decode_bench: throughput of the trace decoders (build in release)
+# (no Qt, no VISA)
+QT -= core gui
+
+TARGET = trace_decode_bench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+# For Visual Studio Compiler
+DEFINES += _CRT_SECURE_NO_WARNINGS
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        ../trace_decode.cpp \
+        trace_decode_bench.cpp
+
+HEADERS += \
+        ../trace_decode.h \
+        ../vna_transport.h \
+        ../typedefs.h
@@ -0,0 +1,318 @@
+/*
+trace_decode_test: checks of the trace decoders against their reference (see trace_decode_test.pro)
+- parse_ascii_double(): random numbers of every shape compared bit for bit with strtod()
+- decode_FORM1_trace(): every DECODE_ISA supported by the CPU compared bit for bit with conv_form1_real_imag()
+  on all the mantissa/exponent values then on random points (random length and alignment for the SIMD tails)
+- decode_FORM5_trace(): every DECODE_ISA supported by the CPU compared bit for bit with a float32 to double
+  reference, decoded in place (src in the upper half of dest) and from a separate buffer, for every point count
+  up to FORM5_TAIL_MAX_POINTS (odd counts, SIMD tails) then random counts
+Return 0 if all the checks pass
+*/
+#include <vector>
+
+#include "typedefs.h"
+#include "trace_decode.h"
+
+#define PARSE_TEST_COUNT (3000000)
+#define FORM1_RANDOM_TRACES (20000)
+#define FORM1_RANDOM_MAX_POINTS (1601)
+#define FORM5_TAIL_MAX_POINTS (64)
+#define FORM5_RANDOM_TRACES (20000)
+
+// xorshift64 (same sequence on every platform)
+static U64 rng_state = 0x9E3779B97F4A7C15ULL;
+static U64 rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/*
+Random number text: sign, 1 to 25 digits with a random decimal point, optional exponent
+or a random double printed with %.<1 to 17>g/E (FORM4 style)
+*/
+static S32 random_number_text(C8 *text, S32 size)
+{
+    U64 r = rng_next();
+    S32 len = 0;
+
+    if ((r & 3) == 0)
+    {
+        DOUBLE d;
+        U64 bits = rng_next();
+        memcpy(&d, &bits, sizeof(d));
+        if (!isfinite(d))
+        {
+            d = 1.0;
+        }
+        return snprintf(text, size, ((r >> 2) & 1) ? "%+.*E" : "%.*g", (S32)((r >> 3) % 17) + 1, d);
+    }
+
+    if ((r >> 2) & 1)
+    {
+        text[len++] = ((r >> 3) & 1) ? '-' : '+';
+    }
+    S32 n_digits = (S32)((r >> 4) % 25) + 1;
+    S32 point = (S32)((r >> 9) % (n_digits + 2)) - 1; // -1 = no decimal point
+    for (S32 i = 0; i < n_digits; i++)
+    {
+        if (i == point)
+        {
+            text[len++] = '.';
+        }
+        text[len++] = (C8)('0' + (rng_next() % 10));
+    }
+    if (point == n_digits)
+    {
+        text[len++] = '.';
+    }
+    if ((r >> 14) & 1)
+    {
+        len += snprintf(&text[len], size - len, "%c%d", ((r >> 15) & 1) ? 'E' : 'e', (S32)((r >> 16) % 661) - 330);
+    }
+    text[len] = 0;
+    return len;
+}
+
+static S32 test_parse_ascii_double(void)
+{
+    static const C8 *fixed[] =
+    {
+        "-8.9475169890225464e+10", "-.19E-21", "9007199254740993", "1E23", "2.2250738585072011E-308",
+        "4.9E-324", "1.7976931348623157E308", "1E309", "-0", "0.000000000000000000000000001", "+1.000000000000000E+09"
+    };
+    C8 text[128];
+    S32 n_fail = 0;
+
+    for (S32 i = 0; i < PARSE_TEST_COUNT + (S32)(sizeof(fixed) / sizeof(fixed[0])); i++)
+    {
+        S32 len;
+        if (i < (S32)(sizeof(fixed) / sizeof(fixed[0])))
+        {
+            len = snprintf(text, sizeof(text), "%s", fixed[i]);
+        }
+        else
+        {
+            len = random_number_text(text, sizeof(text));
+        }
+
+        DOUBLE ref;
+        DOUBLE value = 0.0;
+        C8 *ref_end = NULL;
+        ref = strtod(text, &ref_end);
+        const C8 *end = parse_ascii_double(text, text + len, &value);
+        if ((end != ref_end) || memcmp(&ref, &value, sizeof(DOUBLE)))
+        {
+            if (n_fail < 10)
+            {
+                printf("  parse_ascii_double(\"%s\") = %.17g (%d chars), strtod() = %.17g (%d chars)\n",
+                       text, value, (end != NULL) ? (S32)(end - text) : -1, ref, (S32)(ref_end - text));
+            }
+            n_fail++;
+        }
+    }
+
+    printf("parse_ascii_double: %d numbers, %d different from strtod()\n", PARSE_TEST_COUNT, n_fail);
+    return n_fail;
+}
+
+/*
+Decode n points of src with isa and compare with conv_form1_real_imag()
+Return number of points different (bits)
+*/
+static S32 check_FORM1(const U8 *src, S32 n, DECODE_ISA isa, std::vector<COMPLEX_DOUBLE> *dest)
+{
+    S32 n_fail = 0;
+
+    dest->assign(n + 1, COMPLEX_DOUBLE(-1.0, -1.0));
+    if (decode_FORM1_trace(src, n * FORM1_BYTES_PER_POINT, dest->data(), n, isa) != n)
+    {
+        return n;
+    }
+    for (S32 i = 0; i < n; i++)
+    {
+        DOUBLE real;
+        DOUBLE imag;
+
+        conv_form1_real_imag((t_form1_raw_imag_real *)&src[i * FORM1_BYTES_PER_POINT], &real, &imag);
+        if (memcmp(&real, &(*dest)[i].real, sizeof(DOUBLE)) || memcmp(&imag, &(*dest)[i].imag, sizeof(DOUBLE)))
+        {
+            if (n_fail < 10)
+            {
+                printf("  %s point %02X %02X %02X %02X %02X %02X = %.17g, %.17g expected %.17g, %.17g\n",
+                       decode_isa_name(isa), src[i * 6], src[i * 6 + 1], src[i * 6 + 2], src[i * 6 + 3],
+                       src[i * 6 + 4], src[i * 6 + 5], (*dest)[i].real, (*dest)[i].imag, real, imag);
+            }
+            n_fail++;
+        }
+    }
+    if (((*dest)[n].real != -1.0) || ((*dest)[n].imag != -1.0))
+    {
+        printf("  %s wrote after the last point (%d points)\n", decode_isa_name(isa), n);
+        n_fail++;
+    }
+
+    return n_fail;
+}
+
+static S32 test_decode_FORM1(void)
+{
+    std::vector<U8> src;
+    std::vector<COMPLEX_DOUBLE> dest;
+    S32 n_fail_total = 0;
+
+    for (S32 isa = DECODE_ISA_SCALAR; isa <= DECODE_ISA_AVX2; isa++)
+    {
+        if (isa > decode_best_isa())
+        {
+            printf("decode_FORM1_trace %s: not supported by this CPU, skipped\n", decode_isa_name((DECODE_ISA)isa));
+            continue;
+        }
+        S32 n_fail = 0;
+        U64 n_points = 0;
+
+        // All the mantissas (imag, real permuted) with all the exponents
+        src.resize(65536 * FORM1_BYTES_PER_POINT);
+        for (S32 e = 0; e < 256; e++)
+        {
+            for (S32 i = 0; i < 65536; i++)
+            {
+                U32 real = ((U32)i * 40503U + 12345U) & 0xFFFF;
+                U8 *point = &src[i * FORM1_BYTES_PER_POINT];
+
+                point[0] = (U8)(i >> 8);
+                point[1] = (U8)i;
+                point[2] = (U8)(real >> 8);
+                point[3] = (U8)real;
+                point[4] = (U8)(i * 7);
+                point[5] = (U8)e;
+            }
+            n_fail += check_FORM1(src.data(), 65536, (DECODE_ISA)isa, &dest);
+            n_points += 65536;
+        }
+
+        // Random points, length and alignment
+        src.resize(FORM1_RANDOM_MAX_POINTS * FORM1_BYTES_PER_POINT + 32);
+        for (S32 t = 0; t < FORM1_RANDOM_TRACES; t++)
+        {
+            S32 n = 1 + (S32)(rng_next() % FORM1_RANDOM_MAX_POINTS);
+            S32 offset = (S32)(rng_next() % 32);
+            for (S32 i = 0; i < n * FORM1_BYTES_PER_POINT; i++)
+            {
+                src[offset + i] = (U8)rng_next();
+            }
+            n_fail += check_FORM1(&src[offset], n, (DECODE_ISA)isa, &dest);
+            n_points += n;
+        }
+
+        printf("decode_FORM1_trace %s: %llu points, %d different from conv_form1_real_imag()\n",
+               decode_isa_name((DECODE_ISA)isa), (unsigned long long)n_points, n_fail);
+        n_fail_total += n_fail;
+    }
+
+    return n_fail_total;
+}
+
+/*
+Decode n random FORM5 points with isa, in place or from a separate buffer at offset, and compare with
+the float32 (little endian) to double conversion of each value
+Return number of points different (bits)
+*/
+static S32 check_FORM5(S32 n, bool in_place, S32 offset, DECODE_ISA isa)
+{
+    std::vector<COMPLEX_DOUBLE> dest(n + 1, COMPLEX_DOUBLE(-1.0, -1.0));
+    std::vector<U8> separate(n * FORM5_BYTES_PER_POINT + 32);
+    std::vector<U8> ref_src(n * FORM5_BYTES_PER_POINT);
+    U8 *src = in_place ? (U8 *)dest.data() + n * FORM5_BYTES_PER_POINT : &separate[offset];
+    S32 n_fail = 0;
+
+    for (S32 i = 0; i < n * FORM5_BYTES_PER_POINT; i++)
+    {
+        ref_src[i] = (U8)rng_next();
+    }
+    if (n > 0)
+    {
+        memcpy(src, ref_src.data(), ref_src.size());
+    }
+
+    if (decode_FORM5_trace(src, n * FORM5_BYTES_PER_POINT, dest.data(), n, isa) != n)
+    {
+        return max(n, 1);
+    }
+    for (S32 i = 0; i < n; i++)
+    {
+        const U8 *point = &ref_src[i * FORM5_BYTES_PER_POINT];
+        F32 value[2];
+
+        for (S32 k = 0; k < 2; k++)
+        {
+            U32 bits = (U32)point[k * 4] | ((U32)point[k * 4 + 1] << 8) | ((U32)point[k * 4 + 2] << 16) | ((U32)point[k * 4 + 3] << 24);
+            memcpy(&value[k], &bits, sizeof(value[k]));
+        }
+        DOUBLE real = value[0];
+        DOUBLE imag = value[1];
+        if (memcmp(&real, &dest[i].real, sizeof(DOUBLE)) || memcmp(&imag, &dest[i].imag, sizeof(DOUBLE)))
+        {
+            if (n_fail < 10)
+            {
+                printf("  %s %s point %d of %d = %.9g, %.9g expected %.9g, %.9g\n", decode_isa_name(isa),
+                       in_place ? "in place" : "separate", i, n, dest[i].real, dest[i].imag, real, imag);
+            }
+            n_fail++;
+        }
+    }
+    if ((dest[n].real != -1.0) || (dest[n].imag != -1.0))
+    {
+        printf("  %s wrote after the last point (%d points)\n", decode_isa_name(isa), n);
+        n_fail++;
+    }
+
+    return n_fail;
+}
+
+static S32 test_decode_FORM5(void)
+{
+    S32 n_fail_total = 0;
+
+    for (S32 isa = DECODE_ISA_SCALAR; isa <= DECODE_ISA_AVX2; isa++)
+    {
+        if (isa > decode_best_isa())
+        {
+            printf("decode_FORM5_trace %s: not supported by this CPU, skipped\n", decode_isa_name((DECODE_ISA)isa));
+            continue;
+        }
+        S32 n_fail = 0;
+        U64 n_points = 0;
+
+        // Every count up to FORM5_TAIL_MAX_POINTS (all the SIMD tails), then random counts and alignments
+        for (S32 t = 0; t < FORM5_TAIL_MAX_POINTS + FORM5_RANDOM_TRACES; t++)
+        {
+            S32 n = (t < FORM5_TAIL_MAX_POINTS) ? (t + 1) : (1 + (S32)(rng_next() % FORM1_RANDOM_MAX_POINTS));
+            S32 offset = (S32)(rng_next() % 32);
+
+            n_fail += check_FORM5(n, TRUE, 0, (DECODE_ISA)isa);
+            n_fail += check_FORM5(n, FALSE, offset, (DECODE_ISA)isa);
+            n_points += 2 * n;
+        }
+
+        printf("decode_FORM5_trace %s: %llu points (in place and separate), %d different from float32 to double\n",
+               decode_isa_name((DECODE_ISA)isa), (unsigned long long)n_points, n_fail);
+        n_fail_total += n_fail;
+    }
+
+    return n_fail_total;
+}
+
+int main(void)
+{
+    S32 n_fail = 0;
+
+    n_fail += test_parse_ascii_double();
+    n_fail += test_decode_FORM1();
+    n_fail += test_decode_FORM5();
+
+    printf("%s\n", (n_fail == 0) ? "PASS" : "FAIL");
+    return (n_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+# trace_decode_test: checks of the trace decoders against their reference, returns 0 when all the checks pass
+# (no Qt, no VISA)
+QT -= core gui
+
+TARGET = trace_decode_test
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+# For Visual Studio Compiler
+DEFINES += _CRT_SECURE_NO_WARNINGS
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        ../trace_decode.cpp \
+        trace_decode_test.cpp
+
+HEADERS += \
+        ../trace_decode.h \
+        ../typedefs.h
@@ -0,0 +1,115 @@
+#ifndef TRACE_DECODE_H
+#define TRACE_DECODE_H
+
+#include "typedefs.h"
+
+// FORM1 data format see http://www.vnahelp.com/tip23.html
+typedef struct form1_raw_imag_real
+{
+    unsigned char imag_msb; /* imaginary mantissa */
+    unsigned char imag_lsb;
+
+    unsigned char real_msb; /* real mantissa */
+    unsigned char real_lsb;
+
+    unsigned char unused; /* additional resolution (imag/real) not used */
+    unsigned char common_exp; /* common exponent */
+} t_form1_raw_imag_real;
+
+#define FORM1_BYTES_PER_POINT (6)
+
+// SIMD instruction set used by the FORM1 batch decoder
+enum DECODE_ISA
+{
+    DECODE_ISA_AUTO = 0,  // Best one supported by the CPU (detected once at runtime)
+    DECODE_ISA_SCALAR,
+    DECODE_ISA_SSE2,
+    DECODE_ISA_AVX2
+};
+
+// FORM4 ASCII data is 50 bytes per point (2 x 24 chars + separator + LF) see 08753-90256 "Data Transfer"
+#define FORM4_BYTES_PER_POINT (50)
+
+/*
+ASCII number parser (no sscanf)
+Used for FORM4 trace data and ASCII replies (OUTPACTI, OUTPLIML ...)
+Parameters:
+const C8 *src => first char to parse (leading spaces, tabs, commas, CR and LF are skipped)
+const C8 *end => end of buffer (never read)
+DOUBLE *value => parsed value
+Return pointer on the first char after the number or nullptr if there is no number to parse
+
+Result is correctly rounded (same as strtod()) for numbers up to 255 chars:
+- mantissa exact in a double (<= 2^53) and exponent within +-22 (most 8753 FORM4 values):
+  one exact multiply or divide (fast path)
+- else strtod() of a copy ('.' decimal point of the "C" numeric locale, kept by Qt)
+*/
+const C8 *parse_ascii_double(const C8 *src, const C8 *end, DOUBLE *value);
+
+/*
+Parse a whole FORM4 trace ("real, imag" per line)
+Parameters:
+const C8 *src => ASCII trace data
+S32 len => size of src in bytes
+COMPLEX_DOUBLE *dest => dest data
+S32 cnt => number of points expected
+Return number of points decoded (cnt on success)
+*/
+S32 parse_FORM4_trace(const C8 *src, S32 len, COMPLEX_DOUBLE *dest, S32 cnt);
+
+// OUTPLIML ASCII data is 100 bytes per point (4 x 24 chars + 3 separators + LF) see 08753-90256 "OUTPLIML"
+#define OUTPLIML_BYTES_PER_POINT (100)
+
+/*
+Parse the stimulus values of a whole OUTPLIML reply
+("stimulus, limit test result, upper limit, lower limit" per line)
+Parameters:
+const C8 *src => ASCII OUTPLIML data
+S32 len => size of src in bytes
+DOUBLE *dest => dest stimulus values (frequency in Hz for a frequency sweep)
+S32 cnt => number of points expected
+Return number of points decoded (cnt on success)
+*/
+S32 parse_OUTPLIML_stimulus(const C8 *src, S32 len, DOUBLE *dest, S32 cnt);
+
+/*
+Scalar FORM1 point decoder (reference implementation)
+real/imag = (mantissa / 2^15) * 2^common_exp
+*/
+void conv_form1_real_imag(t_form1_raw_imag_real *data_in, double* real, double* imag);
+
+/*
+Batch FORM1 decoder for a whole trace (data following the "#A" + 2 bytes length header)
+2^exp is built directly in the double exponent bits (no table) so the result is
+bit for bit identical to conv_form1_real_imag() whatever the ISA used.
+Parameters:
+const U8 *src => FORM1 raw data (6 bytes per point)
+S32 len => size of src in bytes
+COMPLEX_DOUBLE *dest => dest data
+S32 cnt => max number of points to decode
+DECODE_ISA isa => DECODE_ISA_AUTO (Default) or force a given path (falls back to the best supported one)
+Return number of points decoded min(len / 6, cnt)
+*/
+S32 decode_FORM1_trace(const U8 *src, S32 len, COMPLEX_DOUBLE *dest, S32 cnt, DECODE_ISA isa = DECODE_ISA_AUTO);
+
+// FORM5 PC_FLOAT32 data is 8 bytes per point (real, imag little endian float32)
+#define FORM5_BYTES_PER_POINT (8)
+
+/*
+Batch FORM5 decoder for a whole trace (data following the "#A" + 2 bytes length header)
+Parameters:
+const U8 *src => FORM5 raw data (8 bytes per point)
+S32 len => size of src in bytes
+COMPLEX_DOUBLE *dest => dest data, src can be in the upper half of dest
+                        (src = (U8 *)dest + cnt * FORM5_BYTES_PER_POINT) to decode in place
+S32 cnt => max number of points to decode
+DECODE_ISA isa => DECODE_ISA_AUTO (Default) or force a given path (falls back to the best supported one)
+Return number of points decoded min(len / 8, cnt)
+*/
+S32 decode_FORM5_trace(const U8 *src, S32 len, COMPLEX_DOUBLE *dest, S32 cnt, DECODE_ISA isa = DECODE_ISA_AUTO);
+
+// Best ISA supported by this CPU for decode_FORM1_trace()/decode_FORM5_trace()
+DECODE_ISA decode_best_isa(void);
+const C8 *decode_isa_name(DECODE_ISA isa);
+
+#endif // TRACE_DECODE_H
@@ -14,6 +14,25 @@
 #include <math.h>
 #include <float.h>
 #include <malloc.h>
+#include <stdarg.h>
+
+#if !defined(_MSC_VER) && !defined(_WIN32)
+// MSVC CRT names used by the code base (GCC/Clang on Linux, see vna_sim.h)
+#include <strings.h>
+#include <alloca.h>
+#define __int64 long long
+#define _snprintf snprintf
+#define _vsnprintf vsnprintf
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+#define _fseeki64 fseeko
+#define _ftelli64 ftello
+static inline char *_strupr(char *str)
+{
+   for (char *p = str; *p; p++) *p = (char) toupper((unsigned char) *p);
+   return str;
+}
+#endif
 
 #include <algorithm>
 using namespace std;
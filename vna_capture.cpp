@@ -0,0 +1,321 @@
+/*
+vna_capture: headless Touchstone capture (acquisition core without the GUI, see vna_capture.pro)
+
+The acquisition jobs (see acquisition) are run one after the other from the main thread:
+optional number of points, then one or more save_SnP() captures with the time of each stage
+(see t_capture_timing) and the min/avg/max of each stage at the end.
+Without VISA (Linux) only the simulated instrument "SIM::8753[::OPTION=value]..." is available (see vna_sim.h).
+*/
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include "acquisition.h"
+#include "typedefs.h"
+
+// Stages printed (see t_capture_timing)
+static const struct
+{
+    const C8 *name;
+    DOUBLE t_capture_timing::*ms;
+} capture_stages[] =
+{
+    { "setup", &t_capture_timing::setup_ms },
+    { "stimulus", &t_capture_timing::stimulus_ms },
+    { "freq axis", &t_capture_timing::freq_axis_ms },
+    { "active param", &t_capture_timing::active_param_ms },
+    { "traces", &t_capture_timing::traces_ms },
+    { "decode", &t_capture_timing::decode_ms },
+    { "restore", &t_capture_timing::restore_ms },
+    { "write", &t_capture_timing::write_ms },
+    { "total", &t_capture_timing::total_ms }
+};
+#define CAPTURE_STAGES ((S32)(sizeof(capture_stages) / sizeof(capture_stages[0])))
+
+static bool verbose = FALSE;
+
+// qDebug() traces of the acquisition only printed with -verbose
+static void message_handler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    Q_UNUSED(context);
+
+    if ((type == QtDebugMsg) && !verbose)
+    {
+        return;
+    }
+    fprintf(stderr, "%s\n", msg.toLocal8Bit().constData());
+}
+
+static void usage(void)
+{
+    printf("Usage: vna_capture [options] <output file .S1P/.S2P>\n"
+           "Capture S-parameters to a Touchstone file (repeated: <name>_<capture>.S1P/.S2P)\n"
+           "Options:\n"
+           "  -resource STR          VISA resource (default SIM::8753, e.g. GPIB0::16::INSTR)\n"
+           "  -form 1|4|5            Transfer format (default 1)\n"
+           "  -param S2P|S11|S21|S22 S2P (default) or S1P of one parameter\n"
+           "  -points N              Set the number of points before the captures (default unchanged)\n"
+           "  -query OUTPDATA|OUTPFORM\n"
+           "                         Trace query (default OUTPDATA)\n"
+           "  -format MA|DB|RI       Data format (default MA)\n"
+           "  -freq HZ|KHZ|MHZ|GHZ   Frequency unit (default HZ)\n"
+           "  -digits N              Significant digits 1 to 17 (default 0 = \"%%lf\" 6 decimals)\n"
+           "  -dc N                  DC entry (default 0 = none)\n"
+           "  -single                S2P: one sweep for the 4 parameters (correction ON)\n"
+           "  -repeat N              Number of captures (default 1)\n"
+           "  -verbose               Print the acquisition traces\n");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    t_snp_capture_cfg cfg;
+    const C8 *resource = "SIM::8753";
+    const C8 *param = "S2P";
+    const C8 *freq = "HZ";
+    const C8 *out_name = NULL;
+    S32 nb_points = 0;
+    S32 repeat = 1;
+
+    cfg.form = 1;
+    cfg.SnP = 2;
+    strcpy(cfg.param, "");
+    strcpy(cfg.query, "OUTPDATA");
+    cfg.R_ohms = 50.0;
+    strcpy(cfg.data_format, "MA");
+    strcpy(cfg.freq_format, "Hz");
+    cfg.digits = 0;
+    cfg.DC_entry = 0;
+    cfg.single_sweep_S2P = FALSE;
+    cfg.stream_drop_frames = FALSE;
+    cfg.stream_archive = FALSE;
+
+    for (S32 i = 1; i < argc; i++)
+    {
+        const C8 *arg = argv[i];
+        bool has_value = (i + 1 < argc);
+
+        if (!_stricmp(arg, "-resource") && has_value)
+        {
+            resource = argv[++i];
+        }
+        else if (!_stricmp(arg, "-form") && has_value)
+        {
+            cfg.form = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-param") && has_value)
+        {
+            param = argv[++i];
+        }
+        else if (!_stricmp(arg, "-points") && has_value)
+        {
+            nb_points = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-query") && has_value)
+        {
+            memset(cfg.query, 0, sizeof(cfg.query));
+            strncpy(cfg.query, argv[++i], sizeof(cfg.query) - 1);
+        }
+        else if (!_stricmp(arg, "-format") && has_value)
+        {
+            memset(cfg.data_format, 0, sizeof(cfg.data_format));
+            strncpy(cfg.data_format, argv[++i], sizeof(cfg.data_format) - 1);
+        }
+        else if (!_stricmp(arg, "-freq") && has_value)
+        {
+            freq = argv[++i];
+        }
+        else if (!_stricmp(arg, "-digits") && has_value)
+        {
+            cfg.digits = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-dc") && has_value)
+        {
+            cfg.DC_entry = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-single"))
+        {
+            cfg.single_sweep_S2P = TRUE;
+        }
+        else if (!_stricmp(arg, "-repeat") && has_value)
+        {
+            repeat = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-verbose"))
+        {
+            verbose = TRUE;
+        }
+        else if ((arg[0] != '-') && (out_name == NULL))
+        {
+            out_name = arg;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if ((out_name == NULL) || (repeat < 1) || (nb_points < 0) || (cfg.DC_entry < 0) || (cfg.digits < 0) || (cfg.digits > 17))
+    {
+        usage();
+        return 1;
+    }
+    if ((cfg.form != 1) && (cfg.form != 4) && (cfg.form != 5))
+    {
+        printf("Error unknown form %d\n", cfg.form);
+        return 1;
+    }
+    if (!_stricmp(param, "S2P"))
+    {
+        cfg.SnP = 2;
+    }
+    else if (!_stricmp(param, "S11") || !_stricmp(param, "S21") || !_stricmp(param, "S22"))
+    {
+        cfg.SnP = 1;
+        sprintf(cfg.param, "S%c%c", param[1], param[2]);
+    }
+    else
+    {
+        printf("Error unknown parameter %s\n", param);
+        return 1;
+    }
+    if (_stricmp(cfg.data_format, "MA") && _stricmp(cfg.data_format, "DB") && _stricmp(cfg.data_format, "RI"))
+    {
+        printf("Error unknown format %s\n", cfg.data_format);
+        return 1;
+    }
+    cfg.data_format[0] = toupper(cfg.data_format[0]);
+    cfg.data_format[1] = toupper(cfg.data_format[1]);
+    if (!_stricmp(freq, "HZ"))
+    {
+        strcpy(cfg.freq_format, "Hz");
+    }
+    else if (!_stricmp(freq, "KHZ"))
+    {
+        strcpy(cfg.freq_format, "kHz");
+    }
+    else if (!_stricmp(freq, "MHZ"))
+    {
+        strcpy(cfg.freq_format, "MHz");
+    }
+    else if (!_stricmp(freq, "GHZ"))
+    {
+        strcpy(cfg.freq_format, "GHz");
+    }
+    else
+    {
+        printf("Error unknown frequency unit %s\n", freq);
+        return 1;
+    }
+
+    // Output "<name>.SnP" (one capture) or "<name>_<capture>.SnP"
+    QFileInfo out_info(QString::fromLocal8Bit(out_name));
+    std::string out_base = (out_info.path() + "/" + out_info.completeBaseName()).toLocal8Bit().constData();
+    std::string out_ext = out_info.suffix().toLocal8Bit().constData();
+    if (out_ext.length() == 0)
+    {
+        out_ext = (cfg.SnP == 1) ? "S1P" : "S2P";
+    }
+
+    qInstallMessageHandler(message_handler);
+
+    //
+    // Acquisition core, the jobs run in this thread (signals are direct calls)
+    //
+    acquisition acq;
+    bool result = FALSE;
+    QObject::connect(&acq, &acquisition::log, [](QString text)
+    {
+        printf("%s\n", text.toLocal8Bit().constData());
+    });
+    QObject::connect(&acq, &acquisition::stimulus_changed,
+                     [](double center_Hz, double span_Hz, double start_Hz, double stop_Hz, int points)
+    {
+        Q_UNUSED(center_Hz);
+        Q_UNUSED(span_Hz);
+        printf("Stimulus %.0lf Hz to %.0lf Hz, %d points\n", start_Hz, stop_Hz, points);
+    });
+    QObject::connect(&acq, &acquisition::save_SnP_finished, [&result](bool res)
+    {
+        result = res;
+    });
+
+    acq.set_resource(QString::fromLocal8Bit(resource));
+    if (nb_points > 0)
+    {
+        acq.stimulus_write_nb_points(nb_points);
+    }
+    else
+    {
+        acq.stimulus_read();
+    }
+
+    t_capture_timing stage_min;
+    t_capture_timing stage_max;
+    t_capture_timing stage_sum;
+    S32 n_ok = 0;
+    S32 n_failed = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (S32 n = 1; n <= repeat; n++)
+    {
+        C8 filename[1024];
+
+        if (repeat == 1)
+        {
+            snprintf(filename, sizeof(filename), "%s.%s", out_base.c_str(), out_ext.c_str());
+        }
+        else
+        {
+            snprintf(filename, sizeof(filename), "%s_%04d.%s", out_base.c_str(), n, out_ext.c_str());
+        }
+        cfg.filename = QString::fromLocal8Bit(filename);
+
+        result = FALSE;
+        acq.save_SnP(cfg);
+        if (!result)
+        {
+            n_failed++;
+            printf("Capture %d/%d failed\n", n, repeat);
+            continue;
+        }
+
+        t_capture_timing timing = acq.last_capture_timing();
+        printf("Capture %d/%d %s:", n, repeat, filename);
+        for (S32 s = 0; s < CAPTURE_STAGES; s++)
+        {
+            DOUBLE ms = timing.*capture_stages[s].ms;
+
+            printf(" %s %.1lf%s", capture_stages[s].name, ms, (s < CAPTURE_STAGES - 1) ? "," : " ms\n");
+            if (n_ok == 0)
+            {
+                stage_min.*capture_stages[s].ms = ms;
+                stage_max.*capture_stages[s].ms = ms;
+                stage_sum.*capture_stages[s].ms = ms;
+            }
+            else
+            {
+                stage_min.*capture_stages[s].ms = min(stage_min.*capture_stages[s].ms, ms);
+                stage_max.*capture_stages[s].ms = max(stage_max.*capture_stages[s].ms, ms);
+                stage_sum.*capture_stages[s].ms += ms;
+            }
+        }
+        n_ok++;
+    }
+
+    DOUBLE elapsed_s = max(1E-6, timer.nsecsElapsed() / 1E9);
+    printf("%d captures, %d failed in %.3lf s: %.2lf captures/s\n", n_ok, n_failed, elapsed_s, n_ok / elapsed_s);
+    if (n_ok > 1)
+    {
+        printf("%-14s %10s %10s %10s\n", "Stage (ms)", "min", "avg", "max");
+        for (S32 s = 0; s < CAPTURE_STAGES; s++)
+        {
+            printf("%-14s %10.1lf %10.1lf %10.1lf\n", capture_stages[s].name, stage_min.*capture_stages[s].ms,
+                   stage_sum.*capture_stages[s].ms / n_ok, stage_max.*capture_stages[s].ms);
+        }
+    }
+
+    return (n_failed == 0) ? 0 : 2;
+}
@@ -0,0 +1,54 @@
+# vna_capture: headless Touchstone capture (acquisition core without the GUI, see vna_capture.cpp)
+# Without VISA (other platforms) only the simulated instrument "SIM::8753" is available (see vna_sim.h)
+QT = core
+
+TARGET = vna_capture
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+# For Visual Studio Compiler
+DEFINES += _CRT_SECURE_NO_WARNINGS
+
+# GCC/Clang vectorization flags of the SPARAMS conversion kernels
+include(vna_compiler.pri)
+
+SOURCES += \
+        acquisition.cpp \
+        capture_pipeline.cpp \
+        frame_ring.cpp \
+        trace_decode.cpp \
+        vna_capture.cpp \
+        vna_sim.cpp \
+        vna_transcript.cpp \
+        vna_transport.cpp
+
+HEADERS += \
+        acquisition.h \
+        capture_pipeline.h \
+        frame_ring.h \
+        trace_decode.h \
+        typedefs.h \
+        version.h \
+        vna_sim.h \
+        vna_transcript.h \
+        vna_transport.h
+
+unix:!android: target.path = /opt/vna_qt/bin
+!isEmpty(target.path): INSTALLS += target
+
+# Path for VISA after installation of KeySight IOLibSuite_18_1_24130.exe (https://www.keysight.com/en/pd-1985909/io-libraries-suite)
+win32 {
+    DEFINES += VNA_HAVE_VISA
+    contains(QT_ARCH, i386) {
+        message("32-bit")
+        LIBS += "C:\Program Files (x86)\IVI Foundation\VISA\WinNT\lib\msc\visa32.lib"
+        INCLUDEPATH += "C:\Program Files (x86)\IVI Foundation\VISA\WinNT\Include"
+    } else {
+        message("64-bit")
+        LIBS += "C:\Program Files\IVI Foundation\VISA\Win64\Lib_x64\msc\visa64.lib"
+        INCLUDEPATH += "C:\Program Files\IVI Foundation\VISA\Win64\Include"
+    }
+}
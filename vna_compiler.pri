@@ -0,0 +1,8 @@
+# Compiler flags shared by vna_qt.pro, vna_capture.pro, vna_snp_convert.pro and tests/sparams_bench.pro
+
+# GCC/Clang (also MinGW): allow the vectorization of the SPARAMS whole trace conversion kernels
+# (sparams.cpp SPARAM::CONV_FAST): sqrt() without errno, if-converted floating point selects
+contains(QMAKE_COMPILER, gcc) {
+    QMAKE_CXXFLAGS += -fno-math-errno -fno-trapping-math
+    !contains(QMAKE_COMPILER, clang): QMAKE_CXXFLAGS += -fvect-cost-model=dynamic
+}
@@ -15,16 +15,33 @@ DEFINES += _CRT_SECURE_NO_WARNINGS
 
 CONFIG += c++11
 
+# GCC/Clang vectorization flags of the SPARAMS conversion kernels
+include(vna_compiler.pri)
+
 SOURCES += \
+        acquisition.cpp \
+        capture_pipeline.cpp \
+        frame_ring.cpp \
         main.cpp \
         mainwindow.cpp \
-        progress.cpp
+        progress.cpp \
+        trace_decode.cpp \
+        vna_sim.cpp \
+        vna_transcript.cpp \
+        vna_transport.cpp
 
 HEADERS += \
+        acquisition.h \
+        capture_pipeline.h \
+        frame_ring.h \
         mainwindow.h \
         progress.h \
+        trace_decode.h \
         typedefs.h \
-        version.h
+        version.h \
+        vna_sim.h \
+        vna_transcript.h \
+        vna_transport.h
 
 FORMS += \
         mainwindow.ui
@@ -36,14 +53,18 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 # Path for VISA after installation of KeySight IOLibSuite_18_1_24130.exe (https://www.keysight.com/en/pd-1985909/io-libraries-suite)
 # Used with Keysight 82357B USB/GPIB Interface USB 2.0
-contains(QT_ARCH, i386) {
-    message("32-bit")
-    LIBS += "C:\Program Files (x86)\IVI Foundation\VISA\WinNT\lib\msc\visa32.lib"
-    INCLUDEPATH += "C:\Program Files (x86)\IVI Foundation\VISA\WinNT\Include"
-} else {
-    message("64-bit")
-    LIBS += "C:\Program Files\IVI Foundation\VISA\Win64\Lib_x64\msc\visa64.lib"
-    INCLUDEPATH += "C:\Program Files\IVI Foundation\VISA\Win64\Include"
+# Without VISA (other platforms) only the simulated instrument "SIM::8753" is available (see vna_sim.h)
+win32 {
+    DEFINES += VNA_HAVE_VISA
+    contains(QT_ARCH, i386) {
+        message("32-bit")
+        LIBS += "C:\Program Files (x86)\IVI Foundation\VISA\WinNT\lib\msc\visa32.lib"
+        INCLUDEPATH += "C:\Program Files (x86)\IVI Foundation\VISA\WinNT\Include"
+    } else {
+        message("64-bit")
+        LIBS += "C:\Program Files\IVI Foundation\VISA\Win64\Lib_x64\msc\visa64.lib"
+        INCLUDEPATH += "C:\Program Files\IVI Foundation\VISA\Win64\Include"
+    }
 }
 
 RESOURCES += \
@@ -0,0 +1,741 @@
+#include <QDebug>
+
+#include <chrono>
+#include <thread>
+
+#include "vna_sim.h"
+#include "trace_decode.h"
+
+#define SIM_DELAY_NS (1e-9) // Synthetic traces electrical delay (s)
+#define SIM_LOWPASS_HZ (1e9) // Synthetic S21/S12 low pass corner frequency (Hz)
+#define SIM_PRESET_POINTS (201) // Instrument preset stimulus (unless set by the resource options)
+#define SIM_PRESET_START_HZ (30e3)
+#define SIM_PRESET_STOP_HZ (6e9)
+
+static const S32 sim_points_list[] = { 3, 11, 21, 26, 51, 101, 201, 401, 801, 1601 }; // 8753D allowed POIN values
+static const C8 sim_sparam_names[4][4] = { "S11", "S21", "S12", "S22" };
+
+vna_sim_8753::vna_sim_8753()
+{
+    is_open = FALSE;
+    timeout_ms = 10000;
+    byte_ns = 0;
+    turn_us = 0;
+    sweep_ms = 0;
+    pending_delay_ns = 0;
+    reply_pos = 0;
+    preset_points = SIM_PRESET_POINTS;
+    preset_start_Hz = SIM_PRESET_START_HZ;
+    preset_stop_Hz = SIM_PRESET_STOP_HZ;
+    preset_correction = FALSE;
+    preset_lin_sweep = TRUE;
+    memset(recorded_points, 0, sizeof(recorded_points));
+    preset();
+}
+
+bool vna_sim_8753::is_sim_resource(const C8 *resource)
+{
+    return (_strnicmp(resource, "SIM", 3) == 0);
+}
+
+/*
+Parameters:
+const C8 *resource => "SIM::8753[::OPTION=value]..." (see vna_sim.h)
+U32 timeout_ms => Read timeout (an empty output queue returns VNA_ERROR_TMO immediately)
+*/
+VNA_STATUS vna_sim_8753::open(const C8 *resource, U32 timeout_ms)
+{
+    C8 options[1024] = { 0 };
+
+    if (!is_sim_resource(resource))
+    {
+        return VNA_ERROR_RSRC_NFOUND;
+    }
+
+    this->timeout_ms = timeout_ms;
+    byte_ns = 0;
+    turn_us = 0;
+    sweep_ms = 0;
+    // Options of a previous session don't apply to this one
+    preset_points = SIM_PRESET_POINTS;
+    preset_start_Hz = SIM_PRESET_START_HZ;
+    preset_stop_Hz = SIM_PRESET_STOP_HZ;
+    preset_correction = FALSE;
+    preset_lin_sweep = TRUE;
+    memset(recorded_points, 0, sizeof(recorded_points));
+
+    _snprintf(options, sizeof(options) - 1, "%s", resource);
+    for (C8 *opt = strstr(options, "::"); opt != NULL; )
+    {
+        opt += 2;
+        C8 *next = strstr(opt, "::");
+        if (next != NULL)
+        {
+            *next = 0;
+        }
+
+        C8 *value = strchr(opt, '=');
+        if (value != NULL)
+        {
+            *value++ = 0;
+            if (!_stricmp(opt, "BYTE_NS"))
+            {
+                byte_ns = (U32)atoi(value);
+            }
+            else if (!_stricmp(opt, "TURN_US"))
+            {
+                turn_us = (U32)atoi(value);
+            }
+            else if (!_stricmp(opt, "SWEEP_MS"))
+            {
+                sweep_ms = (U32)atoi(value);
+            }
+            else if (!_stricmp(opt, "POIN"))
+            {
+                preset_points = atoi(value);
+            }
+            else if (!_stricmp(opt, "STAR"))
+            {
+                preset_start_Hz = atof(value);
+            }
+            else if (!_stricmp(opt, "STOP"))
+            {
+                preset_stop_Hz = atof(value);
+            }
+            else if (!_stricmp(opt, "CORR"))
+            {
+                preset_correction = (atoi(value) != 0);
+            }
+            else if (!_stricmp(opt, "SWEEP"))
+            {
+                preset_lin_sweep = (_stricmp(value, "LOG") != 0);
+            }
+            else
+            {
+                S32 sparam;
+                for (sparam = 0; sparam < 4; sparam++)
+                {
+                    if (!_stricmp(opt, sim_sparam_names[sparam]))
+                    {
+                        break;
+                    }
+                }
+                if ((sparam == 4) || (!load_trace(sparam, value)))
+                {
+                    qDebug("vna_sim_8753::open() Error invalid option %s=%s", opt, value);
+                    return VNA_ERROR_RSRC_NFOUND;
+                }
+            }
+        }
+        opt = next;
+    }
+
+    // A recorded trace sets the number of points
+    for (S32 sparam = 0; sparam < 4; sparam++)
+    {
+        if (recorded_points[sparam] > 0)
+        {
+            preset_points = recorded_points[sparam];
+            break;
+        }
+    }
+
+    preset();
+    replies.clear();
+    reply_pos = 0;
+    pending_delay_ns = 0;
+    is_open = TRUE;
+    qDebug("vna_sim_8753::open(%s) byte_ns=%u turn_us=%u sweep_ms=%u points=%d", resource, byte_ns, turn_us, sweep_ms, nb_points);
+    return VNA_SUCCESS;
+}
+
+void vna_sim_8753::close(void)
+{
+    replies.clear();
+    reply_pos = 0;
+    is_open = FALSE;
+}
+
+VNA_STATUS vna_sim_8753::clear(void)
+{
+    if (!is_open)
+    {
+        return VNA_ERROR_IO;
+    }
+    replies.clear();
+    reply_pos = 0;
+    scanf_discard();
+    return VNA_SUCCESS;
+}
+
+VNA_STATUS vna_sim_8753::read_stb(U16 *stb)
+{
+    if (!is_open)
+    {
+        return VNA_ERROR_IO;
+    }
+    *stb = replies.empty() ? 0x00 : 0x10; // MAV (message available)
+    return VNA_SUCCESS;
+}
+
+VNA_STATUS vna_sim_8753::write(const U8 *buf, U32 cnt, U32 *ret_count)
+{
+    *ret_count = 0;
+    if (!is_open)
+    {
+        return VNA_ERROR_IO;
+    }
+
+    // A new command discards the unread output (like the 8753 does)
+    replies.clear();
+    reply_pos = 0;
+
+    turnaround_delay();
+    bus_delay(cnt);
+
+    // Commands are separated by ';' or LF, END of message terminates the last one
+    C8 cmd[256];
+    S32 len = 0;
+    for (U32 i = 0; i <= cnt; i++)
+    {
+        C8 c = (i < cnt) ? (C8)buf[i] : ';';
+        if ((c == ';') || (c == '\n'))
+        {
+            cmd[len] = 0;
+            execute(cmd);
+            len = 0;
+        }
+        else if (len < (S32)sizeof(cmd) - 1)
+        {
+            cmd[len++] = c;
+        }
+    }
+
+    *ret_count = cnt;
+    return VNA_SUCCESS;
+}
+
+VNA_STATUS vna_sim_8753::read(U8 *buf, U32 cnt, U32 *ret_count)
+{
+    *ret_count = 0;
+    if (!is_open)
+    {
+        return VNA_ERROR_IO;
+    }
+    if (replies.empty())
+    {
+        return VNA_ERROR_TMO; // Nothing to read (query missing), do not wait timeout_ms
+    }
+
+    // Wait end of the sweep then the bytes transfer time
+    if (pending_delay_ns > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(pending_delay_ns));
+        pending_delay_ns = 0;
+    }
+
+    if (reply_pos == 0)
+    {
+        turnaround_delay(); // Start of a reply message
+    }
+
+    std::string &msg = replies.front();
+    U32 n = (U32)min((size_t)cnt, msg.size() - reply_pos);
+    memcpy(buf, msg.data() + reply_pos, n);
+    reply_pos += n;
+    *ret_count = n;
+    bus_delay(n);
+
+    if (reply_pos < msg.size())
+    {
+        return VNA_SUCCESS_MAX_CNT;
+    }
+    replies.pop_front();
+    reply_pos = 0;
+    return VNA_SUCCESS;
+}
+
+void vna_sim_8753::preset(void)
+{
+    set_points(preset_points);
+    start_Hz = preset_start_Hz;
+    stop_Hz = preset_stop_Hz;
+    lin_sweep = preset_lin_sweep;
+    form = 4;
+    active_sparam = 0;
+    active_func = ACTIVE_FUNC_STAR;
+    if_bandwidth_Hz = 3000.0;
+    power_dBm = 0.0;
+    smoothing = FALSE;
+    averaging = FALSE;
+    correction = preset_correction;
+}
+
+/*
+Load a recorded trace, FORM4 ASCII "real, imag" per line (capture_FORM4_raw() output)
+Parameters:
+S32 sparam => 0=S11, 1=S21, 2=S12, 3=S22
+const C8 *filename => FORM4 file
+*/
+bool vna_sim_8753::load_trace(S32 sparam, const C8 *filename)
+{
+    FILE *in = fopen(filename, "rb");
+    if (in == NULL)
+    {
+        qDebug("vna_sim_8753::load_trace() Error cannot open %s", filename);
+        return FALSE;
+    }
+
+    S32 size = VNA_SIM_MAX_POINTS * FORM4_BYTES_PER_POINT * 2;
+    C8 *text = (C8 *)malloc(size);
+    if (text == NULL)
+    {
+        fclose(in);
+        return FALSE;
+    }
+    S32 len = (S32)fread(text, 1, size, in);
+    fclose(in);
+
+    S32 n = 0;
+    const C8 *src = text;
+    const C8 *end = text + len;
+    while (n < VNA_SIM_MAX_POINTS)
+    {
+        DOUBLE real;
+        DOUBLE imag;
+
+        src = parse_ascii_double(src, end, &real);
+        if (src == nullptr)
+        {
+            break;
+        }
+        src = parse_ascii_double(src, end, &imag);
+        if (src == nullptr)
+        {
+            break;
+        }
+        recorded_buf[sparam][n].real = real;
+        recorded_buf[sparam][n].imag = imag;
+        n++;
+    }
+    free(text);
+
+    recorded_points[sparam] = n;
+    qDebug("vna_sim_8753::load_trace(%s) %s %d points", sim_sparam_names[sparam], filename, n);
+    return (n > 0);
+}
+
+// Round up to the next POIN value allowed by the 8753D
+void vna_sim_8753::set_points(DOUBLE value)
+{
+    S32 i;
+
+    for (i = 0; i < (S32)(ARY_CNT(sim_points_list)) - 1; i++)
+    {
+        if (value <= sim_points_list[i])
+        {
+            break;
+        }
+    }
+    nb_points = sim_points_list[i];
+}
+
+DOUBLE vna_sim_8753::active_value(ACTIVE_FUNC func)
+{
+    switch (func)
+    {
+    case ACTIVE_FUNC_STAR:
+        return start_Hz;
+    case ACTIVE_FUNC_STOP:
+        return stop_Hz;
+    case ACTIVE_FUNC_CENT:
+        return (start_Hz + stop_Hz) / 2.0;
+    case ACTIVE_FUNC_SPAN:
+        return (stop_Hz - start_Hz);
+    default:
+        return (DOUBLE)nb_points;
+    }
+}
+
+DOUBLE vna_sim_8753::stimulus_Hz(S32 point)
+{
+    if (nb_points < 2)
+    {
+        return start_Hz;
+    }
+    if (lin_sweep)
+    {
+        return start_Hz + (((stop_Hz - start_Hz) * point) / (nb_points - 1));
+    }
+    return start_Hz * pow(stop_Hz / start_Hz, (DOUBLE)point / (nb_points - 1));
+}
+
+/*
+Synthetic traces:
+S11 = 0.2 * e^(-j2pi.f.T) (mismatched delay line)
+S21 = S12 = 0.9 / (1 + jf/1GHz) * e^(-j2pi.f.T) (low pass)
+S22 = 0.1 * e^(-j2pi.f.2T)
+*/
+COMPLEX_DOUBLE vna_sim_8753::trace_value(S32 sparam, S32 point)
+{
+    if (recorded_points[sparam] > 0)
+    {
+        return (point < recorded_points[sparam]) ? recorded_buf[sparam][point] : COMPLEX_DOUBLE(0.0, 0.0);
+    }
+
+    DOUBLE f = stimulus_Hz(point);
+    DOUBLE phi = -2.0 * PI * f * SIM_DELAY_NS;
+
+    switch (sparam)
+    {
+    case 0:
+        return COMPLEX_DOUBLE(0.2 * cos(phi), 0.2 * sin(phi));
+    case 3:
+        return COMPLEX_DOUBLE(0.1 * cos(2.0 * phi), 0.1 * sin(2.0 * phi));
+    default:
+        return COMPLEX_DOUBLE(0.9 * cos(phi), 0.9 * sin(phi)) / COMPLEX_DOUBLE(1.0, f / SIM_LOWPASS_HZ);
+    }
+}
+
+void vna_sim_8753::reply(const C8 *fmt, ...)
+{
+    C8 text[256];
+    va_list args;
+
+    va_start(args, fmt);
+    S32 len = _vsnprintf(text, sizeof(text) - 1, fmt, args);
+    va_end(args);
+    if (len > 0)
+    {
+        replies.push_back(std::string(text, len));
+    }
+}
+
+/*
+Trace data in the current FORM
+FORM1 => "#A" + 2 bytes length (big endian) + 6 bytes per point (imag, real S16 mantissas, unused, S8 exponent)
+FORM4 => "real, imag\n" ASCII 50 bytes per point
+FORM5 => "#A" + 2 bytes length (little endian) + 2 x float32 (little endian) per point
+*/
+void vna_sim_8753::reply_trace(S32 sparam)
+{
+    std::string msg;
+
+    if (form == 1)
+    {
+        U32 len = nb_points * FORM1_BYTES_PER_POINT;
+        msg.reserve(4 + len);
+        msg.append("#A");
+        msg.push_back((C8)(len >> 8));
+        msg.push_back((C8)(len & 0xFF));
+        for (S32 i = 0; i < nb_points; i++)
+        {
+            COMPLEX_DOUBLE v = trace_value(sparam, i);
+            DOUBLE m = max(fabs(v.real), fabs(v.imag));
+            S32 e = 0;
+            S32 real_raw = 0;
+            S32 imag_raw = 0;
+
+            if (m > 0.0)
+            {
+                frexp(m, &e); // m = [0.5, 1[ * 2^e => mantissa = v * 2^(15 - e)
+                e = max(-128, min(127, e));
+                real_raw = (S32)floor(ldexp(v.real, 15 - e) + 0.5);
+                imag_raw = (S32)floor(ldexp(v.imag, 15 - e) + 0.5);
+                if ((max(abs(real_raw), abs(imag_raw)) > 32767) && (e < 127))
+                {
+                    e++;
+                    real_raw = (S32)floor(ldexp(v.real, 15 - e) + 0.5);
+                    imag_raw = (S32)floor(ldexp(v.imag, 15 - e) + 0.5);
+                }
+                real_raw = max(-32768, min(32767, real_raw));
+                imag_raw = max(-32768, min(32767, imag_raw));
+            }
+            msg.push_back((C8)((imag_raw >> 8) & 0xFF));
+            msg.push_back((C8)(imag_raw & 0xFF));
+            msg.push_back((C8)((real_raw >> 8) & 0xFF));
+            msg.push_back((C8)(real_raw & 0xFF));
+            msg.push_back(0);
+            msg.push_back((C8)(S8)e);
+        }
+    }
+    else if (form == 5)
+    {
+        U32 len = nb_points * 2 * sizeof(F32);
+        msg.reserve(4 + len);
+        msg.append("#A");
+        msg.push_back((C8)(len & 0xFF));
+        msg.push_back((C8)(len >> 8));
+        for (S32 i = 0; i < nb_points; i++)
+        {
+            COMPLEX_DOUBLE v = trace_value(sparam, i);
+            F32 ri[2] = { (F32)v.real, (F32)v.imag };
+
+            for (S32 k = 0; k < 2; k++)
+            {
+                U32 bits;
+                memcpy(&bits, &ri[k], sizeof(bits));
+                msg.push_back((C8)(bits & 0xFF));
+                msg.push_back((C8)((bits >> 8) & 0xFF));
+                msg.push_back((C8)((bits >> 16) & 0xFF));
+                msg.push_back((C8)(bits >> 24));
+            }
+        }
+    }
+    else
+    {
+        C8 line[FORM4_BYTES_PER_POINT + 1];
+
+        msg.reserve(nb_points * FORM4_BYTES_PER_POINT);
+        for (S32 i = 0; i < nb_points; i++)
+        {
+            COMPLEX_DOUBLE v = trace_value(sparam, i);
+            S32 len = _snprintf(line, sizeof(line), "%24.15E,%24.15E\n", v.real, v.imag);
+            msg.append(line, len);
+        }
+    }
+    replies.push_back(msg);
+}
+
+// OUTPLIML => stimulus, limit test result (-1 = no test), upper limit, lower limit for each point
+void vna_sim_8753::reply_limit_lines(void)
+{
+    std::string msg;
+    C8 line[128];
+
+    for (S32 i = 0; i < nb_points; i++)
+    {
+        S32 len = _snprintf(line, sizeof(line) - 1, "%24.15E,%24.15E,%24.15E,%24.15E\n", stimulus_Hz(i), -1.0, 0.0, 0.0);
+        msg.append(line, len);
+    }
+    replies.push_back(msg);
+}
+
+void vna_sim_8753::execute(C8 *cmd)
+{
+    C8 mnemonic[32];
+    S32 len = 0;
+
+    while ((*cmd == ' ') || (*cmd == '\t') || (*cmd == '\r'))
+    {
+        cmd++;
+    }
+    while ((isalnum((U8)*cmd) || (*cmd == '?')) && (len < (S32)sizeof(mnemonic) - 1))
+    {
+        mnemonic[len++] = (C8)toupper((U8)*cmd++);
+    }
+    mnemonic[len] = 0;
+    if (len == 0)
+    {
+        return;
+    }
+
+    // Optional numeric argument with unit suffix ("STAR 1.5 GHZ", "POIN 401")
+    DOUBLE value = 0.0;
+    const C8 *arg_end = parse_ascii_double(cmd, cmd + strlen(cmd), &value);
+    bool has_value = (arg_end != nullptr);
+    if (has_value)
+    {
+        while (*arg_end == ' ')
+        {
+            arg_end++;
+        }
+        if (!_strnicmp(arg_end, "GHZ", 3)) value *= 1e9;
+        else if (!_strnicmp(arg_end, "MHZ", 3)) value *= 1e6;
+        else if (!_strnicmp(arg_end, "KHZ", 3)) value *= 1e3;
+    }
+    bool query = (mnemonic[len - 1] == '?');
+    if (query)
+    {
+        mnemonic[len - 1] = 0;
+    }
+
+    static const C8 active_names[5][5] = { "STAR", "STOP", "CENT", "SPAN", "POIN" };
+    for (S32 i = 0; i < 5; i++)
+    {
+        if (strcmp(mnemonic, active_names[i]))
+        {
+            continue;
+        }
+        if (query)
+        {
+            reply("%+.14E\n", active_value((ACTIVE_FUNC)i));
+            return;
+        }
+        active_func = (ACTIVE_FUNC)i;
+        if (has_value)
+        {
+            DOUBLE center = (start_Hz + stop_Hz) / 2.0;
+            DOUBLE span = (stop_Hz - start_Hz);
+            switch (active_func)
+            {
+            case ACTIVE_FUNC_STAR:
+                start_Hz = value;
+                stop_Hz = max(stop_Hz, start_Hz);
+                break;
+            case ACTIVE_FUNC_STOP:
+                stop_Hz = value;
+                start_Hz = min(start_Hz, stop_Hz);
+                break;
+            case ACTIVE_FUNC_CENT:
+                start_Hz = value - span / 2.0;
+                stop_Hz = value + span / 2.0;
+                break;
+            case ACTIVE_FUNC_SPAN:
+                start_Hz = center - value / 2.0;
+                stop_Hz = center + value / 2.0;
+                break;
+            default:
+                set_points(value);
+                break;
+            }
+        }
+        return;
+    }
+
+    for (S32 i = 0; i < 4; i++)
+    {
+        if (!strcmp(mnemonic, sim_sparam_names[i]))
+        {
+            if (query)
+            {
+                reply("%d\n", (active_sparam == i) ? 1 : 0);
+            }
+            else
+            {
+                active_sparam = i;
+            }
+            return;
+        }
+    }
+
+    if (!strcmp(mnemonic, "OUTPIDEN"))
+    {
+        reply("HEWLETT PACKARD,8753D,0,6.14\n");
+    }
+    else if (!strcmp(mnemonic, "OUTPOPTS"))
+    {
+        reply("002 006 010\n");
+    }
+    else if (!strcmp(mnemonic, "OUTPACTI"))
+    {
+        reply("%+.14E\n", active_value(active_func));
+    }
+    else if (!strcmp(mnemonic, "IFBW"))
+    {
+        if (query)
+        {
+            reply("%+.14E\n", if_bandwidth_Hz);
+        }
+        else if (has_value)
+        {
+            if_bandwidth_Hz = value;
+        }
+    }
+    else if (!strcmp(mnemonic, "POWE"))
+    {
+        if (query)
+        {
+            reply("%+.14E\n", power_dBm);
+        }
+        else if (has_value)
+        {
+            power_dBm = value;
+        }
+    }
+    else if (!strcmp(mnemonic, "SMOOO") && query)
+    {
+        reply("%d\n", smoothing ? 1 : 0);
+    }
+    else if (!strcmp(mnemonic, "AVERO") && query)
+    {
+        reply("%d\n", averaging ? 1 : 0);
+    }
+    else if (!strcmp(mnemonic, "CORR") && query)
+    {
+        reply("%d\n", correction ? 1 : 0);
+    }
+    else if (!strcmp(mnemonic, "SMOOOON") || !strcmp(mnemonic, "SMOOOOFF"))
+    {
+        smoothing = (mnemonic[5] == 'O') && (mnemonic[6] == 'N');
+    }
+    else if (!strcmp(mnemonic, "AVEROON") || !strcmp(mnemonic, "AVEROOFF"))
+    {
+        averaging = (mnemonic[5] == 'O') && (mnemonic[6] == 'N');
+    }
+    else if (!strcmp(mnemonic, "CORRON") || !strcmp(mnemonic, "CORROFF"))
+    {
+        correction = (mnemonic[5] == 'N');
+    }
+    else if (!strcmp(mnemonic, "LINFREQ"))
+    {
+        if (query)
+        {
+            reply("%d\n", lin_sweep ? 1 : 0);
+        }
+        else
+        {
+            lin_sweep = TRUE;
+        }
+    }
+    else if (!strcmp(mnemonic, "LOGFREQ"))
+    {
+        lin_sweep = FALSE;
+    }
+    else if (!strcmp(mnemonic, "FORM1") || !strcmp(mnemonic, "FORM4") || !strcmp(mnemonic, "FORM5"))
+    {
+        form = mnemonic[4] - '0';
+    }
+    else if (!strcmp(mnemonic, "OUTPDATA") || !strcmp(mnemonic, "OUTPFORM") || !strcmp(mnemonic, "OUTPFORF"))
+    {
+        reply_trace(active_sparam); // Display format (log mag ...) is not simulated, always real/imag
+    }
+    else if (!strncmp(mnemonic, "OUTPRAW", 7) && (mnemonic[7] >= '1') && (mnemonic[7] <= '4') && (mnemonic[8] == 0))
+    {
+        reply_trace(mnemonic[7] - '1'); // Raw arrays 1..4 => S11, S21, S12, S22
+    }
+    else if (!strcmp(mnemonic, "OUTPLIML"))
+    {
+        reply_limit_lines();
+    }
+    else if (!strcmp(mnemonic, "OPC") && query)
+    {
+        reply("1\n"); // Sent when the next command (SING, PRES, WAIT ...) completes
+    }
+    else if (!strcmp(mnemonic, "SING"))
+    {
+        pending_delay_ns += (U64)sweep_ms * 1000000;
+    }
+    else if (!strcmp(mnemonic, "PRES"))
+    {
+        preset();
+    }
+    else if (!strcmp(mnemonic, "HOLD") || !strcmp(mnemonic, "CONT") || !strcmp(mnemonic, "WAIT") ||
+             !strcmp(mnemonic, "CLES") || !strcmp(mnemonic, "SRE") || !strcmp(mnemonic, "ESNB") ||
+             !strcmp(mnemonic, "DEBUON") || !strcmp(mnemonic, "DEBUOFF"))
+    {
+        // Accepted, nothing to simulate
+    }
+    else
+    {
+        qDebug("vna_sim_8753 unsupported command \"%s%s\" ignored", mnemonic, query ? "?" : "");
+    }
+}
+
+// GPIB transfer time model
+void vna_sim_8753::bus_delay(U32 nb_bytes)
+{
+    if (byte_ns > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds((U64)nb_bytes * byte_ns));
+    }
+}
+
+// GPIB message turnaround model (talker/listener addressing, interface driver call)
+void vna_sim_8753::turnaround_delay(void)
+{
+    if (turn_us > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(turn_us));
+    }
+}
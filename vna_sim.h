@@ -0,0 +1,108 @@
+#ifndef VNA_SIM_H
+#define VNA_SIM_H
+
+#include <deque>
+#include <string>
+
+#include "vna_transport.h"
+
+#define VNA_SIM_MAX_POINTS (1601) // 8753D max number of points
+
+/*
+Simulated HP8753 (no VISA/GPIB hardware needed, used for offline test and benchmark)
+Resource string "SIM::8753[::OPTION=value]..." options:
+- BYTE_NS=<ns> => GPIB latency per byte written/read (Default 0, ~1000 for a 82357B)
+- TURN_US=<us> => GPIB turnaround per message written/read (addressing, driver call) (Default 0, ~2000 for a 82357B)
+- SWEEP_MS=<ms> => Single sweep time (SING) (Default 0)
+- POIN=<n>, STAR=<Hz>, STOP=<Hz> => Preset stimulus (Default 201 points 30 kHz to 6 GHz)
+- CORR=<0|1> => Preset correction OFF/ON (Default 0), CORR=1 models a full two-port calibration
+- SWEEP=<LIN|LOG> => Preset sweep type (Default LIN), LOG models a non-linear sweep (frequencies read with OUTPLIML)
+- S11=<file>, S21=<file>, S12=<file>, S22=<file> => Recorded trace (FORM4 ASCII "real, imag" per line
+  as saved by capture_FORM4_raw()), POIN is set to the number of points of the first file loaded
+Synthetic traces (delay line/low pass) are used for the S-parameters without recorded trace.
+
+Supported commands (subset of 08753-90256 used by acquisition):
+OUTPIDEN, OUTPOPTS, IFBW, POWE, SMOOO, AVERO, CORR, LINFREQ, LOGFREQ, S11/S21/S12/S22,
+STAR/STOP/CENT/SPAN/POIN (with value, '?' or as active function for OUTPACTI), OUTPACTI, OUTPLIML,
+FORM1/FORM4/FORM5, OUTPDATA/OUTPFORM/OUTPFORF, OUTPRAW1..4, OPC?, PRES, SING, HOLD, CONT ...
+Other commands are accepted and ignored (logged with qDebug).
+*/
+class vna_sim_8753 : public vna_transport
+{
+public:
+    vna_sim_8753();
+    ~vna_sim_8753() {}
+
+    static bool is_sim_resource(const C8 *resource);
+
+    VNA_STATUS open(const C8 *resource, U32 timeout_ms);
+    void close(void);
+
+    VNA_STATUS set_timeout(U32 timeout_ms) { this->timeout_ms = timeout_ms; return VNA_SUCCESS; }
+    VNA_STATUS clear(void);
+    VNA_STATUS read_stb(U16 *stb);
+
+    VNA_STATUS write(const U8 *buf, U32 cnt, U32 *ret_count);
+    VNA_STATUS read(U8 *buf, U32 cnt, U32 *ret_count);
+
+private:
+    enum ACTIVE_FUNC
+    {
+        ACTIVE_FUNC_STAR = 0,
+        ACTIVE_FUNC_STOP,
+        ACTIVE_FUNC_CENT,
+        ACTIVE_FUNC_SPAN,
+        ACTIVE_FUNC_POIN
+    };
+
+    void preset(void);
+    bool load_trace(S32 sparam, const C8 *filename);
+    void execute(C8 *cmd);
+    void set_points(DOUBLE value);
+    DOUBLE active_value(ACTIVE_FUNC func);
+
+    DOUBLE stimulus_Hz(S32 point);
+    COMPLEX_DOUBLE trace_value(S32 sparam, S32 point);
+
+    void reply(const C8 *fmt, ...);
+    void reply_trace(S32 sparam);
+    void reply_limit_lines(void);
+
+    void bus_delay(U32 nb_bytes);
+    void turnaround_delay(void);
+
+    bool is_open;
+    U32 timeout_ms;
+    U32 byte_ns; // Per byte latency
+    U32 turn_us; // Per message latency
+    U32 sweep_ms; // SING duration
+    U64 pending_delay_ns; // Sweep time not yet "waited" (applied on next read)
+
+    std::deque<std::string> replies; // Output queue, one entry per message (END on last byte)
+    size_t reply_pos; // Bytes already read from replies.front()
+
+    // Instrument state
+    S32 preset_points;
+    DOUBLE preset_start_Hz;
+    DOUBLE preset_stop_Hz;
+    bool preset_correction;
+    bool preset_lin_sweep;
+    S32 nb_points;
+    DOUBLE start_Hz;
+    DOUBLE stop_Hz;
+    bool lin_sweep;
+    S32 form; // 1, 4 or 5
+    S32 active_sparam; // 0=S11, 1=S21, 2=S12, 3=S22
+    ACTIVE_FUNC active_func;
+    DOUBLE if_bandwidth_Hz;
+    DOUBLE power_dBm;
+    bool smoothing;
+    bool averaging;
+    bool correction;
+
+    // Recorded traces (recorded_points = 0 => synthetic)
+    S32 recorded_points[4];
+    COMPLEX_DOUBLE recorded_buf[4][VNA_SIM_MAX_POINTS];
+};
+
+#endif // VNA_SIM_H
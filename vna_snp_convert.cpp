@@ -0,0 +1,539 @@
+/*
+vna_snp_convert: headless batch Touchstone (.S1P/.S2P) converter
+(no VISA and no display, see vna_snp_convert.pro)
+
+All the .S1P/.S2P files of an input directory tree are converted to the output directory
+(same relative path and name) with the selected data format, frequency unit and precision,
+optionally resampled on a new frequency grid.
+Files are read/converted/written in parallel by worker threads fed by a bounded work queue.
+The sweeps of a sweep archive (.snpa, see SWEEP_ARCHIVE) are exported to one file per sweep.
+*/
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "typedefs.h"
+
+#include "spline.cpp"
+#include "sparams.cpp"
+#include "sweep_archive.cpp"
+
+typedef struct convert_cfg
+{
+    const C8 *data_format; // "MA" (Default), "DB" or "RI"
+    const C8 *freq_format; // "HZ", "KHZ", "MHZ" or "GHZ" (Default)
+    S32 digits; // 0 = "%lf" (Default) else significant digits (see SPARAM::print_double())
+    U8 conversion_mode; // SPARAM::CONV_EXACT (Default) or SPARAM::CONV_FAST
+    bool resample; // Resample on start_Hz/stop_Hz/n_points grid (points outside the file range are dropped)
+    bool spline; // Resampling with SPARAM::RESAMPLE_SPLINE (Default) else SPARAM::RESAMPLE_LINEAR
+    DOUBLE start_Hz;
+    DOUBLE stop_Hz;
+    S32 n_points;
+    U64 first_sweep; // Sweep archive: sweeps exported (Default all)
+    U64 last_sweep;
+} t_convert_cfg;
+
+typedef struct convert_job
+{
+    std::string src; // Input file
+    std::string dst; // Output file
+    std::string name; // Relative path (reports)
+    S32 n_ports; // 1 = S1P or 2 = S2P
+} t_convert_job;
+
+/*
+SPARAMS keeping the last error message (the default sink prints all the messages from any thread)
+*/
+struct sparams_quiet : SPARAMS
+{
+    C8 error[512];
+
+    sparams_quiet()
+    {
+        error[0] = 0;
+    }
+
+    virtual void message_sink(SPARAM::MSGLVL level, C8 *text)
+    {
+        if (level >= SPARAM::MSG_ERROR)
+        {
+            _snprintf(error, sizeof(error) - 1, "%s", text);
+            error[sizeof(error) - 1] = 0;
+        }
+    }
+};
+
+// Sweep archive errors printed by the caller (message_text)
+struct sweep_archive_quiet : SWEEP_ARCHIVE
+{
+    virtual void message_sink(SPARAM::MSGLVL level, C8 *text)
+    {
+        Q_UNUSED(level);
+        Q_UNUSED(text);
+    }
+};
+
+/*
+Bounded work queue: push() blocks while the queue is full so the directory scan never runs
+far ahead of the workers, pop() blocks until a job is available or close() is called
+*/
+class convert_queue
+{
+public:
+    explicit convert_queue(size_t max_jobs) :
+        max_jobs(max_jobs),
+        closed(FALSE)
+    {
+    }
+
+    void push(const t_convert_job &job)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        not_full.wait(guard, [this]() { return jobs.size() < max_jobs; });
+        jobs.push_back(job);
+        not_empty.notify_one();
+    }
+
+    bool pop(t_convert_job *job)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        not_empty.wait(guard, [this]() { return closed || !jobs.empty(); });
+        if (jobs.empty())
+        {
+            return FALSE; // closed
+        }
+        *job = jobs.front();
+        jobs.pop_front();
+        not_full.notify_one();
+        return TRUE;
+    }
+
+    void close(void)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = TRUE;
+        not_empty.notify_all();
+    }
+
+private:
+    size_t max_jobs;
+    bool closed;
+    std::deque<t_convert_job> jobs;
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
+
+/*
+Resample src on the cfg grid (real and imaginary parts interpolated independently)
+Parameters:
+sparams_quiet *src => Source data (read_SNP_file())
+const t_convert_cfg *cfg => Grid
+sparams_quiet *dest => Resampled data (RI)
+*/
+static bool resample(sparams_quiet *src, const t_convert_cfg *cfg, sparams_quiet *dest)
+{
+    S32 n_src = src->n_points;
+    S32 n_ports = src->n_ports;
+
+    if (n_src < 2)
+    {
+        _snprintf(dest->error, sizeof(dest->error) - 1, "Not enough points to resample (%d)", n_src);
+        return FALSE;
+    }
+
+    //
+    // Grid points inside the file frequency range
+    //
+    std::vector<DOUBLE> grid_Hz;
+    DOUBLE step_Hz = (cfg->n_points > 1) ? ((cfg->stop_Hz - cfg->start_Hz) / (cfg->n_points - 1)) : 0.0;
+    for (S32 i = 0; i < cfg->n_points; i++)
+    {
+        DOUBLE Hz = cfg->start_Hz + step_Hz * i;
+        if ((Hz >= src->freq_Hz[0]) && (Hz <= src->freq_Hz[n_src - 1]))
+        {
+            grid_Hz.push_back(Hz);
+        }
+    }
+
+    S32 n_dest = (S32)grid_Hz.size();
+    if (n_dest == 0)
+    {
+        _snprintf(dest->error, sizeof(dest->error) - 1, "Grid outside the file frequency range");
+        return FALSE;
+    }
+
+    if (!dest->alloc(n_ports, n_dest, SNPTYPE::RI))
+    {
+        return FALSE;
+    }
+    memcpy(dest->freq_Hz, &grid_Hz[0], n_dest * sizeof(DOUBLE));
+    dest->min_Hz = grid_Hz[0];
+    dest->max_Hz = grid_Hz[n_dest - 1];
+    dest->Zo = src->Zo;
+
+    //
+    // All the parameters resampled at once (SPARAMS::resample(), values interleaved per point)
+    //
+    S32 n_params = n_ports * n_ports;
+    std::vector<SPARAM::RI> values((size_t)n_dest * n_params, SPARAM::RI(0.0, 0.0));
+
+    src->conversion_mode = cfg->conversion_mode;
+    if (!src->resample(&grid_Hz[0], n_dest, &values[0], NULL, NULL, 0,
+                       cfg->spline ? SPARAM::RESAMPLE_SPLINE : SPARAM::RESAMPLE_LINEAR))
+    {
+        return FALSE;
+    }
+
+    for (S32 b = 0; b < n_ports; b++)
+    {
+        for (S32 a = 0; a < n_ports; a++)
+        {
+            for (S32 i = 0; i < n_dest; i++)
+            {
+                dest->RI[b][a][i] = values[(size_t)i * n_params + a * n_ports + b];
+            }
+            memset(dest->valid[b][a], SNPTYPE::RI, n_dest);
+        }
+    }
+
+    return TRUE;
+}
+
+static bool convert_file(const t_convert_job *job, const t_convert_cfg *cfg, C8 *error, S32 error_size)
+{
+    sparams_quiet S;
+    sparams_quiet R;
+    sparams_quiet *out = &S;
+    C8 header[512];
+    bool result;
+
+    result = S.read_SNP_file(job->src.c_str(), job->n_ports);
+    if (result && cfg->resample)
+    {
+        result = resample(&S, cfg, &R);
+        out = &R;
+    }
+
+    if (result)
+    {
+        QDir().mkpath(QFileInfo(QString::fromLocal8Bit(job->dst.c_str())).path());
+
+        _snprintf(header, sizeof(header) - 1, "! Converted by vna_snp_convert from %s", job->name.c_str());
+        header[sizeof(header) - 1] = 0;
+        out->conversion_mode = cfg->conversion_mode;
+        out->text_digits = cfg->digits;
+        result = out->write_SNP_file(job->dst.c_str(), cfg->data_format, cfg->freq_format, header);
+    }
+
+    if (!result)
+    {
+        _snprintf(error, error_size - 1, "%s", (R.error[0] != 0) ? R.error : S.error);
+        error[error_size - 1] = 0;
+    }
+
+    return result;
+}
+
+/*
+Export the sweeps of a sweep archive, "<out_dir>/<archive name>_<sweep>.S1P/.S2P" (optionally resampled)
+Return the number of failed sweeps (-1 if the archive can't be read)
+*/
+static S32 export_archive(const C8 *archive_name, const C8 *out_dir, const t_convert_cfg *cfg, S32 *n_ok, U64 *out_bytes)
+{
+    sweep_archive_quiet A;
+    sparams_quiet S;
+    sparams_quiet R;
+    S32 n_failed = 0;
+    C8 header[2048];
+
+    if (!A.open(archive_name))
+    {
+        printf("Error %s\n", A.message_text);
+        return -1;
+    }
+
+    QDir().mkpath(QString::fromLocal8Bit(out_dir));
+    QString base = QDir(QString::fromLocal8Bit(out_dir)).absoluteFilePath(QFileInfo(QString::fromLocal8Bit(archive_name)).completeBaseName());
+    std::string base_name = base.toLocal8Bit().constData();
+    const C8 *ext = (A.H.n_ports == 1) ? ".S1P" : ".S2P";
+
+    for (U64 i = 0; i < A.n_frames(); i++)
+    {
+        U64 sweep = A.frames[i].sweep;
+        if ((sweep < cfg->first_sweep) || (sweep > cfg->last_sweep))
+        {
+            continue;
+        }
+
+        C8 filename[MAX_PATH * 2];
+        sparams_quiet *out = &S;
+
+        // S and R are reused for every sweep: no error text of a previous sweep
+        S.error[0] = 0;
+        R.error[0] = 0;
+
+        bool result = A.read_frame(i, &S);
+
+        if (result && cfg->resample)
+        {
+            result = resample(&S, cfg, &R);
+            out = &R;
+        }
+        if (result)
+        {
+            _snprintf(filename, sizeof(filename) - 1, "%s_%06llu%s", base_name.c_str(), (unsigned long long)sweep, ext);
+            filename[sizeof(filename) - 1] = 0;
+            A.frame_header(i, header, sizeof(header));
+            out->conversion_mode = cfg->conversion_mode;
+            out->text_digits = cfg->digits;
+            result = out->write_SNP_file(filename, cfg->data_format, cfg->freq_format, header);
+        }
+
+        if (result)
+        {
+            (*n_ok)++;
+            *out_bytes += (U64)QFileInfo(QString::fromLocal8Bit(filename)).size();
+        }
+        else
+        {
+            n_failed++;
+            printf("Error sweep %llu: %s\n", (unsigned long long)sweep,
+                   (R.error[0] != 0) ? R.error : ((S.error[0] != 0) ? S.error : A.message_text));
+        }
+    }
+
+    return n_failed;
+}
+
+static void usage(void)
+{
+    printf("Usage: vna_snp_convert [options] <input directory> <output directory>\n"
+           "       vna_snp_convert [options] <sweep archive.snpa> <output directory>\n"
+           "Convert all the .S1P/.S2P files of the input directory tree (output: same relative path and name)\n"
+           "or export the sweeps of a sweep archive (output: <archive name>_<sweep>.S1P/.S2P)\n"
+           "Options:\n"
+           "  -format MA|DB|RI       Data format (default MA)\n"
+           "  -freq HZ|KHZ|MHZ|GHZ   Frequency unit (default GHZ)\n"
+           "  -digits N              Significant digits 1 to 17 (default 0 = \"%%lf\" 6 decimals)\n"
+           "  -fast                  Fast format conversion (see SPARAM::CONV_FAST, default exact)\n"
+           "  -resample start_Hz stop_Hz points\n"
+           "                         Resample on a linear grid (points outside the file range are dropped)\n"
+           "  -linear                Linear resampling (default spline)\n"
+           "  -threads N             Worker threads (default number of cores)\n"
+           "  -queue N               Work queue size (default 4 x threads)\n"
+           "  -sweeps first last     Sweep archive: sweeps exported (default all)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    t_convert_cfg cfg;
+    const C8 *in_dir = NULL;
+    const C8 *out_dir = NULL;
+    S32 n_threads = (S32)std::thread::hardware_concurrency();
+    S32 queue_size = 0;
+
+    cfg.data_format = "MA";
+    cfg.freq_format = "GHZ";
+    cfg.digits = 0;
+    cfg.conversion_mode = SPARAM::CONV_EXACT;
+    cfg.resample = FALSE;
+    cfg.spline = TRUE;
+    cfg.start_Hz = 0.0;
+    cfg.stop_Hz = 0.0;
+    cfg.n_points = 0;
+    cfg.first_sweep = 0;
+    cfg.last_sweep = ~0ULL;
+
+    for (S32 i = 1; i < argc; i++)
+    {
+        const C8 *arg = argv[i];
+        bool has_value = (i + 1 < argc);
+
+        if (!_stricmp(arg, "-format") && has_value)
+        {
+            cfg.data_format = argv[++i];
+        }
+        else if (!_stricmp(arg, "-freq") && has_value)
+        {
+            cfg.freq_format = argv[++i];
+        }
+        else if (!_stricmp(arg, "-digits") && has_value)
+        {
+            cfg.digits = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-fast"))
+        {
+            cfg.conversion_mode = SPARAM::CONV_FAST;
+        }
+        else if (!_stricmp(arg, "-resample") && (i + 3 < argc))
+        {
+            cfg.resample = TRUE;
+            cfg.start_Hz = atof(argv[++i]);
+            cfg.stop_Hz = atof(argv[++i]);
+            cfg.n_points = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-linear"))
+        {
+            cfg.spline = FALSE;
+        }
+        else if (!_stricmp(arg, "-threads") && has_value)
+        {
+            n_threads = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-queue") && has_value)
+        {
+            queue_size = atoi(argv[++i]);
+        }
+        else if (!_stricmp(arg, "-sweeps") && (i + 2 < argc))
+        {
+            cfg.first_sweep = strtoull(argv[++i], NULL, 10);
+            cfg.last_sweep = strtoull(argv[++i], NULL, 10);
+        }
+        else if ((arg[0] != '-') && (in_dir == NULL))
+        {
+            in_dir = arg;
+        }
+        else if ((arg[0] != '-') && (out_dir == NULL))
+        {
+            out_dir = arg;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if ((in_dir == NULL) || (out_dir == NULL) || (cfg.digits < 0) || (cfg.digits > SPARAM::TEXT_MAX_DIGITS) ||
+        (cfg.resample && ((cfg.n_points < 1) || (cfg.stop_Hz < cfg.start_Hz))))
+    {
+        usage();
+        return 1;
+    }
+    if (_stricmp(cfg.data_format, "MA") && _stricmp(cfg.data_format, "DB") && _stricmp(cfg.data_format, "RI"))
+    {
+        printf("Error unknown format %s\n", cfg.data_format);
+        return 1;
+    }
+    if (_stricmp(cfg.freq_format, "HZ") && _stricmp(cfg.freq_format, "KHZ") &&
+        _stricmp(cfg.freq_format, "MHZ") && _stricmp(cfg.freq_format, "GHZ"))
+    {
+        printf("Error unknown frequency unit %s\n", cfg.freq_format);
+        return 1;
+    }
+    n_threads = max(1, n_threads);
+    queue_size = (queue_size > 0) ? queue_size : (4 * n_threads);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QFileInfo in_info(QString::fromLocal8Bit(in_dir));
+    if (in_info.isFile() && (in_info.suffix().toLower() == "snpa"))
+    {
+        S32 n_ok = 0;
+        U64 out_bytes = 0;
+        S32 n_failed = export_archive(in_dir, out_dir, &cfg, &n_ok, &out_bytes);
+        if (n_failed < 0)
+        {
+            return 1;
+        }
+
+        DOUBLE elapsed_s = max(1E-6, timer.nsecsElapsed() / 1E9);
+        printf("%d sweeps exported, %d failed in %.3f s: %.1f sweeps/s, written %.1f MB/s\n",
+               n_ok, n_failed, elapsed_s, n_ok / elapsed_s, out_bytes / 1E6 / elapsed_s);
+        return (n_failed == 0) ? 0 : 2;
+    }
+
+    QDir src_root(QString::fromLocal8Bit(in_dir));
+    QDir dst_root(QString::fromLocal8Bit(out_dir));
+    if (!src_root.exists())
+    {
+        printf("Error input directory %s not found\n", in_dir);
+        return 1;
+    }
+
+    //
+    // Workers
+    //
+    convert_queue queue(queue_size);
+    std::mutex report_lock;
+    S32 n_ok = 0;
+    S32 n_failed = 0;
+    U64 in_bytes = 0;
+    U64 out_bytes = 0;
+    std::vector<std::thread> workers;
+
+    for (S32 t = 0; t < n_threads; t++)
+    {
+        workers.push_back(std::thread([&]()
+        {
+            t_convert_job job;
+            C8 error[512];
+
+            while (queue.pop(&job))
+            {
+                error[0] = 0;
+                bool result = convert_file(&job, &cfg, error, sizeof(error));
+
+                U64 in_size = (U64)QFileInfo(QString::fromLocal8Bit(job.src.c_str())).size();
+                U64 out_size = result ? (U64)QFileInfo(QString::fromLocal8Bit(job.dst.c_str())).size() : 0;
+
+                std::lock_guard<std::mutex> guard(report_lock);
+                if (result)
+                {
+                    n_ok++;
+                    in_bytes += in_size;
+                    out_bytes += out_size;
+                }
+                else
+                {
+                    n_failed++;
+                    printf("Error %s: %s\n", job.name.c_str(), error);
+                }
+            }
+        }));
+    }
+
+    //
+    // Directory scan (producer)
+    //
+    QDirIterator it(src_root.absolutePath(), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        QString path = it.next();
+        QString suffix = it.fileInfo().suffix().toLower();
+        if ((suffix != "s1p") && (suffix != "s2p"))
+        {
+            continue;
+        }
+        QString rel = src_root.relativeFilePath(path);
+        t_convert_job job;
+
+        job.src = path.toLocal8Bit().constData();
+        job.dst = dst_root.absoluteFilePath(rel).toLocal8Bit().constData();
+        job.name = rel.toLocal8Bit().constData();
+        job.n_ports = (suffix == "s1p") ? 1 : 2;
+        queue.push(job);
+    }
+    queue.close();
+
+    for (size_t t = 0; t < workers.size(); t++)
+    {
+        workers[t].join();
+    }
+
+    DOUBLE elapsed_s = max(1E-6, timer.nsecsElapsed() / 1E9);
+    printf("%d files converted, %d failed, %d threads in %.3f s: %.1f files/s, read %.1f MB/s, written %.1f MB/s\n",
+           n_ok, n_failed, n_threads, elapsed_s, n_ok / elapsed_s, in_bytes / 1E6 / elapsed_s, out_bytes / 1E6 / elapsed_s);
+
+    return (n_failed == 0) ? 0 : 2;
+}
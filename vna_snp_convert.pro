@@ -0,0 +1,26 @@
+# vna_snp_convert: headless batch Touchstone converter (no VISA, no GUI)
+QT = core
+
+TARGET = vna_snp_convert
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+# For Visual Studio Compiler
+DEFINES += _CRT_SECURE_NO_WARNINGS
+
+# GCC/Clang vectorization flags of the SPARAMS conversion kernels
+include(vna_compiler.pri)
+
+SOURCES += \
+        trace_decode.cpp \
+        vna_snp_convert.cpp
+
+HEADERS += \
+        trace_decode.h \
+        typedefs.h
+
+unix:!android: target.path = /opt/vna_qt/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,404 @@
+#include <QDebug>
+
+#include <thread>
+
+#include "vna_transcript.h"
+
+static void put_u32(U8 *dst, U32 value)
+{
+    dst[0] = (U8)(value & 0xFF);
+    dst[1] = (U8)((value >> 8) & 0xFF);
+    dst[2] = (U8)((value >> 16) & 0xFF);
+    dst[3] = (U8)(value >> 24);
+}
+
+static U32 get_u32(const U8 *src)
+{
+    return (U32)src[0] | ((U32)src[1] << 8) | ((U32)src[2] << 16) | ((U32)src[3] << 24);
+}
+
+/*
+Split "<prefix><file>::<rest>"
+Parameters:
+const C8 *resource => resource string
+S32 prefix_len => length of "REC:" or "PLAY:"
+C8 *filename => dest transcript filename (size 256)
+Return pointer on <rest> (after "::") or on the end of string
+*/
+static const C8 *split_transcript_resource(const C8 *resource, S32 prefix_len, C8 *filename)
+{
+    const C8 *file = resource + prefix_len;
+    const C8 *sep = strstr(file, "::");
+    S32 len = (sep != NULL) ? (S32)(sep - file) : strlen(file);
+
+    len = min(len, 255);
+    memcpy(filename, file, len);
+    filename[len] = 0;
+    return (sep != NULL) ? (sep + 2) : (file + strlen(file));
+}
+
+/* ---------------- Record ---------------- */
+
+vna_transport_record::vna_transport_record() : instr(nullptr), out(NULL)
+{
+}
+
+vna_transport_record::~vna_transport_record()
+{
+    close();
+}
+
+bool vna_transport_record::is_record_resource(const C8 *resource)
+{
+    return (_strnicmp(resource, "REC:", 4) == 0);
+}
+
+/*
+Parameters:
+const C8 *resource => "REC:<transcript file>::<instrument resource>"
+U32 timeout_ms => instrument I/O timeout in ms
+*/
+VNA_STATUS vna_transport_record::open(const C8 *resource, U32 timeout_ms)
+{
+    C8 filename[256];
+
+    close();
+    const C8 *instr_resource = split_transcript_resource(resource, 4, filename);
+
+    instr = vna_transport_create(instr_resource);
+    if (instr == nullptr)
+    {
+        return VNA_ERROR_RSRC_NFOUND;
+    }
+    VNA_STATUS stat = instr->open(instr_resource, timeout_ms);
+    if (stat < VNA_SUCCESS)
+    {
+        delete instr;
+        instr = nullptr;
+        return stat;
+    }
+
+    out = fopen(filename, "wb");
+    if (out == NULL)
+    {
+        qDebug("vna_transport_record::open() Error cannot create %s", filename);
+        close();
+        return VNA_ERROR_FILE_ACCESS;
+    }
+
+    U8 header[VNA_TRC_HEADER_SIZE] = { 'V', 'N', 'A', 'T', 'R', 'C', (U8)(VNA_TRC_VERSION & 0xFF), (U8)(VNA_TRC_VERSION >> 8) };
+    fwrite(header, 1, sizeof(header), out);
+    last_record = std::chrono::steady_clock::now();
+    record(VNA_TRC_OPEN, stat, instr_resource, strlen(instr_resource));
+    qDebug("vna_transport_record::open() recording \"%s\" to %s", instr_resource, filename);
+    return stat;
+}
+
+void vna_transport_record::close(void)
+{
+    if (instr != nullptr)
+    {
+        instr->close();
+        delete instr;
+        instr = nullptr;
+    }
+    if (out != NULL)
+    {
+        fclose(out);
+        out = NULL;
+    }
+}
+
+void vna_transport_record::record(VNA_TRC_TYPE type, VNA_STATUS status, const void *data, U32 len)
+{
+    U8 hdr[VNA_TRC_RECORD_HEADER_SIZE];
+
+    if (out == NULL)
+    {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    U64 delta_us = std::chrono::duration_cast<std::chrono::microseconds>(now - last_record).count();
+    last_record = now;
+
+    hdr[0] = (U8)type;
+    put_u32(&hdr[1], (U32)min(delta_us, (U64)0xFFFFFFFF));
+    put_u32(&hdr[5], (U32)status);
+    put_u32(&hdr[9], len);
+    fwrite(hdr, 1, sizeof(hdr), out);
+    if (len > 0)
+    {
+        fwrite(data, 1, len, out);
+    }
+}
+
+VNA_STATUS vna_transport_record::set_timeout(U32 timeout_ms)
+{
+    return instr->set_timeout(timeout_ms);
+}
+
+VNA_STATUS vna_transport_record::clear(void)
+{
+    scanf_discard();
+    VNA_STATUS stat = instr->clear();
+    record(VNA_TRC_CLEAR, stat, NULL, 0);
+    return stat;
+}
+
+VNA_STATUS vna_transport_record::read_stb(U16 *stb)
+{
+    VNA_STATUS stat = instr->read_stb(stb);
+    U8 data[2] = { (U8)(*stb & 0xFF), (U8)(*stb >> 8) };
+    record(VNA_TRC_STB, stat, data, sizeof(data));
+    return stat;
+}
+
+VNA_STATUS vna_transport_record::write(const U8 *buf, U32 cnt, U32 *ret_count)
+{
+    VNA_STATUS stat = instr->write(buf, cnt, ret_count);
+    record(VNA_TRC_WRITE, stat, buf, *ret_count);
+    return stat;
+}
+
+VNA_STATUS vna_transport_record::read(U8 *buf, U32 cnt, U32 *ret_count)
+{
+    VNA_STATUS stat = instr->read(buf, cnt, ret_count);
+    record(VNA_TRC_READ, stat, buf, *ret_count);
+    return stat;
+}
+
+/* ---------------- Replay ---------------- */
+
+vna_transport_replay::vna_transport_replay() :
+    transcript(NULL), transcript_len(0), pos(0), read_pos(0), fast(FALSE), replay_time_us(0), write_mismatch(0)
+{
+}
+
+vna_transport_replay::~vna_transport_replay()
+{
+    close();
+}
+
+bool vna_transport_replay::is_replay_resource(const C8 *resource)
+{
+    return (_strnicmp(resource, "PLAY:", 5) == 0);
+}
+
+/*
+Parameters:
+const C8 *resource => "PLAY:<transcript file>[::FAST]"
+U32 timeout_ms => not used
+*/
+VNA_STATUS vna_transport_replay::open(const C8 *resource, U32 timeout_ms)
+{
+    C8 filename[256];
+
+    Q_UNUSED(timeout_ms);
+    close();
+    const C8 *options = split_transcript_resource(resource, 5, filename);
+    fast = (_stricmp(options, "FAST") == 0);
+
+    FILE *in = fopen(filename, "rb");
+    if (in == NULL)
+    {
+        qDebug("vna_transport_replay::open() Error cannot open %s", filename);
+        return VNA_ERROR_RSRC_NFOUND;
+    }
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+
+    transcript = (size > VNA_TRC_HEADER_SIZE) ? (U8 *)malloc(size) : NULL;
+    if ((transcript == NULL) || (fread(transcript, 1, size, in) != (size_t)size) ||
+        (memcmp(transcript, VNA_TRC_MAGIC, 6) != 0) || (transcript[6] != VNA_TRC_VERSION))
+    {
+        qDebug("vna_transport_replay::open() Error invalid transcript %s", filename);
+        fclose(in);
+        close();
+        return VNA_ERROR_INV_FMT;
+    }
+    fclose(in);
+
+    transcript_len = (U32)size;
+    pos = VNA_TRC_HEADER_SIZE;
+    read_pos = 0;
+    replay_time_us = 0;
+    write_mismatch = 0;
+    replay_start = std::chrono::steady_clock::now();
+
+    VNA_TRC_TYPE type;
+    U32 delta_us;
+    VNA_STATUS status = VNA_SUCCESS;
+    const U8 *data;
+    U32 len;
+    if (peek_type(&type) && (type == VNA_TRC_OPEN))
+    {
+        next_record(&type, &delta_us, &status, &data, &len);
+        qDebug("vna_transport_replay::open() %s recorded from \"%.*s\" (%s)", filename, (int)len, data, fast ? "fast" : "recorded speed");
+        pos += VNA_TRC_RECORD_HEADER_SIZE + len;
+    }
+    return status;
+}
+
+void vna_transport_replay::close(void)
+{
+    if (write_mismatch > 0)
+    {
+        qDebug("vna_transport_replay::close() %d write(s) differ from the transcript", write_mismatch);
+    }
+    FREE(transcript);
+    transcript_len = 0;
+    pos = 0;
+    read_pos = 0;
+    write_mismatch = 0;
+}
+
+// Record at pos (not consumed), FALSE at end of transcript or if the record is truncated
+bool vna_transport_replay::next_record(VNA_TRC_TYPE *type, U32 *delta_us, VNA_STATUS *status, const U8 **data, U32 *len)
+{
+    if ((transcript == NULL) || (pos + VNA_TRC_RECORD_HEADER_SIZE > transcript_len))
+    {
+        return FALSE;
+    }
+    const U8 *hdr = &transcript[pos];
+    *type = (VNA_TRC_TYPE)hdr[0];
+    *delta_us = get_u32(&hdr[1]);
+    *status = (VNA_STATUS)get_u32(&hdr[5]);
+    *len = get_u32(&hdr[9]);
+    *data = &hdr[VNA_TRC_RECORD_HEADER_SIZE];
+    return (*len <= transcript_len - pos - VNA_TRC_RECORD_HEADER_SIZE);
+}
+
+bool vna_transport_replay::peek_type(VNA_TRC_TYPE *type)
+{
+    U32 delta_us;
+    VNA_STATUS status;
+    const U8 *data;
+    U32 len;
+
+    return next_record(type, &delta_us, &status, &data, &len);
+}
+
+// Advance the replay clock to the record time (wait for it at recorded speed)
+void vna_transport_replay::consume(U32 delta_us)
+{
+    replay_time_us += delta_us;
+    if (!fast)
+    {
+        std::this_thread::sleep_until(replay_start + std::chrono::microseconds(replay_time_us));
+    }
+}
+
+VNA_STATUS vna_transport_replay::clear(void)
+{
+    VNA_TRC_TYPE type;
+    U32 delta_us;
+    VNA_STATUS status;
+    const U8 *data;
+    U32 len;
+
+    scanf_discard();
+    if (next_record(&type, &delta_us, &status, &data, &len) && (type == VNA_TRC_CLEAR))
+    {
+        consume(delta_us);
+        pos += VNA_TRC_RECORD_HEADER_SIZE + len;
+        return status;
+    }
+    return VNA_SUCCESS;
+}
+
+VNA_STATUS vna_transport_replay::read_stb(U16 *stb)
+{
+    VNA_TRC_TYPE type;
+    U32 delta_us;
+    VNA_STATUS status;
+    const U8 *data;
+    U32 len;
+
+    *stb = 0;
+    if (next_record(&type, &delta_us, &status, &data, &len) && (type == VNA_TRC_STB))
+    {
+        consume(delta_us);
+        if (len >= 2)
+        {
+            *stb = (U16)(data[0] | (data[1] << 8));
+        }
+        pos += VNA_TRC_RECORD_HEADER_SIZE + len;
+        return status;
+    }
+    return (transcript != NULL) ? VNA_SUCCESS : VNA_ERROR_IO;
+}
+
+VNA_STATUS vna_transport_replay::write(const U8 *buf, U32 cnt, U32 *ret_count)
+{
+    VNA_TRC_TYPE type;
+    U32 delta_us;
+    VNA_STATUS status;
+    const U8 *data;
+    U32 len;
+    S32 skipped = 0;
+
+    *ret_count = 0;
+    read_pos = 0;
+
+    // Replies not read by the caller (recorded code was different) are skipped
+    while (next_record(&type, &delta_us, &status, &data, &len) && (type != VNA_TRC_WRITE))
+    {
+        replay_time_us += delta_us;
+        pos += VNA_TRC_RECORD_HEADER_SIZE + len;
+        skipped++;
+    }
+    if (skipped > 0)
+    {
+        qDebug("vna_transport_replay::write() %d record(s) skipped", skipped);
+    }
+    if (!next_record(&type, &delta_us, &status, &data, &len))
+    {
+        qDebug("vna_transport_replay::write() end of transcript");
+        return VNA_ERROR_IO;
+    }
+
+    if ((len != cnt) || (memcmp(data, buf, cnt) != 0))
+    {
+        write_mismatch++;
+        qDebug("vna_transport_replay::write() \"%.*s\" differs from transcript \"%.*s\"", (int)cnt, buf, (int)len, data);
+    }
+    consume(delta_us);
+    pos += VNA_TRC_RECORD_HEADER_SIZE + len;
+    *ret_count = cnt;
+    return status;
+}
+
+VNA_STATUS vna_transport_replay::read(U8 *buf, U32 cnt, U32 *ret_count)
+{
+    VNA_TRC_TYPE type;
+    U32 delta_us;
+    VNA_STATUS status;
+    const U8 *data;
+    U32 len;
+
+    *ret_count = 0;
+    if (!next_record(&type, &delta_us, &status, &data, &len) || (type != VNA_TRC_READ))
+    {
+        return VNA_ERROR_TMO; // No recorded reply for this read
+    }
+
+    if (read_pos == 0)
+    {
+        consume(delta_us);
+    }
+
+    // The caller buffer may be smaller than the recorded one, the rest is returned by the next read()
+    U32 n = min(cnt, len - read_pos);
+    memcpy(buf, &data[read_pos], n);
+    read_pos += n;
+    *ret_count = n;
+    if (read_pos < len)
+    {
+        return VNA_SUCCESS_MAX_CNT;
+    }
+    pos += VNA_TRC_RECORD_HEADER_SIZE + len;
+    read_pos = 0;
+    return status;
+}
@@ -0,0 +1,106 @@
+#ifndef VNA_TRANSCRIPT_H
+#define VNA_TRANSCRIPT_H
+
+#include <chrono>
+#include <QtGlobal>
+
+#include "vna_transport.h"
+
+/*
+GPIB transcript file (binary, little endian)
+Header: "VNATRC" + U16 version
+Records: U8 type + U32 delta_us (time since previous record) + S32 status + U32 len + len bytes of data
+- VNA_TRC_OPEN => resource string of the recorded session
+- VNA_TRC_WRITE => bytes written (commands)
+- VNA_TRC_READ => bytes read, status is the read status (VNA_SUCCESS = END, VNA_SUCCESS_MAX_CNT ...)
+- VNA_TRC_CLEAR => device clear
+- VNA_TRC_STB => serial poll, data is the U16 status byte
+*/
+#define VNA_TRC_MAGIC "VNATRC"
+#define VNA_TRC_VERSION (1)
+#define VNA_TRC_HEADER_SIZE (8)
+#define VNA_TRC_RECORD_HEADER_SIZE (13)
+
+enum VNA_TRC_TYPE
+{
+    VNA_TRC_OPEN = 'O',
+    VNA_TRC_WRITE = 'W',
+    VNA_TRC_READ = 'R',
+    VNA_TRC_CLEAR = 'C',
+    VNA_TRC_STB = 'S'
+};
+
+/*
+Record transport, resource "REC:<transcript file>::<instrument resource>"
+e.g. "REC:session.trc::GPIB0::16::INSTR" or "REC:session.trc::SIM::8753"
+All I/O is done by the instrument transport and logged to the transcript file.
+Formatted I/O (printf/scanf_xxx/read_to_file) use the generic implementation over write()/read()
+so every byte exchanged is recorded.
+*/
+class vna_transport_record : public vna_transport
+{
+public:
+    vna_transport_record();
+    ~vna_transport_record();
+
+    static bool is_record_resource(const C8 *resource);
+
+    VNA_STATUS open(const C8 *resource, U32 timeout_ms);
+    void close(void);
+
+    VNA_STATUS set_timeout(U32 timeout_ms);
+    VNA_STATUS clear(void);
+    VNA_STATUS read_stb(U16 *stb);
+
+    VNA_STATUS write(const U8 *buf, U32 cnt, U32 *ret_count);
+    VNA_STATUS read(U8 *buf, U32 cnt, U32 *ret_count);
+
+private:
+    void record(VNA_TRC_TYPE type, VNA_STATUS status, const void *data, U32 len);
+
+    vna_transport *instr;
+    FILE *out;
+    std::chrono::steady_clock::time_point last_record;
+};
+
+/*
+Replay transport, resource "PLAY:<transcript file>[::FAST]"
+Reads are answered with the recorded bytes (and status) in the recorded order,
+writes are compared with the recorded commands (mismatch logged with qDebug).
+Replies are delivered at the recorded time (instrument latency reproduced) or
+as fast as possible with the FAST option (parser/writer benchmark).
+*/
+class vna_transport_replay : public vna_transport
+{
+public:
+    vna_transport_replay();
+    ~vna_transport_replay();
+
+    static bool is_replay_resource(const C8 *resource);
+
+    VNA_STATUS open(const C8 *resource, U32 timeout_ms);
+    void close(void);
+
+    VNA_STATUS set_timeout(U32 timeout_ms) { Q_UNUSED(timeout_ms); return VNA_SUCCESS; }
+    VNA_STATUS clear(void);
+    VNA_STATUS read_stb(U16 *stb);
+
+    VNA_STATUS write(const U8 *buf, U32 cnt, U32 *ret_count);
+    VNA_STATUS read(U8 *buf, U32 cnt, U32 *ret_count);
+
+private:
+    bool next_record(VNA_TRC_TYPE *type, U32 *delta_us, VNA_STATUS *status, const U8 **data, U32 *len);
+    bool peek_type(VNA_TRC_TYPE *type);
+    void consume(U32 delta_us);
+
+    U8 *transcript; // Whole transcript file
+    U32 transcript_len;
+    U32 pos; // Next record
+    U32 read_pos; // Bytes of the current read record already returned
+    bool fast; // No wait, replay as fast as possible
+    U64 replay_time_us; // Recorded time of the last consumed record
+    std::chrono::steady_clock::time_point replay_start;
+    S32 write_mismatch;
+};
+
+#endif // VNA_TRANSCRIPT_H
@@ -0,0 +1,263 @@
+#include <QDebug>
+
+#include "vna_transport.h"
+#include "vna_sim.h"
+#include "vna_transcript.h"
+#include "trace_decode.h"
+
+#ifdef VNA_HAVE_VISA
+#include <visa.h> // include VISA header file
+#endif
+
+static inline bool is_scanf_separator(C8 c)
+{
+    return ((c == ' ') || (c == ',') || (c == '\t') || (c == '\r') || (c == '\n') || (c == ';'));
+}
+
+vna_transport::vna_transport()
+{
+    fmt_buf[0] = 0;
+    scanf_discard();
+}
+
+VNA_STATUS vna_transport::vprintf(const C8 *fmt, va_list args)
+{
+    C8 text[VNA_TRANSPORT_FMT_BUF_SIZE];
+    U32 ret_count = 0;
+
+    S32 len = _vsnprintf(text, sizeof(text) - 1, fmt, args);
+    if ((len < 0) || (len >= (S32)sizeof(text) - 1))
+    {
+        return VNA_ERROR_INV_FMT;
+    }
+
+    scanf_discard(); // New command, pending reply data are not used anymore
+    return write((const U8 *)text, (U32)len, &ret_count);
+}
+
+VNA_STATUS vna_transport::printf(const C8 *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    VNA_STATUS stat = vprintf(fmt, args);
+    va_end(args);
+    return stat;
+}
+
+/*
+Scan next ASCII number of the reply, a new message is read when the pending one is fully parsed
+A number is only parsed when it is followed by a separator or the END of message
+(a number can be split between two read())
+*/
+VNA_STATUS vna_transport::scanf_double(DOUBLE *value)
+{
+    for (;;)
+    {
+        while ((fmt_pos < fmt_len) && is_scanf_separator(fmt_buf[fmt_pos]))
+        {
+            fmt_pos++;
+        }
+
+        if (fmt_pos < fmt_len)
+        {
+            S32 i = fmt_pos;
+            while ((i < fmt_len) && (!is_scanf_separator(fmt_buf[i])))
+            {
+                i++;
+            }
+
+            if ((i < fmt_len) || fmt_end || (fmt_pos == 0 && fmt_len == (S32)sizeof(fmt_buf)))
+            {
+                const C8 *end = parse_ascii_double(&fmt_buf[fmt_pos], &fmt_buf[i], value);
+                fmt_pos = i;
+                return (end != nullptr) ? VNA_SUCCESS : VNA_ERROR_INV_FMT;
+            }
+        }
+        else if (fmt_end)
+        {
+            scanf_discard(); // Whole message parsed, next number is in the next message
+        }
+
+        // Keep the unparsed part then read more data
+        memmove(fmt_buf, &fmt_buf[fmt_pos], fmt_len - fmt_pos);
+        fmt_len -= fmt_pos;
+        fmt_pos = 0;
+
+        U32 ret_count = 0;
+        VNA_STATUS stat = read((U8 *)&fmt_buf[fmt_len], sizeof(fmt_buf) - fmt_len, &ret_count);
+        if (stat < VNA_SUCCESS)
+        {
+            scanf_discard();
+            return stat;
+        }
+        fmt_len += ret_count;
+        fmt_end = (stat != VNA_SUCCESS_MAX_CNT);
+        if ((ret_count == 0) && (fmt_len == 0))
+        {
+            return VNA_ERROR_TMO;
+        }
+    }
+}
+
+VNA_STATUS vna_transport::scanf_int(S32 *value)
+{
+    DOUBLE d = 0.0;
+
+    VNA_STATUS stat = scanf_double(&d);
+    if (stat >= VNA_SUCCESS)
+    {
+        *value = (S32)((d < 0.0) ? (d - 0.5) : (d + 0.5));
+    }
+    return stat;
+}
+
+VNA_STATUS vna_transport::read_to_file(const C8 *filename, U32 cnt, U32 *ret_count)
+{
+    U8 buf[4096];
+    VNA_STATUS stat = VNA_SUCCESS_MAX_CNT;
+
+    *ret_count = 0;
+    FILE *out = fopen(filename, "wb");
+    if (out == NULL)
+    {
+        return VNA_ERROR_FILE_ACCESS;
+    }
+
+    while ((stat == VNA_SUCCESS_MAX_CNT) && (*ret_count < cnt))
+    {
+        U32 n = 0;
+        stat = read(buf, min((U32)sizeof(buf), cnt - *ret_count), &n);
+        if ((n > 0) && (fwrite(buf, 1, n, out) != n))
+        {
+            stat = VNA_ERROR_FILE_ACCESS;
+        }
+        *ret_count += n;
+    }
+
+    fclose(out);
+    return stat;
+}
+
+#ifdef VNA_HAVE_VISA
+/*
+VISA transport (Keysight/NI VISA library)
+printf/scanf/read_to_file use the VISA formatted I/O functions directly
+*/
+class vna_transport_visa : public vna_transport
+{
+public:
+    vna_transport_visa() : rscmng(VI_NULL), instr(VI_NULL) {}
+    ~vna_transport_visa() { close(); }
+
+    VNA_STATUS open(const C8 *resource, U32 timeout_ms)
+    {
+        ViStatus stat = viOpenDefaultRM(&rscmng);
+        if (stat < VI_SUCCESS)
+        {
+            rscmng = VI_NULL;
+            return stat;
+        }
+        qDebug("viOpenDefaultRM stat=0x%08X stat=%d", rscmng, stat);
+/*
+        // search for the VNA
+        ViChar viFound[VI_FIND_BUFLEN] = { 0 };
+        ViUInt32 nFound;
+        ViFindList listOfFound;
+        stat = viFindRsrc(rscmng, (ViString)"GPIB?*INSTR", &listOfFound, &nFound, viFound);
+        //stat = viFindRsrc(rscmng, (ViString)"GPIB?*", &listOfFound, &nFound, viFound);
+        qDebug("viFindRsrc stat=%d listOfFound=%d nFound=%d", stat, listOfFound, nFound);
+        qDebug("viFindRsrc viFound=%s", viFound);
+*/
+        stat = viOpen(rscmng, (ViRsrc)resource, VI_NULL, VI_NULL, &instr);
+        if (stat < VI_SUCCESS)
+        {
+            viClose(rscmng);
+            rscmng = VI_NULL;
+            instr = VI_NULL;
+            return stat;
+        }
+        /* Initialize the timeout attribute */
+        viSetAttribute(instr, VI_ATTR_TMO_VALUE, timeout_ms);
+        return stat;
+    }
+
+    void close(void)
+    {
+        if (instr != VI_NULL)
+        {
+            viClose(instr);
+        }
+        if (rscmng != VI_NULL)
+        {
+            viClose(rscmng);
+        }
+        instr = VI_NULL;
+        rscmng = VI_NULL;
+    }
+
+    VNA_STATUS set_timeout(U32 timeout_ms) { return viSetAttribute(instr, VI_ATTR_TMO_VALUE, timeout_ms); }
+    VNA_STATUS clear(void) { return viClear(instr); }
+
+    VNA_STATUS read_stb(U16 *stb)
+    {
+        ViUInt16 status = 0;
+        ViStatus stat = viReadSTB(instr, &status);
+        *stb = status;
+        return stat;
+    }
+
+    VNA_STATUS write(const U8 *buf, U32 cnt, U32 *ret_count)
+    {
+        ViUInt32 n = 0;
+        ViStatus stat = viWrite(instr, (ViBuf)buf, cnt, &n);
+        *ret_count = n;
+        return stat;
+    }
+
+    VNA_STATUS read(U8 *buf, U32 cnt, U32 *ret_count)
+    {
+        ViUInt32 n = 0;
+        ViStatus stat = viRead(instr, (ViPBuf)buf, cnt, &n);
+        *ret_count = n;
+        return stat;
+    }
+
+    VNA_STATUS vprintf(const C8 *fmt, va_list args) { return viVPrintf(instr, (ViString)fmt, args); }
+
+    VNA_STATUS scanf_double(DOUBLE *value) { return viScanf(instr, (ViString)"%lf", value); }
+
+    VNA_STATUS read_to_file(const C8 *filename, U32 cnt, U32 *ret_count)
+    {
+        ViUInt32 n = 0;
+        ViStatus stat = viReadToFile(instr, (ViConstString)filename, cnt, &n);
+        *ret_count = n;
+        return stat;
+    }
+
+private:
+    ViSession rscmng;
+    ViSession instr;
+};
+#endif
+
+vna_transport *vna_transport_create(const C8 *resource)
+{
+    if (vna_sim_8753::is_sim_resource(resource))
+    {
+        return new vna_sim_8753();
+    }
+    if (vna_transport_record::is_record_resource(resource))
+    {
+        return new vna_transport_record();
+    }
+    if (vna_transport_replay::is_replay_resource(resource))
+    {
+        return new vna_transport_replay();
+    }
+#ifdef VNA_HAVE_VISA
+    return new vna_transport_visa();
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,80 @@
+#ifndef VNA_TRANSPORT_H
+#define VNA_TRANSPORT_H
+
+#include <stdarg.h>
+#include "typedefs.h"
+
+/*
+Status returned by vna_transport functions
+Same values as VISA (VI_SUCCESS, VI_SUCCESS_MAX_CNT, VI_ERROR_xxx) so debug logs stay comparable
+Success is >= VNA_SUCCESS, error is < VNA_SUCCESS
+*/
+typedef S32 VNA_STATUS;
+
+#define VNA_SUCCESS            ((VNA_STATUS)0x00000000L)
+#define VNA_SUCCESS_MAX_CNT    ((VNA_STATUS)0x3FFF0006L) // Read buffer full before END, more data to read
+#define VNA_ERROR_SYSTEM_ERROR ((VNA_STATUS)0xBFFF0000L)
+#define VNA_ERROR_RSRC_NFOUND  ((VNA_STATUS)0xBFFF0011L)
+#define VNA_ERROR_TMO          ((VNA_STATUS)0xBFFF0015L)
+#define VNA_ERROR_IO           ((VNA_STATUS)0xBFFF003EL)
+#define VNA_ERROR_INV_FMT      ((VNA_STATUS)0xBFFF003FL)
+#define VNA_ERROR_NSUP_OPER    ((VNA_STATUS)0xBFFF0067L)
+#define VNA_ERROR_FILE_ACCESS  ((VNA_STATUS)0xBFFF00A1L)
+
+#define VNA_TRANSPORT_FMT_BUF_SIZE (4096) // printf()/scanf_xxx() buffer size
+
+/*
+Instrument transport (message based I/O with the VNA)
+Same semantic as the VISA functions used before (viPrintf, viRead, viScanf, viReadToFile ...)
+- read() returns at END of message (VNA_SUCCESS) or when cnt bytes are read (VNA_SUCCESS_MAX_CNT)
+- scanf_double()/scanf_int() keep unread data of a reply for the next call (like viScanf())
+  and read a new message when needed, the pending data is discarded by the next write
+Implementations: VISA (vna_transport_visa), simulated HP8753 (vna_sim_8753, see vna_sim.h)
+and transcript record/replay (vna_transport_record/vna_transport_replay, see vna_transcript.h)
+*/
+class vna_transport
+{
+public:
+    vna_transport();
+    virtual ~vna_transport() {}
+
+    // resource => "GPIB0::16::INSTR" (VISA), "SIM::8753..." (simulated), "REC:..."/"PLAY:..." (transcript)
+    virtual VNA_STATUS open(const C8 *resource, U32 timeout_ms) = 0;
+    virtual void close(void) = 0;
+
+    virtual VNA_STATUS set_timeout(U32 timeout_ms) = 0;
+    virtual VNA_STATUS clear(void) = 0; // Device clear (viClear)
+    virtual VNA_STATUS read_stb(U16 *stb) = 0; // Serial poll (viReadSTB)
+
+    virtual VNA_STATUS write(const U8 *buf, U32 cnt, U32 *ret_count) = 0; // viWrite
+    virtual VNA_STATUS read(U8 *buf, U32 cnt, U32 *ret_count) = 0; // viRead
+
+    virtual VNA_STATUS vprintf(const C8 *fmt, va_list args); // viVPrintf
+    VNA_STATUS printf(const C8 *fmt, ...); // viPrintf
+
+    virtual VNA_STATUS scanf_double(DOUBLE *value); // viScanf("%lf")
+    VNA_STATUS scanf_int(S32 *value); // Integer value (also accept "+2.01E+02" style replies)
+
+    virtual VNA_STATUS read_to_file(const C8 *filename, U32 cnt, U32 *ret_count); // viReadToFile
+
+protected:
+    void scanf_discard(void) { fmt_len = 0; fmt_pos = 0; fmt_end = FALSE; }
+
+private:
+    // Formatted read buffer used by scanf_xxx()
+    C8 fmt_buf[VNA_TRANSPORT_FMT_BUF_SIZE];
+    S32 fmt_len;
+    S32 fmt_pos;
+    bool fmt_end; // END of message received
+};
+
+/*
+Create the transport matching a resource string (not opened)
+Parameters:
+const C8 *resource => "SIM::8753..." for the simulated instrument, "REC:<file>::<resource>" to record
+a transcript, "PLAY:<file>[::FAST]" to replay a transcript, VISA resource otherwise
+Return nullptr if VISA is required but not available in this build
+*/
+vna_transport *vna_transport_create(const C8 *resource);
+
+#endif // VNA_TRANSPORT_H